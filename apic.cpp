@@ -0,0 +1,191 @@
+/***************************************************************************
+ *            apic.cpp
+ *
+ *  Copyright  2008  Matthias v.d. Vlies
+ *  matthias@mserver.nl
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*! \file apic.cpp
+ *  \brief Local APIC driver
+ *   
+ * This file implements the APIC class.
+ *
+ */
+
+#include <I386/apic.h>
+#include <I386/idt.h>
+#include <I386/pit.h>
+#include <core/timer.h>
+#include <core/softirq.h>
+#include <core/scheduler.h>
+#include <errors.h>
+
+// set instance pointer to a null pointer
+I386::APIC* I386::APIC::_instance = 0;
+
+// not mapped until the resource starts
+volatile unsigned long* I386::APIC::_registers = 0;
+
+I386::APIC* I386::APIC::getInstance() {
+    
+    // check for exsisting instance
+    if(_instance == 0) {
+        
+        // none found, create new instance
+        _instance = new APIC();
+        
+        // check if we got a valid address
+        if(_instance == reinterpret_cast<APIC*>(E_ALLOC_NOMEM)) {
+            
+            _instance = 0;
+            
+            // no, major oops here!
+            return E_FAILURE;
+        }
+        
+        // auto register
+        Core::ResourceManager::getInstance()->registerResource(_instance);
+    }
+    
+    // return the instance
+    return _instance;
+}
+
+I386::APIC::APIC() {
+    
+    this->_timerCount = 0;
+}
+
+unsigned long I386::APIC::startResource() {
+    
+    unsigned long registers[4];
+    
+    I386::cpuid(1, 0, registers);
+    
+    // no local APIC?
+    if(!(registers[3] & (1 << 9))) {
+        
+        return E_FAILURE;
+    }
+    
+    // paging is off, the physical base is directly addressable
+    _registers = reinterpret_cast<volatile unsigned long*>(static_cast<unsigned long>(I386::readModelSpecificRegister(APIC_BASE_MSR)) & 0xfffff000);
+    
+    I386::IDT* idt = I386::IDT::getInstance();
+    
+    idt->registerHandler(APIC_TIMER_VECTOR, I386::APIC::timerInterrupt);
+    idt->registerHandler(APIC_RESCHEDULE_VECTOR, I386::APIC::rescheduleInterrupt);
+    
+    // accept everything and software enable, the PIC stays wired to LINT0
+    _registers[APIC_TPR / 4] = 0;
+    _registers[APIC_SPURIOUS / 4] = APIC_ENABLE | APIC_SPURIOUS_VECTOR;
+    
+    // count down from the top for a number of PIT ticks with the timer masked
+    _registers[APIC_TIMER_DIVIDE / 4] = APIC_TIMER_DIVIDE_16;
+    _registers[APIC_LVT_TIMER / 4] = APIC_LVT_MASKED | APIC_TIMER_VECTOR;
+    
+    I386::PIT::delay(1);
+    
+    _registers[APIC_TIMER_INITIAL / 4] = 0xffffffff;
+    
+    I386::PIT::delay(APIC_CALIBRATE_TICKS);
+    
+    this->_timerCount = (0xffffffff - _registers[APIC_TIMER_CURRENT / 4]) / APIC_CALIBRATE_TICKS;
+    
+    _registers[APIC_TIMER_INITIAL / 4] = 0;
+    
+    // the timer needs to count at least once per tick
+    if(this->_timerCount == 0) {
+        
+        _registers = 0;
+        
+        return E_FAILURE;
+    }
+    
+    return E_SUCCESS;
+}
+
+const char* I386::APIC::getResourceName() {
+    
+    return "Local APIC";
+}
+
+bool I386::APIC::isEnabled() {
+    
+    return _registers != 0;
+}
+
+void I386::APIC::initialiseProcessor() {
+    
+    _registers[APIC_TPR / 4] = 0;
+    _registers[APIC_SPURIOUS / 4] = APIC_ENABLE | APIC_SPURIOUS_VECTOR;
+    
+    // periodic tick for the scheduler of this processor
+    _registers[APIC_TIMER_DIVIDE / 4] = APIC_TIMER_DIVIDE_16;
+    _registers[APIC_LVT_TIMER / 4] = APIC_TIMER_PERIODIC | APIC_TIMER_VECTOR;
+    _registers[APIC_TIMER_INITIAL / 4] = this->_timerCount;
+}
+
+unsigned int I386::APIC::getId() {
+    
+    return _registers[APIC_ID / 4] >> 24;
+}
+
+void I386::APIC::sendInit(unsigned int id) {
+    
+    this->sendCommand(id, APIC_ICR_INIT | APIC_ICR_ASSERT);
+}
+
+void I386::APIC::sendStartup(unsigned int id, unsigned char page) {
+    
+    this->sendCommand(id, APIC_ICR_STARTUP | APIC_ICR_ASSERT | page);
+}
+
+void I386::APIC::sendInterrupt(unsigned int id, unsigned char vector) {
+    
+    this->sendCommand(id, APIC_ICR_ASSERT | vector);
+}
+
+void I386::APIC::sendCommand(unsigned int id, unsigned long command) {
+    
+    unsigned long flags = I386::saveFlags();
+    
+    // writing the low word sends the interrupt, nothing may come between
+    _registers[APIC_ICR_HIGH / 4] = id << 24;
+    _registers[APIC_ICR_LOW / 4] = command;
+    
+    while(_registers[APIC_ICR_LOW / 4] & APIC_ICR_PENDING) {
+        
+        I386::cpuRelax();
+    }
+    
+    I386::restoreFlags(flags);
+}
+
+void I386::APIC::timerInterrupt(struct Registers* registers) {
+    
+    // the boot processor advances the tick count, we only run our own timers
+    Core::SoftIRQ::raise(SOFTIRQ_TIMER);
+    Core::Scheduler::tick();
+}
+
+void I386::APIC::rescheduleInterrupt(struct Registers* registers) {
+    
+    // nothing to do, the interrupt exit picks up the new work
+}
@@ -8,6 +8,12 @@
 #include <core/console.h>
 #include <core/architecture.h>
 #include <I386/gdt.h>
+#include <I386/idt.h>
+#include <I386/fpu.h>
+#include <I386/pit.h>
+#include <I386/apic.h>
+#include <I386/smp.h>
+#include <I386/i386.h>
 
 void Core::Architecture::detectArchitecture() {
     Console* console = Core::Console::getInstance();
@@ -15,5 +21,15 @@ void Core::Architecture::detectArchitecture() {
 #ifdef __i386__
     console->write("i386\n");
     I386::GDT::getInstance();
+    I386::IDT::getInstance();
+    I386::FPU::getInstance();
+    I386::PIT::getInstance();
+    
+    // hardware handlers are in place, let interrupts in
+    I386::enableInterrupts();
+    
+    // calibrating the APIC timer and starting the other processors need the tick
+    I386::APIC::getInstance();
+    I386::SMP::getInstance();
 #endif
 }
@@ -0,0 +1,122 @@
+/***************************************************************************
+ *            bochsdisplay.cpp
+ *
+ *  Copyright  2008  Matthias v.d. Vlies
+ *  matthias@mserver.nl
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+
+/*! \file bochsdisplay.cpp
+ *  \brief Bochs/QEMU display adapter
+ *   
+ *  This file implements page flipping on the Bochs and QEMU display adapter.
+ *
+ */
+
+#include <core/bochsdisplay.h>
+#include <config.h>
+#include <errors.h>
+
+// set instance pointer to a null pointer
+Core::BochsDisplay* Core::BochsDisplay::_instance = 0;
+
+Core::BochsDisplay* Core::BochsDisplay::getInstance() {
+    
+    // check for exsisting instance
+    if(_instance == 0) {
+        
+        // none found, create new instance
+        _instance = new BochsDisplay();
+        
+        // check if we got a valid address
+        if(_instance == reinterpret_cast<BochsDisplay*>(E_ALLOC_NOMEM)) {
+            
+            _instance = 0;
+            
+            // no, major oops here!
+            return E_FAILURE;
+        }
+    }
+    
+    // return the instance
+    return _instance;
+}
+
+Core::BochsDisplay::BochsDisplay() {
+    
+    this->_height = 0;
+}
+
+unsigned short Core::BochsDisplay::readRegister(unsigned short index) {
+    
+    I386::writePortWord(BOCHS_DISPLAY_INDEX_PORT, index);
+    
+    return I386::readPortWord(BOCHS_DISPLAY_DATA_PORT);
+}
+
+void Core::BochsDisplay::writeRegister(unsigned short index, unsigned short value) {
+    
+    I386::writePortWord(BOCHS_DISPLAY_INDEX_PORT, index);
+    I386::writePortWord(BOCHS_DISPLAY_DATA_PORT, value);
+}
+
+bool Core::BochsDisplay::isPresent() {
+    
+    // other adapters float the bus and read back all ones
+    unsigned short id = this->readRegister(BOCHS_DISPLAY_ID);
+    
+    return id >= BOCHS_DISPLAY_ID_MIN && id <= BOCHS_DISPLAY_ID_MAX;
+}
+
+unsigned long Core::BochsDisplay::setPages(unsigned long width, unsigned long height, unsigned long depth, unsigned long pages) {
+    
+    if(!this->isPresent()) {
+        
+        return E_FAILURE;
+    }
+    
+    // the framebuffer we were handed has to be the one of this adapter
+    if(!(this->readRegister(BOCHS_DISPLAY_ENABLE) & BOCHS_DISPLAY_ENABLED)
+        || this->readRegister(BOCHS_DISPLAY_XRES) != width
+        || this->readRegister(BOCHS_DISPLAY_YRES) != height
+        || this->readRegister(BOCHS_DISPLAY_BPP) != depth) {
+        
+        return E_FAILURE;
+    }
+    
+    // some versions take the height as given, others report all of their memory
+    this->writeRegister(BOCHS_DISPLAY_VIRT_HEIGHT, height * pages);
+    
+    if(this->readRegister(BOCHS_DISPLAY_VIRT_HEIGHT) < height * pages) {
+        
+        return E_FAILURE;
+    }
+    
+    this->_height = height;
+    
+    this->showPage(0);
+    
+    return E_SUCCESS;
+}
+
+void Core::BochsDisplay::showPage(unsigned long page) {
+    
+    // a single register write, the adapter scans out from the new line on
+    this->writeRegister(BOCHS_DISPLAY_Y_OFFSET, page * this->_height);
+}
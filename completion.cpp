@@ -0,0 +1,87 @@
+/***************************************************************************
+ *            completion.cpp
+ *
+ *  Copyright  2008  Matthias v.d. Vlies
+ *  matthias@mserver.nl
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*! \file completion.cpp
+ *  \brief Completions
+ *   
+ *  This file implements the Completion class.
+ *
+ */
+
+#include <core/completion.h>
+#include <I386/i386.h>
+
+Core::Completion::Completion() : _done(0) {
+    
+}
+
+void Core::Completion::wait() {
+    
+    // every waiter takes its own signal, wake them one at a time
+    this->_waiters.wait(Core::Completion::consume, this, true);
+}
+
+void Core::Completion::complete() {
+    
+    I386::atomicFetchAdd(&this->_done, 1);
+    
+    this->_waiters.wakeUp();
+}
+
+void Core::Completion::completeAll() {
+    
+    this->_done = COMPLETION_ALL;
+    
+    this->_waiters.wakeUpAll();
+}
+
+bool Core::Completion::isDone() {
+    
+    return this->_done != 0;
+}
+
+bool Core::Completion::consume(void* data) {
+    
+    Completion* completion = reinterpret_cast<Completion*>(data);
+    
+    for(;;) {
+        
+        unsigned long done = completion->_done;
+        
+        if(done == 0) {
+            
+            return false;
+        }
+        
+        if(done >= COMPLETION_ALL) {
+            
+            return true;
+        }
+        
+        // complete() does not take the queue lock, count down atomically
+        if(I386::compareExchange(&completion->_done, done, done - 1) == done) {
+            
+            return true;
+        }
+    }
+}
@@ -33,6 +33,10 @@
 #include <config.h>
 #include <errors.h>
 #include <I386/i386.h>
+#include <core/rcu.h>
+
+// statistics for the console lock
+static LOCK_CLASS(consoleLockClass, "console");
 
 // set instance pointer to a null pointer
 Core::Console* Core::Console::_instance = 0;
@@ -59,85 +63,328 @@ Core::Console* Core::Console::getInstance() {
     return _instance;
 }
 
-Core::Console::Console() {
+Core::Console::Console() : _lock(&consoleLockClass), _flushTimer(Core::Console::flushTimer, 0) {
     
-    // do nothing
+    this->_activeTerminal = 0;
+    this->_terminalCount = 0;
+    this->_flushArmed = false;
+    this->_cursor = -1;
+    this->_start = -1;
+}
+
+unsigned long Core::Console::addTerminal(Terminal* terminal) {
+    
+    unsigned long flags = this->_lock.lockIrqSave();
+    
+    if(this->_terminalCount == CONSOLE_TERMINALS) {
+        
+        this->_lock.unlockIrqRestore(flags);
+        
+        return E_FAILURE;
+    }
+    
+    unsigned int index = this->_terminalCount++;
+    
+    this->_terminals[index] = terminal;
+    
+    unsigned long pages = terminal->_device->getPages() / CONSOLE_TERMINALS;
+    
+    // with room for several pages each, a terminal scrolls by moving the start of its screen
+    if(pages > 1) {
+        
+        terminal->_page = index * pages;
+        terminal->_pageRows = pages * terminal->_device->getRows();
+    }
+    else if(index < terminal->_device->getPages()) {
+        
+        terminal->_page = index;
+    }
+    
+    // terminals without a page of their own share the first one
+    terminal->_origin = terminal->_page * terminal->_device->getColumns() * terminal->_device->getRows();
+    
+    this->_lock.unlockIrqRestore(flags);
+    
+    return E_SUCCESS;
+}
+
+Core::Terminal* Core::Console::getTerminal(unsigned int index) {
+    
+    // terminals are never removed
+    if(index >= this->_terminalCount) {
+        
+        return 0;
+    }
+    
+    return this->_terminals[index];
 }
 
 Core::Terminal* Core::Console::getActiveTerminal() {
     
-    return this->_activeTerminal;
+    // terminals are never freed, the pointer only needs to be read once
+    return Core::RCU::dereference(this->_activeTerminal);
 }
 
 void Core::Console::switchTerminal(Terminal* terminal) {
     
-    this->_activeTerminal = terminal;
+    unsigned long flags = this->_lock.lockIrqSave();
+    
+    Terminal* previous = this->_activeTerminal;
+    
+    Core::RCU::assign(this->_activeTerminal, terminal);
+    
+    // the page shows another terminal, so every row has to be flushed again
+    if(previous == 0 || previous->_device != terminal->_device || previous->_page == terminal->_page) {
+        
+        terminal->markAllDirty();
+    }
     
-    // clear screen
-    this->_activeTerminal->_device->clearBuffer();
+    this->_cursor = -1;
+    this->_start = -1;
    
-    // copy new contents
-    this->copyBuffer();
+    // copy the rows written in the background and show the page
+    this->flushLocked();
+    
+    this->_lock.unlockIrqRestore(flags);
 }
 
 void Core::Console::put(int x, int y, char c) {
     
+    unsigned long flags = this->_lock.lockIrqSave();
+    
     this->_activeTerminal->put(x, y, c);
     
     // copy new contents
     this->copyBuffer();
+    
+    this->_lock.unlockIrqRestore(flags);
 }
 
 void Core::Console::copyBuffer() {
     
-    // copy buffer from Terminal to CharacterDevice
-    this->_activeTerminal->_device->write(this->_activeTerminal->_buffer, this->_activeTerminal->_bufferSize);
+    Terminal* terminal = this->_activeTerminal;
+    
+    int columns = terminal->_columns;
+    
+    // copy each run of changed rows from Terminal to CharacterDevice
+    for(int row = 0; row < terminal->_rows; row++) {
+        
+        if(!terminal->isDirty(row)) {
+            
+            continue;
+        }
+        
+        int first = row;
+        
+        // merge adjacent rows into one write
+        while(row < terminal->_rows && terminal->isDirty(row)) {
+            
+            row++;
+        }
+        
+        // a run is contiguous in the ring unless it wraps around the end
+        while(first < row) {
+            
+            int ringRow = terminal->getVisibleRow(first);
+            int count = row - first;
+            
+            if(count > terminal->_ringRows - ringRow) {
+                
+                count = terminal->_ringRows - ringRow;
+            }
+            
+            terminal->_device->write(&terminal->_buffer[ringRow * columns], terminal->_origin + (terminal->_top + first) * columns, count * columns);
+            
+            first += count;
+        }
+    }
+    
+    terminal->clearDirty();
+    
+    int start = terminal->_origin + terminal->_top * columns;
+    
+    // the screen moved down the page after scrolling, or another terminal is shown
+    if(start != this->_start) {
+        
+        terminal->_device->showPage(terminal->_page, terminal->_top);
+        
+        this->_start = start;
+    }
+    
+    // show the frame at once
+    terminal->_device->present();
+}
+
+void Core::Console::scrollHistory(int rows) {
+    
+    unsigned long flags = this->_lock.lockIrqSave();
+    
+    if(this->_activeTerminal->_type == TERMINAL_TYPE_VIDEO && this->_activeTerminal->scrollView(rows)) {
+        
+        this->copyBuffer();
+    }
+    
+    this->_lock.unlockIrqRestore(flags);
 }
 
 void Core::Console::write(const char* sequence) {
     
-    this->_activeTerminal->write(sequence);
+    unsigned long length = 0;
     
-    // do we need to update a cursor?
-    if(this->_activeTerminal->_type == TERMINAL_TYPE_VIDEO) {
+    while(sequence[length] != 0) {
         
-        // put blinking character
-        this->_activeTerminal->put(this->_activeTerminal->_x, this->_activeTerminal->_y, ' ', this->_activeTerminal->_color | 1 << 15);
+        length++;
+    }
+    
+    this->writeBuffer(sequence, length);
+}
+
+void Core::Console::writeBuffer(const char* sequence, unsigned long length) {
+    
+    // interrupt handlers and softirqs print as well
+    unsigned long flags = this->_lock.lockIrqSave();
+    
+    this->append(sequence, length);
+    
+    this->_lock.unlockIrqRestore(flags);
+}
+
+void Core::Console::writeTerminal(Terminal* terminal, const char* sequence, unsigned long length) {
+    
+    unsigned long flags = this->_lock.lockIrqSave();
+    
+    if(terminal == this->_activeTerminal) {
         
-        unsigned position = this->_activeTerminal->_y * 80 + this->_activeTerminal->_x;
+        this->append(sequence, length);
+    }
+    else {
         
-        I386::writePortByte(0x3d4, 14);
-        I386::writePortByte(0x3d5, position >> 8);
-        I386::writePortByte(0x3d4, 15);
-        I386::writePortByte(0x3d5, position);
+        // the rows are marked dirty and copied when switching to the terminal
+        terminal->write(sequence, length);
     }
     
-    // copy new contents
-    this->copyBuffer();
+    this->_lock.unlockIrqRestore(flags);
 }
 
 void Core::Console::write(const char* sequence, short color) {
     
+    unsigned long length = 0;
+    
+    while(sequence[length] != 0) {
+        
+        length++;
+    }
+    
+    unsigned long flags = this->_lock.lockIrqSave();
+    
     short oldColor = this->_activeTerminal->_color;
     
-    this->_activeTerminal->setColor(color);
+    // escape sequences in the text may change the color further, only until the write ends
+    this->_activeTerminal->_color = color;
+    
+    this->append(sequence, length);
+    
+    this->_activeTerminal->_color = oldColor;
+    
+    this->_lock.unlockIrqRestore(flags);
+}
+
+void Core::Console::append(const char* sequence, unsigned long length) {
+    
+    // new output shows the live screen again
+    this->_activeTerminal->scrollView(-this->_activeTerminal->_view);
     
-    this->_activeTerminal->write(sequence);
+    this->_activeTerminal->write(sequence, length);
     
-    this->_activeTerminal->setColor(oldColor);
+    bool newline = false;
     
-    // do we need to update a cursor?
-    if(this->_activeTerminal->_type == TERMINAL_TYPE_VIDEO) {
+    for(unsigned long n = 0; n < length && !newline; n++) {
         
-        // put blinking character
-        this->_activeTerminal->put(this->_activeTerminal->_x, this->_activeTerminal->_y, ' ', this->_activeTerminal->_color | 1 << 15);
+        newline = sequence[n] == '\n';
+    }
+    
+    // a finished line is shown right away, partial lines wait for more output
+    if(newline) {
+        
+        this->flushLocked();
+    }
+    else if(!this->_flushArmed) {
         
-        unsigned position = this->_activeTerminal->_y * 80 + this->_activeTerminal->_x;
+        this->_flushArmed = true;
         
-        I386::writePortByte(0x3d4, 14);
-        I386::writePortByte(0x3d5, position >> 8);
-        I386::writePortByte(0x3d4, 15);
-        I386::writePortByte(0x3d5, position);
+        Core::TimerWheel::add(&this->_flushTimer, CONSOLE_FLUSH_DELAY);
+    }
+}
+
+void Core::Console::flush() {
+    
+    unsigned long flags = this->_lock.lockIrqSave();
+    
+    this->flushLocked();
+    
+    this->_lock.unlockIrqRestore(flags);
+}
+
+bool Core::Console::tryWrite(const char* sequence) {
+    
+    if(!this->_lock.tryLock()) {
+        
+        return false;
+    }
+    
+    Terminal* terminal = this->_activeTerminal;
+    
+    unsigned long length = 0;
+    
+    while(sequence[length] != 0) {
+        
+        length++;
+    }
+    
+    // no flush timer, the caller may not get to run it
+    terminal->scrollView(-terminal->_view);
+    terminal->write(sequence, length);
+    
+    this->flushLocked();
+    
+    this->_lock.unlock();
+    
+    return true;
+}
+
+void Core::Console::flushTimer(unsigned long data) {
+    
+    Console* console = _instance;
+    
+    unsigned long flags = console->_lock.lockIrqSave();
+    
+    // the timer is no longer queued, the next partial line may arm it again
+    console->_flushArmed = false;
+    
+    console->flushLocked();
+    
+    console->_lock.unlockIrqRestore(flags);
+}
+
+void Core::Console::flushLocked() {
+    
+    Terminal* terminal = this->_activeTerminal;
+    
+    // the hardware cursor blinks over the cell, the cell itself keeps its character
+    if(terminal->_type == TERMINAL_TYPE_VIDEO) {
+        
+        int position = terminal->_origin + (terminal->_top + terminal->_y) * terminal->_columns + terminal->_x;
+        
+        // every port write may trap on a VM, only move the cursor when it moved
+        if(position != this->_cursor) {
+            
+            I386::writePortByte(0x3d4, 14);
+            I386::writePortByte(0x3d5, position >> 8);
+            I386::writePortByte(0x3d4, 15);
+            I386::writePortByte(0x3d5, position);
+            
+            this->_cursor = position;
+        }
     }
     
     // copy new contents
@@ -76,6 +76,26 @@ void operator delete[] (void* address) {
     Core::KernelAllocator::getInstance()->free(reinterpret_cast<unsigned long>(address));
 }
 
+/*! Overload function for the sized C++ "delete" operator, newer standards call this one
+ *
+ *\param address A pointer to the memory that needs to be freed
+ *\param size The size of the object
+ */
+void operator delete (void* address, unsigned int size) {
+    
+    Core::KernelAllocator::getInstance()->free(reinterpret_cast<unsigned long>(address));
+}
+
+/*! Overload function for the sized C++ "delete[]" operator
+ *
+ *\param address A pointer to the memory that needs to be freed
+ *\param size The size of the array
+ */
+void operator delete[] (void* address, unsigned int size) {
+    
+    Core::KernelAllocator::getInstance()->free(reinterpret_cast<unsigned long>(address));
+}
+
 // declare C-safe callable function headers
 extern "C" {
     
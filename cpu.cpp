@@ -0,0 +1,65 @@
+/***************************************************************************
+ *            cpu.cpp
+ *
+ *  Copyright  2008  Matthias v.d. Vlies
+ *  matthias@mserver.nl
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*! \file cpu.cpp
+ *  \brief Processor identification
+ *   
+ *  This file implements the CPU class.
+ *
+ */
+
+#include <core/cpu.h>
+#include <I386/i386.h>
+
+// the boot processor runs alone until told otherwise
+unsigned int Core::CPU::_count = 1;
+
+// the boot processor runs this code
+volatile unsigned long Core::CPU::_online = 1;
+
+unsigned int Core::CPU::getCount() {
+    
+    return _count;
+}
+
+void Core::CPU::registerProcessor(unsigned int cpu, unsigned int hardwareId) {
+    
+    Core::PerCPU::initialise(cpu);
+    
+    Core::PerCPU::getArea(cpu)->hardwareId = hardwareId;
+    
+    if(cpu >= _count) {
+        
+        _count = cpu + 1;
+    }
+}
+
+void Core::CPU::setOnline(unsigned int cpu) {
+    
+    I386::atomicOr(&_online, 1UL << cpu);
+}
+
+bool Core::CPU::isOnline(unsigned int cpu) {
+    
+    return (_online & (1UL << cpu)) != 0;
+}
@@ -0,0 +1,549 @@
+/***************************************************************************
+ *            format.cpp
+ *
+ *  Copyright  2008  Matthias v.d. Vlies
+ *  matthias@mserver.nl
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+
+/*! \file format.cpp
+ *  \brief Formatted output
+ *   
+ *  This file implements printf style formatting without heap allocation.
+ *
+ */
+
+#include <core/format.h>
+#include <core/console.h>
+
+// the two digits of 0 to 99
+static const char decimalPairs[] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+// the two digits of 0x00 to 0xff, in lower and upper case
+static const char hexPairs[2][513] = {
+    {
+        "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f"
+        "202122232425262728292a2b2c2d2e2f303132333435363738393a3b3c3d3e3f"
+        "404142434445464748494a4b4c4d4e4f505152535455565758595a5b5c5d5e5f"
+        "606162636465666768696a6b6c6d6e6f707172737475767778797a7b7c7d7e7f"
+        "808182838485868788898a8b8c8d8e8f909192939495969798999a9b9c9d9e9f"
+        "a0a1a2a3a4a5a6a7a8a9aaabacadaeafb0b1b2b3b4b5b6b7b8b9babbbcbdbebf"
+        "c0c1c2c3c4c5c6c7c8c9cacbcccdcecfd0d1d2d3d4d5d6d7d8d9dadbdcdddedf"
+        "e0e1e2e3e4e5e6e7e8e9eaebecedeeeff0f1f2f3f4f5f6f7f8f9fafbfcfdfeff"
+    },
+    {
+        "000102030405060708090A0B0C0D0E0F101112131415161718191A1B1C1D1E1F"
+        "202122232425262728292A2B2C2D2E2F303132333435363738393A3B3C3D3E3F"
+        "404142434445464748494A4B4C4D4E4F505152535455565758595A5B5C5D5E5F"
+        "606162636465666768696A6B6C6D6E6F707172737475767778797A7B7C7D7E7F"
+        "808182838485868788898A8B8C8D8E8F909192939495969798999A9B9C9D9E9F"
+        "A0A1A2A3A4A5A6A7A8A9AAABACADAEAFB0B1B2B3B4B5B6B7B8B9BABBBCBDBEBF"
+        "C0C1C2C3C4C5C6C7C8C9CACBCCCDCECFD0D1D2D3D4D5D6D7D8D9DADBDCDDDEDF"
+        "E0E1E2E3E4E5E6E7E8E9EAEBECEDEEEFF0F1F2F3F4F5F6F7F8F9FAFBFCFDFEFF"
+    }
+};
+
+/*! \struct FormatState
+ *\brief FormatState
+ *
+ * Text formatted so far by Format::print(), handed out when the buffer fills up
+ */
+struct FormatState {
+    
+    /*! The function receiving the text */
+    Core::FormatOutput output;
+    
+    /*! Passed to the output */
+    void* data;
+    
+    /*! Number of characters in the buffer */
+    unsigned long used;
+    
+    /*! The formatted characters */
+    char buffer[FORMAT_BUFFER_SIZE];
+};
+
+/*! \struct FormatString
+ *\brief FormatString
+ *
+ * Destination of Format::stringList()
+ */
+struct FormatString {
+    
+    /*! The buffer */
+    char* buffer;
+    
+    /*! Characters the buffer holds besides the terminator */
+    unsigned long size;
+    
+    /*! Number of characters in the buffer */
+    unsigned long used;
+};
+
+/*! Function to hand the buffered text to the output
+ *
+ *\param state The formatting state
+ */
+static void flushState(FormatState* state) {
+    
+    if(state->used != 0) {
+        
+        state->output(state->data, state->buffer, state->used);
+        state->used = 0;
+    }
+}
+
+/*! Function to add text to the buffer
+ *
+ *\param state The formatting state
+ *\param text The text
+ *\param length The number of characters
+ */
+static void emit(FormatState* state, const char* text, unsigned long length) {
+    
+    for(unsigned long n = 0; n < length; n++) {
+        
+        if(state->used == FORMAT_BUFFER_SIZE) {
+            
+            flushState(state);
+        }
+        
+        state->buffer[state->used++] = text[n];
+    }
+}
+
+/*! Function to add a character several times to the buffer
+ *
+ *\param state The formatting state
+ *\param c The character
+ *\param count The number of times
+ */
+static void pad(FormatState* state, char c, unsigned long count) {
+    
+    for(unsigned long n = 0; n < count; n++) {
+        
+        emit(state, &c, 1);
+    }
+}
+
+/*! Function to add a converted argument to the buffer, padded to the field width
+ *
+ *\param state The formatting state
+ *\param prefix Sign or base going in front of any zeros
+ *\param text The converted argument
+ *\param length The number of characters of the argument
+ *\param width The field width
+ *\param left Wether to align the argument to the left
+ *\param zero Wether to pad with zeros
+ */
+static void field(FormatState* state, const char* prefix, const char* text, unsigned long length, unsigned long width, bool left, bool zero) {
+    
+    unsigned long prefixLength = 0;
+    
+    while(prefix[prefixLength] != 0) {
+        
+        prefixLength++;
+    }
+    
+    unsigned long total = prefixLength + length;
+    unsigned long fill = width > total ? width - total : 0;
+    
+    if(!left && !zero) {
+        
+        pad(state, ' ', fill);
+    }
+    
+    emit(state, prefix, prefixLength);
+    
+    if(!left && zero) {
+        
+        pad(state, '0', fill);
+    }
+    
+    emit(state, text, length);
+    
+    if(left) {
+        
+        pad(state, ' ', fill);
+    }
+}
+
+/*! Output of Format::stringList(), copies what fits
+ *
+ *\param data The FormatString
+ *\param text The text
+ *\param length The number of characters
+ */
+static void appendString(void* data, const char* text, unsigned long length) {
+    
+    FormatString* string = static_cast<FormatString*>(data);
+    
+    for(unsigned long n = 0; n < length && string->used < string->size; n++) {
+        
+        string->buffer[string->used++] = text[n];
+    }
+}
+
+/*! Output of kprintf()
+ *
+ *\param data Unused
+ *\param text The text
+ *\param length The number of characters
+ */
+static void writeConsole(void* data, const char* text, unsigned long length) {
+    
+    Core::Console::getInstance()->writeBuffer(text, length);
+}
+
+unsigned long Core::Format::divide(unsigned long long* value, unsigned long divisor) {
+    
+    unsigned long high = static_cast<unsigned long>(*value >> 32);
+    unsigned long low = static_cast<unsigned long>(*value);
+    
+    unsigned long quotientHigh = high / divisor;
+    unsigned long remainder = high % divisor;
+    unsigned long quotientLow;
+    
+    // the remainder is below the divisor, so the quotient fits in 32 bits
+    asm("divl %4" : "=a" (quotientLow), "=d" (remainder) : "a" (low), "d" (remainder), "rm" (divisor));
+    
+    *value = (static_cast<unsigned long long>(quotientHigh) << 32) | quotientLow;
+    
+    return remainder;
+}
+
+unsigned long Core::Format::toDecimal(unsigned long long value, char* buffer) {
+    
+    char digits[FORMAT_NUMBER_SIZE];
+    char* end = digits + FORMAT_NUMBER_SIZE;
+    char* p = end;
+    
+    // two digits at a time, 64 bit division only while the value needs it
+    while(value > 0xffffffffULL) {
+        
+        unsigned long pair = divide(&value, 100);
+        
+        p -= 2;
+        p[0] = decimalPairs[pair * 2];
+        p[1] = decimalPairs[pair * 2 + 1];
+    }
+    
+    unsigned long low = static_cast<unsigned long>(value);
+    
+    while(low >= 100) {
+        
+        unsigned long pair = low % 100;
+        
+        low /= 100;
+        
+        p -= 2;
+        p[0] = decimalPairs[pair * 2];
+        p[1] = decimalPairs[pair * 2 + 1];
+    }
+    
+    // the leading digits, without a zero in front
+    if(low >= 10) {
+        
+        p -= 2;
+        p[0] = decimalPairs[low * 2];
+        p[1] = decimalPairs[low * 2 + 1];
+    }
+    else {
+        
+        *--p = '0' + low;
+    }
+    
+    unsigned long length = end - p;
+    
+    for(unsigned long n = 0; n < length; n++) {
+        
+        buffer[n] = p[n];
+    }
+    
+    buffer[length] = 0;
+    
+    return length;
+}
+
+unsigned long Core::Format::toHex(unsigned long long value, char* buffer, bool upper) {
+    
+    const char* pairs = hexPairs[upper ? 1 : 0];
+    
+    char digits[FORMAT_NUMBER_SIZE];
+    char* end = digits + FORMAT_NUMBER_SIZE;
+    char* p = end;
+    
+    // a byte at a time
+    do {
+        
+        unsigned long pair = static_cast<unsigned long>(value & 0xff);
+        
+        p -= 2;
+        p[0] = pairs[pair * 2];
+        p[1] = pairs[pair * 2 + 1];
+        
+        value >>= 8;
+        
+    } while(value != 0);
+    
+    // drop a leading zero, but keep the digit of 0
+    if(*p == '0' && p + 1 != end) {
+        
+        p++;
+    }
+    
+    unsigned long length = end - p;
+    
+    for(unsigned long n = 0; n < length; n++) {
+        
+        buffer[n] = p[n];
+    }
+    
+    buffer[length] = 0;
+    
+    return length;
+}
+
+void Core::Format::print(FormatOutput output, void* data, const char* format, FormatArguments arguments) {
+    
+    FormatState state;
+    
+    state.output = output;
+    state.data = data;
+    state.used = 0;
+    
+    char number[FORMAT_NUMBER_SIZE];
+    
+    while(*format != 0) {
+        
+        // copy the text up to the next conversion in one piece
+        const char* text = format;
+        
+        while(*format != 0 && *format != '%') {
+            
+            format++;
+        }
+        
+        emit(&state, text, format - text);
+        
+        if(*format == 0) {
+            
+            break;
+        }
+        
+        const char* conversion = format++;
+        
+        bool left = false;
+        bool zero = false;
+        
+        for(;; format++) {
+            
+            if(*format == '-') {
+                
+                left = true;
+            }
+            else if(*format == '0') {
+                
+                zero = true;
+            }
+            else {
+                
+                break;
+            }
+        }
+        
+        unsigned long width = 0;
+        
+        while(*format >= '0' && *format <= '9') {
+            
+            width = width * 10 + (*format++ - '0');
+        }
+        
+        // number of l modifiers
+        int size = 0;
+        
+        while(*format == 'l') {
+            
+            size++;
+            format++;
+        }
+        
+        switch(*format) {
+            
+            case 'd':
+            case 'i': {
+                
+                long long value;
+                
+                if(size >= 2) {
+                    
+                    value = __builtin_va_arg(arguments, long long);
+                }
+                else if(size == 1) {
+                    
+                    value = __builtin_va_arg(arguments, long);
+                }
+                else {
+                    
+                    value = __builtin_va_arg(arguments, int);
+                }
+                
+                // negate unsigned, the most negative value has no positive counterpart
+                unsigned long long magnitude = value < 0 ? 0ULL - static_cast<unsigned long long>(value) : value;
+                unsigned long length = toDecimal(magnitude, number);
+                
+                field(&state, value < 0 ? "-" : "", number, length, width, left, zero);
+                break;
+            }
+            
+            case 'u':
+            case 'x':
+            case 'X': {
+                
+                unsigned long long value;
+                
+                if(size >= 2) {
+                    
+                    value = __builtin_va_arg(arguments, unsigned long long);
+                }
+                else if(size == 1) {
+                    
+                    value = __builtin_va_arg(arguments, unsigned long);
+                }
+                else {
+                    
+                    value = __builtin_va_arg(arguments, unsigned int);
+                }
+                
+                unsigned long length = *format == 'u' ? toDecimal(value, number) : toHex(value, number, *format == 'X');
+                
+                field(&state, "", number, length, width, left, zero);
+                break;
+            }
+            
+            case 'p': {
+                
+                unsigned long length = toHex(reinterpret_cast<unsigned long>(__builtin_va_arg(arguments, void*)), number, false);
+                
+                field(&state, "0x", number, length, width, left, zero);
+                break;
+            }
+            
+            case 'c': {
+                
+                char c = static_cast<char>(__builtin_va_arg(arguments, int));
+                
+                field(&state, "", &c, 1, width, left, false);
+                break;
+            }
+            
+            case 's': {
+                
+                const char* string = __builtin_va_arg(arguments, const char*);
+                
+                if(string == 0) {
+                    
+                    string = "(null)";
+                }
+                
+                unsigned long length = 0;
+                
+                while(string[length] != 0) {
+                    
+                    length++;
+                }
+                
+                field(&state, "", string, length, width, left, false);
+                break;
+            }
+            
+            case '%':
+                emit(&state, "%", 1);
+                break;
+            
+            // unknown conversions are printed as they are
+            default:
+                if(*format == 0) {
+                    
+                    emit(&state, conversion, format - conversion);
+                    
+                    flushState(&state);
+                    
+                    return;
+                }
+                
+                emit(&state, conversion, format - conversion + 1);
+                break;
+        }
+        
+        format++;
+    }
+    
+    flushState(&state);
+}
+
+unsigned long Core::Format::string(char* buffer, unsigned long size, const char* format, ...) {
+    
+    FormatArguments arguments;
+    
+    __builtin_va_start(arguments, format);
+    
+    unsigned long length = stringList(buffer, size, format, arguments);
+    
+    __builtin_va_end(arguments);
+    
+    return length;
+}
+
+unsigned long Core::Format::stringList(char* buffer, unsigned long size, const char* format, FormatArguments arguments) {
+    
+    if(size == 0) {
+        
+        return 0;
+    }
+    
+    FormatString string;
+    
+    // room for the terminator
+    string.buffer = buffer;
+    string.size = size - 1;
+    string.used = 0;
+    
+    print(appendString, &string, format, arguments);
+    
+    buffer[string.used] = 0;
+    
+    return string.used;
+}
+
+void Core::kprintf(const char* format, ...) {
+    
+    FormatArguments arguments;
+    
+    __builtin_va_start(arguments, format);
+    
+    Format::print(writeConsole, 0, format, arguments);
+    
+    __builtin_va_end(arguments);
+}
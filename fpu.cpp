@@ -0,0 +1,394 @@
+/***************************************************************************
+ *            fpu.cpp
+ *
+ *  Copyright  2008  Matthias v.d. Vlies
+ *  matthias@mserver.nl
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*! \file fpu.cpp
+ *  \brief FPU Manager
+ *   
+ * This file implements the FPU class. It enables x87/SSE and handles lazy FPU context switching.
+ *
+ */
+
+#include <I386/fpu.h>
+#include <I386/idt.h>
+#include <core/cpu.h>
+#include <core/preempt.h>
+#include <errors.h>
+
+// set instance pointer to a null pointer
+I386::FPU* I386::FPU::_instance = 0;
+I386::FPU* I386::FPU::_started = 0;
+
+I386::FPU* I386::FPU::getInstance() {
+    
+    // check for exsisting instance
+    if(_instance == 0) {
+        
+        // none found, create new instance
+        _instance = new FPU();
+        
+        // check if we got a valid address
+        if(_instance == reinterpret_cast<FPU*>(E_ALLOC_NOMEM)) {
+            
+            _instance = 0;
+            
+            // no, major oops here!
+            return E_FAILURE;
+        }
+        
+        // auto register
+        Core::ResourceManager::getInstance()->registerResource(_instance);
+    }
+    
+    // return the instance
+    return _instance;
+}
+
+I386::FPU* I386::FPU::getStarted() {
+    
+    return _started;
+}
+
+I386::FPU::FPU() {
+    
+    this->_sse = false;
+    this->_xsave = false;
+    this->_xsaveMask = 0;
+    this->_contextSize = 0;
+    this->_cleanContext = 0;
+    
+    for(int n = 0; n < MAX_CPUS; n++) {
+        
+        this->_owner[n] = 0;
+        this->_current[n] = 0;
+        this->_kernelUse[n] = false;
+    }
+}
+
+unsigned long I386::FPU::startResource() {
+    
+    unsigned long registers[4];
+    
+    I386::cpuid(1, 0, registers);
+    
+    // no FPU at all?
+    if(!(registers[3] & 0x01)) {
+        
+        return E_FAILURE;
+    }
+    
+    // FXSAVE and SSE
+    if((registers[3] & (1 << 24)) && (registers[3] & (1 << 25))) {
+        
+        this->_sse = true;
+        this->_contextSize = FPU_FXSAVE_SIZE;
+        
+        // XSAVE
+        if(registers[2] & (1 << 26)) {
+            
+            // which components does the processor support?
+            I386::cpuid(0x0d, 0, registers);
+            
+            this->_xsaveMask = registers[0] & (XCR0_X87 | XCR0_SSE | XCR0_AVX);
+            this->_xsave = true;
+        }
+    }
+    else {
+        
+        // FNSAVE area
+        this->_contextSize = 108;
+    }
+    
+    this->initialiseProcessor();
+    
+    // size of the area for the enabled components
+    if(this->_xsave) {
+        
+        I386::cpuid(0x0d, 0, registers);
+        
+        this->_contextSize = registers[1];
+    }
+    
+    // keep the state after initialisation as template for new contexts
+    asm volatile("clts");
+    
+    this->_cleanContext = this->allocateContext();
+    
+    if(this->_cleanContext == 0) {
+        
+        return E_FAILURE;
+    }
+    
+    this->save(this->_cleanContext);
+    
+    // nobody owns the registers, first use traps
+    I386::IDT::getInstance()->registerHandler(FPU_NM_VECTOR, I386::FPU::deviceNotAvailable);
+    
+    _write_cr0(_read_cr0() | CR0_TS);
+    
+    // from now on kernel users may borrow the registers
+    _started = this;
+    
+    return E_SUCCESS;
+}
+
+void I386::FPU::initialiseProcessor() {
+    
+    // use the FPU natively and let WAIT/FPU instructions trap when TS is set
+    _write_cr0((_read_cr0() & ~(CR0_EM | CR0_TS)) | CR0_MP | CR0_NE);
+    
+    asm volatile("fninit");
+    
+    if(this->_sse) {
+        
+        _write_cr4(_read_cr4() | CR4_OSFXSR | CR4_OSXMMEXCPT);
+    }
+    
+    if(this->_xsave) {
+        
+        _write_cr4(_read_cr4() | CR4_OSXSAVE);
+        
+        unsigned long low = this->_xsaveMask;
+        unsigned long high = 0;
+        
+        asm volatile("xsetbv" : : "a" (low), "d" (high), "c" (0));
+    }
+    
+    // the first FPU instruction of a task traps and loads its context
+    _write_cr0(_read_cr0() | CR0_TS);
+}
+
+const char* I386::FPU::getResourceName() {
+    
+    if(this->_xsave) {
+        
+        return "FPU (x87/SSE, XSAVE)";
+    }
+    
+    if(this->_sse) {
+        
+        return "FPU (x87/SSE, FXSAVE)";
+    }
+    
+    return "FPU (x87)";
+}
+
+bool I386::FPU::hasSSE() {
+    
+    return this->_sse;
+}
+
+void* I386::FPU::allocateContext() {
+    
+    unsigned char* memory = new unsigned char[this->_contextSize + FPU_CONTEXT_ALIGN - 1 + sizeof(unsigned char*)];
+    
+    // check if we got a valid address
+    if(memory == reinterpret_cast<unsigned char*>(E_ALLOC_NOMEM)) {
+        
+        return 0;
+    }
+    
+    unsigned char* context = reinterpret_cast<unsigned char*>((reinterpret_cast<unsigned long>(memory + sizeof(unsigned char*)) + FPU_CONTEXT_ALIGN - 1) & ~(FPU_CONTEXT_ALIGN - 1));
+    
+    // remember the allocation in front of the aligned area for freeContext()
+    reinterpret_cast<unsigned char**>(context)[-1] = memory;
+    
+    // the XSAVE header must be zero, the clean state fills in the rest
+    for(unsigned long n = 0; n < this->_contextSize; n++) {
+        
+        context[n] = (this->_cleanContext != 0) ? static_cast<unsigned char*>(this->_cleanContext)[n] : 0;
+    }
+    
+    return context;
+}
+
+void I386::FPU::freeContext(void* context) {
+    
+    delete[] static_cast<unsigned char**>(context)[-1];
+}
+
+void I386::FPU::save(void* context) {
+    
+    if(this->_xsave) {
+        
+        unsigned long low = this->_xsaveMask;
+        unsigned long high = 0;
+        
+        asm volatile("xsave (%0)" : : "r" (context), "a" (low), "d" (high) : "memory");
+    }
+    else if(this->_sse) {
+        
+        asm volatile("fxsave (%0)" : : "r" (context) : "memory");
+    }
+    else {
+        
+        asm volatile("fnsave (%0); fwait" : : "r" (context) : "memory");
+    }
+}
+
+void I386::FPU::restore(void* context) {
+    
+    if(this->_xsave) {
+        
+        unsigned long low = this->_xsaveMask;
+        unsigned long high = 0;
+        
+        asm volatile("xrstor (%0)" : : "r" (context), "a" (low), "d" (high) : "memory");
+    }
+    else if(this->_sse) {
+        
+        asm volatile("fxrstor (%0)" : : "r" (context) : "memory");
+    }
+    else {
+        
+        asm volatile("frstor (%0)" : : "r" (context) : "memory");
+    }
+}
+
+void I386::FPU::switchTo(void* context) {
+    
+    unsigned int cpu = Core::CPU::getCurrentId();
+    
+    this->_current[cpu] = context;
+    
+    // the registers still hold this context, no need to trap
+    if(context != 0 && this->_owner[cpu] == context) {
+        
+        asm volatile("clts");
+    }
+    else {
+        
+        _write_cr0(_read_cr0() | CR0_TS);
+    }
+}
+
+void I386::FPU::forget(void* context) {
+    
+    unsigned long flags = I386::saveFlags();
+    
+    for(int n = 0; n < MAX_CPUS; n++) {
+        
+        if(this->_owner[n] == context) {
+            
+            this->_owner[n] = 0;
+        }
+    }
+    
+    I386::restoreFlags(flags);
+}
+
+bool I386::FPU::isLoaded(void* context) {
+    
+    // tasks without a context throw their registers away
+    if(context == 0) {
+        
+        return false;
+    }
+    
+    for(int n = 0; n < MAX_CPUS; n++) {
+        
+        if(this->_owner[n] == context) {
+            
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+bool I386::FPU::beginKernelUse() {
+    
+    if(!this->_sse) {
+        
+        return false;
+    }
+    
+    Core::Preempt::disable();
+    
+    unsigned long flags = I386::saveFlags();
+    
+    unsigned int cpu = Core::CPU::getCurrentId();
+    
+    // an inner section would clobber the registers of the outer one and its end would
+    // set CR0.TS under it
+    if(this->_kernelUse[cpu]) {
+        
+        I386::restoreFlags(flags);
+        
+        Core::Preempt::enable();
+        
+        return false;
+    }
+    
+    this->_kernelUse[cpu] = true;
+    
+    asm volatile("clts");
+    
+    // park the registers of their owner, the kernel is going to clobber them
+    if(this->_owner[cpu] != 0) {
+        
+        this->save(this->_owner[cpu]);
+        this->_owner[cpu] = 0;
+    }
+    
+    I386::restoreFlags(flags);
+    
+    return true;
+}
+
+void I386::FPU::endKernelUse() {
+    
+    // the current task reloads its registers on its next FPU instruction
+    _write_cr0(_read_cr0() | CR0_TS);
+    
+    // preemption is still disabled, we are on the same processor
+    this->_kernelUse[Core::CPU::getCurrentId()] = false;
+    
+    Core::Preempt::enable();
+}
+
+void I386::FPU::deviceNotAvailable(struct Registers* registers) {
+    
+    FPU* fpu = _instance;
+    
+    unsigned int cpu = Core::CPU::getCurrentId();
+    
+    asm volatile("clts");
+    
+    void* current = fpu->_current[cpu];
+    
+    if(fpu->_owner[cpu] == current && current != 0) {
+        
+        return;
+    }
+    
+    // store the registers of the previous owner
+    if(fpu->_owner[cpu] != 0) {
+        
+        fpu->save(fpu->_owner[cpu]);
+    }
+    
+    // tasks without a context get a clean state that is thrown away
+    fpu->restore(current != 0 ? current : fpu->_cleanContext);
+    
+    fpu->_owner[cpu] = current;
+}
@@ -0,0 +1,466 @@
+/***************************************************************************
+ *            framebuffer.cpp
+ *
+ *  Copyright  2008  Matthias v.d. Vlies
+ *  matthias@mserver.nl
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+
+/*! \file framebuffer.cpp
+ *  \brief Linear framebuffer text device
+ *   
+ *  This file implements drawing text cells on a linear framebuffer.
+ *
+ */
+
+#include <core/framebuffer.h>
+#include <core/terminal.h>
+#include <config.h>
+#include <errors.h>
+
+// the SSE registers can only be named as clobbers when the compiler may use them
+#ifdef __SSE2__
+#define FRAMEBUFFER_XMM_CLOBBERS                , "xmm0", "xmm1", "xmm2", "xmm3"
+#else
+#define FRAMEBUFFER_XMM_CLOBBERS
+#endif
+
+// set instance pointer to a null pointer
+Core::Framebuffer* Core::Framebuffer::_instance = 0;
+
+// filled by expandMasks() when a mode is set
+unsigned long Core::Framebuffer::_masks[256][FONT_WIDTH];
+
+// the colours of the VGA text mode
+const unsigned long Core::Framebuffer::_palette[FRAMEBUFFER_COLORS] = {
+    0x000000, 0x0000aa, 0x00aa00, 0x00aaaa, 0xaa0000, 0xaa00aa, 0xaa5500, 0xaaaaaa,
+    0x555555, 0x5555ff, 0x55ff55, 0x55ffff, 0xff5555, 0xff55ff, 0xffff55, 0xffffff
+};
+
+Core::Framebuffer* Core::Framebuffer::getInstance() {
+    
+    // check for exsisting instance
+    if(_instance == 0) {
+        
+        // none found, create new instance
+        _instance = new Framebuffer();
+        
+        // check if we got a valid address
+        if(_instance == reinterpret_cast<Framebuffer*>(E_ALLOC_NOMEM)) {
+            
+            _instance = 0;
+            
+            // no, major oops here!
+            return E_FAILURE;
+        }
+    }
+    
+    // return the instance
+    return _instance;
+}
+
+Core::Framebuffer::Framebuffer() {
+    
+    this->_base = 0;
+    this->_pitch = 0;
+    this->_width = 0;
+    this->_height = 0;
+    this->_columns = 0;
+    this->_rows = 0;
+    this->_cells = 0;
+    this->_display = 0;
+    this->_page = 0;
+    this->_fpu = 0;
+    
+    for(int page = 0; page < FRAMEBUFFER_PAGES; page++) {
+        
+        this->_shadows[page] = 0;
+    }
+}
+
+void Core::Framebuffer::expandMasks() {
+    
+    for(int bits = 0; bits < 256; bits++) {
+        
+        // the most significant bit is the leftmost pixel
+        for(int x = 0; x < FONT_WIDTH; x++) {
+            
+            _masks[bits][x] = (bits & (0x80 >> x)) ? 0xffffffff : 0;
+        }
+    }
+}
+
+unsigned long Core::Framebuffer::setMode(unsigned long address, unsigned long pitch, unsigned long width, unsigned long height, unsigned long depth) {
+    
+    // a pixel has to fit in a single store
+    if(depth != FRAMEBUFFER_DEPTH || width < FRAMEBUFFER_CELL_WIDTH || height < FRAMEBUFFER_CELL_HEIGHT) {
+        
+        return E_FAILURE;
+    }
+    
+    unsigned long columns = width / FRAMEBUFFER_CELL_WIDTH;
+    unsigned long rows = height / FRAMEBUFFER_CELL_HEIGHT;
+    
+    short* shadow = new short[columns * rows];
+    
+    // check if we got a valid address
+    if(shadow == reinterpret_cast<short*>(E_ALLOC_NOMEM)) {
+        
+        return E_FAILURE;
+    }
+    
+    expandMasks();
+    
+    this->_base = reinterpret_cast<unsigned char*>(address);
+    this->_pitch = pitch;
+    this->_width = width;
+    this->_height = height;
+    this->_columns = columns;
+    this->_rows = rows;
+    this->_shadows[0] = shadow;
+    
+    this->clearBuffer();
+    
+    return E_SUCCESS;
+}
+
+unsigned long Core::Framebuffer::enableFlipping(BochsDisplay* display) {
+    
+    if(this->_base == 0 || this->_display != 0) {
+        
+        return E_FAILURE;
+    }
+    
+    // the pages lie below each other in video memory
+    if(display->setPages(this->_width, this->_height, FRAMEBUFFER_DEPTH, FRAMEBUFFER_PAGES) != E_SUCCESS) {
+        
+        return E_FAILURE;
+    }
+    
+    unsigned long cells = this->_columns * this->_rows;
+    
+    short* pending = new short[cells];
+    short* shadow = new short[cells];
+    
+    // check if we got valid addresses
+    if(pending == reinterpret_cast<short*>(E_ALLOC_NOMEM) || shadow == reinterpret_cast<short*>(E_ALLOC_NOMEM)) {
+        
+        return E_FAILURE;
+    }
+    
+    this->_cells = pending;
+    this->_shadows[1] = shadow;
+    this->_display = display;
+    
+    // the first page is on screen, the next frame goes to the second
+    this->_page = 1;
+    
+    // the second page starts out black
+    for(unsigned long y = this->_height; y < this->_height * FRAMEBUFFER_PAGES; y++) {
+        
+        unsigned long* line = reinterpret_cast<unsigned long*>(this->_base + y * this->_pitch);
+        
+        for(unsigned long x = 0; x < this->_width; x++) {
+            
+            line[x] = 0;
+        }
+    }
+    
+    // keep what is on screen
+    for(unsigned long n = 0; n < cells; n++) {
+        
+        this->_cells[n] = this->_shadows[0][n];
+        this->_shadows[1][n] = 0;
+    }
+    
+    return E_SUCCESS;
+}
+
+void Core::Framebuffer::clearBuffer() {
+    
+    if(this->_base == 0) {
+        
+        return;
+    }
+    
+    unsigned long pages = this->_display != 0 ? FRAMEBUFFER_PAGES : 1;
+    
+    // paint every line of every page black
+    for(unsigned long y = 0; y < this->_height * pages; y++) {
+        
+        unsigned long* line = reinterpret_cast<unsigned long*>(this->_base + y * this->_pitch);
+        
+        for(unsigned long x = 0; x < this->_width; x++) {
+            
+            line[x] = 0;
+        }
+    }
+    
+    // a zero cell is black as well
+    for(unsigned long page = 0; page < pages; page++) {
+        
+        for(unsigned long n = 0; n < this->_columns * this->_rows; n++) {
+            
+            this->_shadows[page][n] = 0;
+        }
+    }
+}
+
+void Core::Framebuffer::drawCell(unsigned long page, unsigned long position, short cell, bool simd) {
+    
+    unsigned char character = cell & 0xff;
+    unsigned char attribute = (cell >> 8) & 0xff;
+    
+    // the font only covers ASCII
+    if(character >= FONT_GLYPHS) {
+        
+        character = '?';
+    }
+    
+    // the blink bit is ignored
+    unsigned long foreground = _palette[attribute & 0x0f];
+    unsigned long background = _palette[(attribute >> 4) & 0x07];
+    unsigned long difference = foreground ^ background;
+    
+    unsigned long x = position % this->_columns;
+    unsigned long y = position / this->_columns;
+    
+    unsigned char* target = this->_base + (page * this->_height + y * FRAMEBUFFER_CELL_HEIGHT) * this->_pitch + x * FRAMEBUFFER_CELL_WIDTH * sizeof(unsigned long);
+    
+    const unsigned char* glyph = fontGlyphs[character];
+    
+    if(simd) {
+        
+        // a pixel is background ^ (mask & (foreground ^ background))
+        unsigned long colors[8] = {
+            difference, difference, difference, difference,
+            background, background, background, background
+        };
+        
+        for(int row = 0; row < FONT_HEIGHT; row++) {
+            
+            // expand the row to eight pixels and store it on two lines
+            asm volatile(
+                "movdqa (%1), %%xmm0\n\t"
+                "movdqa 16(%1), %%xmm1\n\t"
+                "movdqu (%2), %%xmm2\n\t"
+                "movdqu 16(%2), %%xmm3\n\t"
+                "pand %%xmm2, %%xmm0\n\t"
+                "pand %%xmm2, %%xmm1\n\t"
+                "pxor %%xmm3, %%xmm0\n\t"
+                "pxor %%xmm3, %%xmm1\n\t"
+                "movdqu %%xmm0, (%0)\n\t"
+                "movdqu %%xmm1, 16(%0)\n\t"
+                "movdqu %%xmm0, (%0,%3)\n\t"
+                "movdqu %%xmm1, 16(%0,%3)"
+                : : "r" (target), "r" (_masks[glyph[row]]), "r" (colors), "r" (this->_pitch)
+                : "memory" FRAMEBUFFER_XMM_CLOBBERS);
+            
+            target += 2 * this->_pitch;
+        }
+        
+        return;
+    }
+    
+    for(int row = 0; row < FONT_HEIGHT; row++) {
+        
+        const unsigned long* mask = _masks[glyph[row]];
+        
+        unsigned long* upper = reinterpret_cast<unsigned long*>(target);
+        unsigned long* lower = reinterpret_cast<unsigned long*>(target + this->_pitch);
+        
+        for(int n = 0; n < FONT_WIDTH; n++) {
+            
+            unsigned long pixel = background ^ (mask[n] & difference);
+            
+            upper[n] = pixel;
+            lower[n] = pixel;
+        }
+        
+        target += 2 * this->_pitch;
+    }
+}
+
+bool Core::Framebuffer::beginSimd() {
+    
+    // scalar drawing until the FPU resource has been started
+    if(this->_fpu == 0) {
+        
+        this->_fpu = I386::FPU::getStarted();
+        
+        if(this->_fpu == 0) {
+            
+            return false;
+        }
+    }
+    
+    return this->_fpu->beginKernelUse();
+}
+
+unsigned long Core::Framebuffer::write(void* buffer, unsigned long size) {
+    
+    // check for buffer overflow
+    if(size != this->_columns * this->_rows) {
+        
+        return E_BUFFER_OVERFLOW;
+    }
+    
+    return this->write(buffer, 0, size);
+}
+
+unsigned long Core::Framebuffer::write(void* buffer, unsigned long offset, unsigned long size) {
+    
+    unsigned long cells = this->_columns * this->_rows;
+    
+    // check for buffer overflow
+    if(offset > cells || size > cells - offset) {
+        
+        return E_BUFFER_OVERFLOW;
+    }
+    
+    short* sourceBuffer = static_cast<short*>(buffer);
+    
+    // when flipping, the cells wait for present() to draw them off-screen
+    if(this->_display != 0) {
+        
+        for(unsigned long n = 0; n < size; n++) {
+            
+            this->_cells[offset + n] = sourceBuffer[n];
+        }
+        
+        return E_SUCCESS;
+    }
+    
+    bool started = false;
+    bool simd = false;
+    
+    for(unsigned long n = 0; n < size; n++) {
+        
+        // drawing a cell costs hundreds of stores, skip the ones already on screen
+        if(this->_shadows[0][offset + n] == sourceBuffer[n]) {
+            
+            continue;
+        }
+        
+        // only claim the SSE registers when there is something to draw
+        if(!started) {
+            
+            simd = this->beginSimd();
+            started = true;
+        }
+        
+        this->drawCell(0, offset + n, sourceBuffer[n], simd);
+        this->_shadows[0][offset + n] = sourceBuffer[n];
+    }
+    
+    if(simd) {
+        
+        this->_fpu->endKernelUse();
+    }
+    
+    return E_SUCCESS;
+}
+
+void Core::Framebuffer::present() {
+    
+    if(this->_display == 0) {
+        
+        return;
+    }
+    
+    short* shadow = this->_shadows[this->_page];
+    
+    bool started = false;
+    bool simd = false;
+    
+    // the hidden page still holds the frame before the one on screen, catch up with both
+    for(unsigned long n = 0; n < this->_columns * this->_rows; n++) {
+        
+        if(shadow[n] == this->_cells[n]) {
+            
+            continue;
+        }
+        
+        if(!started) {
+            
+            simd = this->beginSimd();
+            started = true;
+        }
+        
+        this->drawCell(this->_page, n, this->_cells[n], simd);
+        shadow[n] = this->_cells[n];
+    }
+    
+    if(simd) {
+        
+        this->_fpu->endKernelUse();
+    }
+    
+    // nothing changed, keep the page on screen
+    if(!started) {
+        
+        return;
+    }
+    
+    this->_display->showPage(this->_page);
+    
+    this->_page = (this->_page + 1) % FRAMEBUFFER_PAGES;
+}
+
+void Core::Framebuffer::showPage(unsigned long page, unsigned long row) {
+    
+    // there is only one
+}
+
+unsigned long Core::Framebuffer::getTerminalType() {
+    
+    return TERMINAL_TYPE_VIDEO;
+}
+
+unsigned long Core::Framebuffer::getColumns() {
+    
+    return this->_columns;
+}
+
+unsigned long Core::Framebuffer::getRows() {
+    
+    return this->_rows;
+}
+
+unsigned long Core::Framebuffer::getPages() {
+    
+    // the video memory beyond the screen is used for flipping
+    return 1;
+}
+
+unsigned long Core::Framebuffer::startResource() {
+    
+    // only usable once the boot loader handed us a mode
+    if(this->_base == 0) {
+        
+        return E_FAILURE;
+    }
+    
+    return E_SUCCESS;
+}
+
+const char* Core::Framebuffer::getResourceName() {
+    
+    return "Framebuffer";
+}
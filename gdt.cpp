@@ -29,8 +29,13 @@
  */
 
 #include <I386/gdt.h>
+#include <core/cpu.h>
+#include <core/percpu.h>
 #include <errors.h>
 
+// top of the boot kernel stack from loader.asm
+extern "C" unsigned char _tss_stack[];
+
 // set instance pointer to a null pointer
 I386::GDT* I386::GDT::_instance = 0;
 
@@ -50,32 +55,94 @@ I386::GDT* I386::GDT::getInstance() {
             // no, major oops here!
             return E_FAILURE;
         }
+        
+        // auto register
+        Core::ResourceManager::getInstance()->registerResource(_instance);
     }
     
-    // auto register
-    Core::ResourceManager::getInstance()->registerResource(_instance);
-    
     // return the instance
     return _instance;
 }
 
 unsigned long I386::GDT::startResource() {
     
+    // interrupts from lower rings land on the boot stack until a thread runs
+    return this->initialiseProcessor(0, reinterpret_cast<unsigned long>(_tss_stack));
+}
+
+const char* I386::GDT::getResourceName() {
+    
+    return "Global Descriptor Table";
+}
+
+I386::GDT::GDT() {
+    
+    // tables get allocated when their processor starts
+    for(int n = 0; n < MAX_CPUS; n++) {
+        
+        this->_gdtPointer[n] = 0;
+        this->_gdtEntries[n] = 0;
+        this->_tss[n] = 0;
+    }
+}
+
+unsigned long I386::GDT::initialiseProcessor(unsigned int cpu, unsigned long stack) {
+    
+    if(this->_gdtEntries[cpu] == 0) {
+        
+        struct GDTPointer* pointer = new struct I386::GDTPointer();
+        struct GDTEntry* entries = reinterpret_cast<struct I386::GDTEntry*>(new struct I386::GDTEntry[GDT_SIZE]);
+        struct TSS* tss = new struct I386::TSS();
+        
+        // check if we got valid addresses
+        if(pointer == reinterpret_cast<struct GDTPointer*>(E_ALLOC_NOMEM) || entries == reinterpret_cast<struct GDTEntry*>(E_ALLOC_NOMEM) || tss == reinterpret_cast<struct TSS*>(E_ALLOC_NOMEM)) {
+            
+            return E_ALLOC_NOMEM;
+        }
+        
+        this->_gdtPointer[cpu] = pointer;
+        this->_gdtEntries[cpu] = entries;
+        this->_tss[cpu] = tss;
+    }
+    
+    struct GDTEntry* entries = this->_gdtEntries[cpu];
+    struct TSS* tss = this->_tss[cpu];
+    
     // setup the GDT pointer
-    this->_gdtPointer->limit = (sizeof(struct I386::GDTEntry) * GDT_SIZE) - 1;
-    this->_gdtPointer->base = reinterpret_cast<unsigned int>(this->_gdtEntries);
+    this->_gdtPointer[cpu]->limit = (sizeof(struct I386::GDTEntry) * GDT_SIZE) - 1;
+    this->_gdtPointer[cpu]->base = reinterpret_cast<unsigned int>(entries);
     
     // null descriptor
-    this->setGate(0, 0, 0, 0, 0);
+    this->setGate(entries, 0, 0, 0, 0, 0);
     
     // code segment for ring0
-    this->setGate(KERNEL_CS, 0, 0xffffffff, 0x9a, 0xcf);
+    this->setGate(entries, KERNEL_CS, 0, 0xffffffff, 0x9a, 0xcf);
     
     // data segment for ring1
-    this->setGate(KERNEL_DS, 0, 0xffffffff, 0x92, 0xcf);
+    this->setGate(entries, KERNEL_DS, 0, 0xffffffff, 0x92, 0xcf);
+    
+    // clear the task state segment
+    unsigned char* bytes = reinterpret_cast<unsigned char*>(tss);
+    
+    for(unsigned int n = 0; n < sizeof(struct I386::TSS); n++) {
+        
+        bytes[n] = 0;
+    }
+    
+    // task state segment
+    tss->ss0 = KERNEL_DS;
+    tss->esp0 = stack;
+    tss->iomapBase = sizeof(struct I386::TSS);
+    
+    this->setGate(entries, KERNEL_TSS, reinterpret_cast<unsigned long>(tss), sizeof(struct I386::TSS) - 1, 0x89, 0x00);
+    
+    // per-CPU area, byte granular data segment
+    Core::PerCPU::initialise(cpu);
+    
+    this->setGate(entries, KERNEL_PERCPU, reinterpret_cast<unsigned long>(Core::PerCPU::getArea(cpu)), sizeof(Core::PerCPUArea) - 1, 0x92, 0x40);
     
     // load GDT pointer
-    asm volatile ("lgdt %0" : "=m" (*this->_gdtPointer));
+    asm volatile ("lgdt %0" : : "m" (*this->_gdtPointer[cpu]));
     
     // jump to new segment
     asm volatile("ljmp $(0x08), $reload_segments");
@@ -86,37 +153,36 @@ unsigned long I386::GDT::startResource() {
     asm volatile("movl %eax, %ds");
     asm volatile("movl %eax, %es");
     asm volatile("movl %eax, %fs");
-    asm volatile("movl %eax, %gs");
     asm volatile("movl %eax, %ss");
+    
+    // every access through GS lands in the area of this processor
+    asm volatile("movw %w0, %%gs" : : "r" (KERNEL_PERCPU));
+    
+    // load the task register
+    asm volatile("ltr %w0" : : "r" (KERNEL_TSS));
      
     return E_SUCCESS;
 }
 
-const char* I386::GDT::getResourceName() {
-    
-    return "Global Descriptor Table";
-}
-
-I386::GDT::GDT() {
+void I386::GDT::setKernelStack(unsigned long stack) {
     
-    this->_gdtPointer = new struct I386::GDTPointer();
-    this->_gdtEntries = reinterpret_cast<struct I386::GDTEntry*>(new struct I386::GDTEntry[GDT_SIZE]);
+    this->_tss[Core::CPU::getCurrentId()]->esp0 = stack;
 }
 
-void I386::GDT::setGate(int segment, unsigned long base, unsigned long limit, unsigned char access, unsigned char granularity) {
+void I386::GDT::setGate(struct GDTEntry* entries, int segment, unsigned long base, unsigned long limit, unsigned char access, unsigned char granularity) {
     
     int index = segment / 8;
     
     // setup base address
-    this->_gdtEntries[index].base_low = (base & 0xffff);
-    this->_gdtEntries[index].base_middle = (base >> 16) & 0xff;
-    this->_gdtEntries[index].base_high = (base >> 24) & 0xff;
+    entries[index].base_low = (base & 0xffff);
+    entries[index].base_middle = (base >> 16) & 0xff;
+    entries[index].base_high = (base >> 24) & 0xff;
     
     // setup limits
-    this->_gdtEntries[index].limit_low = (limit & 0xffff);
-    this->_gdtEntries[index].granularity = ((limit >> 16) & 0x0f);
+    entries[index].limit_low = (limit & 0xffff);
+    entries[index].granularity = ((limit >> 16) & 0x0f);
     
     // setup the granularity and access flags
-    this->_gdtEntries[index].granularity |= (granularity & 0xf0);
-    this->_gdtEntries[index].access = access;
+    entries[index].granularity |= (granularity & 0xf0);
+    entries[index].access = access;
 }
@@ -33,7 +33,7 @@
 #include <grub/grub.h>
 #include <grub/multiboot.h>
 
-#include <core/console.h>
+#include <core/klog.h>
 
 #include <errors.h>
 
@@ -41,6 +41,7 @@ Grub::GrubChecker::GrubChecker(unsigned long magic, unsigned long address) {
     
     this->_address = address;
     this->_magic = magic;
+    this->_memorySize = 0;
     
     // auto register
     Core::ResourceManager::getInstance()->registerResource(this);
@@ -57,12 +58,10 @@ unsigned long Grub::GrubChecker::startResource() {
     bool valid = true;
     bool warning = false;
     
-    Core::Console* console = Core::Console::getInstance();
-    
     // Am I booted by a Multiboot-compliant boot loader?
     if (this->_magic != MULTIBOOT_BOOTLOADER_MAGIC) {
         
-        console->write("\nInvalid bootloader magic!!!");
+        Core::KernelLog::log(KLOG_ERROR, "Grub", "Invalid bootloader magic!!!");
         
         valid = false;
     }
@@ -72,7 +71,7 @@ unsigned long Grub::GrubChecker::startResource() {
     // Are mem_* valid? 
     if (!CHECK_FLAG (multibootInfo->flags, 0)) {
         
-        console->write("\nInvalid memory area");
+        Core::KernelLog::log(KLOG_ERROR, "Grub", "Invalid memory area");
         
         valid = false;
     }
@@ -84,7 +83,7 @@ unsigned long Grub::GrubChecker::startResource() {
     // valid boot device?
     if (!CHECK_FLAG (multibootInfo->flags, 1)) {
         
-        console->write("\nInvalid boot device");
+        Core::KernelLog::log(KLOG_ERROR, "Grub", "Invalid boot device");
         
         valid = false;
     }
@@ -92,7 +91,7 @@ unsigned long Grub::GrubChecker::startResource() {
     // Is the command line passed? 
     if (!CHECK_FLAG (multibootInfo->flags, 2)) {
         
-        console->write("\nNo command line passed");
+        Core::KernelLog::log(KLOG_ERROR, "Grub", "No command line passed");
         
         valid = false;
     }
@@ -102,7 +101,7 @@ unsigned long Grub::GrubChecker::startResource() {
     if (!CHECK_FLAG (multibootInfo->flags, 3)) {
         
         // just warn
-        console->write("\nInvalid modules");
+        Core::KernelLog::log(KLOG_WARNING, "Grub", "Invalid modules");
         
         warning = true;
     }
@@ -111,7 +110,7 @@ unsigned long Grub::GrubChecker::startResource() {
     // Bits 4 and 5 are mutually exclusive!
     if (CHECK_FLAG (multibootInfo->flags, 4) && CHECK_FLAG (multibootInfo->flags, 5)) {
         
-        console->write("\nNo mutual exclusion on bit 4 and 6");
+        Core::KernelLog::log(KLOG_ERROR, "Grub", "No mutual exclusion on bit 4 and 6");
         
         valid = false;
     }
@@ -121,7 +120,7 @@ unsigned long Grub::GrubChecker::startResource() {
     if (!CHECK_FLAG (multibootInfo->flags, 4)) {
         
         // just warn
-        console->write("\nInvalid a.out symble table");
+        Core::KernelLog::log(KLOG_WARNING, "Grub", "Invalid a.out symble table");
         
         warning = true;
     }
@@ -130,7 +129,7 @@ unsigned long Grub::GrubChecker::startResource() {
     if (!CHECK_FLAG (multibootInfo->flags, 5)) {
         
         // just warn
-        console->write("\nInvalid ELF section header");
+        Core::KernelLog::log(KLOG_WARNING, "Grub", "Invalid ELF section header");
         
         warning = true;
     }
@@ -139,7 +138,7 @@ unsigned long Grub::GrubChecker::startResource() {
     // Are mmap_* valid?
     if (!CHECK_FLAG (multibootInfo->flags, 6)) {
         
-        console->write("\nInvalid mmap");
+        Core::KernelLog::log(KLOG_ERROR, "Grub", "Invalid mmap");
         
         valid = false;
     }
@@ -147,7 +146,6 @@ unsigned long Grub::GrubChecker::startResource() {
 #ifdef DEBUG
     if(warning && valid) {
      
-        console->write("\n");
         return E_WARNING;
         
     }
@@ -156,8 +154,6 @@ unsigned long Grub::GrubChecker::startResource() {
     if(valid)
         return E_SUCCESS;
     
-    console->write("\n");
-    
     // something really wrong!
     return E_PANIC;
 }
@@ -0,0 +1,170 @@
+/***************************************************************************
+ *            idle.cpp
+ *
+ *  Copyright  2008  Matthias v.d. Vlies
+ *  matthias@mserver.nl
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*! \file idle.cpp
+ *  \brief Idle loop
+ *   
+ *  This file implements the Idle class.
+ *
+ */
+
+#include <core/idle.h>
+#include <core/scheduler.h>
+#include <core/format.h>
+#include <core/cpu.h>
+#include <I386/i386.h>
+
+// halt until detected otherwise
+bool Core::Idle::_mwait = false;
+unsigned long Core::Idle::_hint = 0;
+Core::Idle::CPUData Core::Idle::_cpus[MAX_CPUS];
+
+void Core::Idle::initialise() {
+    
+    unsigned long registers[4];
+    
+    I386::cpuid(0, 0, registers);
+    
+    if(registers[0] < IDLE_CPUID_MWAIT_LEAF) {
+        
+        return;
+    }
+    
+    I386::cpuid(1, 0, registers);
+    
+    if(!(registers[2] & IDLE_CPUID_MONITOR)) {
+        
+        return;
+    }
+    
+    I386::cpuid(IDLE_CPUID_MWAIT_LEAF, 0, registers);
+    
+    // EDX has the number of sub-states of C0 to C7 in 4 bits each, take the deepest C-state
+    for(int state = 7; state > 0; state--) {
+        
+        if((registers[3] >> (state * 4)) & 0xf) {
+            
+            _hint = (state - 1) << 4;
+            
+            break;
+        }
+    }
+    
+    _mwait = true;
+}
+
+void Core::Idle::run() {
+    
+    CPUData* data = &_cpus[Core::CPU::getCurrentId()];
+    
+    data->started = I386::readTimeStampCounter();
+    
+    for(;;) {
+        
+        I386::disableInterrupts();
+        
+        // queued work, a busier processor to help or softirqs for the daemon
+        if(Core::Scheduler::isReschedulePending()) {
+            
+            I386::enableInterrupts();
+            
+            Core::Scheduler::schedule();
+            
+            continue;
+        }
+        
+        sleep(data);
+    }
+}
+
+void Core::Idle::sleep(CPUData* data) {
+    
+    unsigned long long started = I386::readTimeStampCounter();
+    
+    if(_mwait) {
+        
+        data->wake = 0;
+        
+        // the exchange orders the flag before the look at the scheduler, a waker either
+        // sees us polling or we see its request
+        I386::atomicExchange(&data->polling, 1);
+        
+        I386::monitor(&data->wake);
+        
+        if(!Core::Scheduler::isReschedulePending()) {
+            
+            I386::enableInterruptsAndWait(_hint);
+        }
+        else {
+            
+            I386::enableInterrupts();
+        }
+        
+        data->polling = 0;
+    }
+    else {
+        
+        I386::enableInterruptsAndHalt();
+    }
+    
+    // includes the interrupt that woke us, it would have interrupted nothing else
+    data->residency += I386::readTimeStampCounter() - started;
+    data->entries++;
+}
+
+bool Core::Idle::wake(unsigned int cpu) {
+    
+    CPUData* data = &_cpus[cpu];
+    
+    if(!data->polling) {
+        
+        return false;
+    }
+    
+    // a store to the monitored line ends the MWAIT
+    data->wake = 1;
+    
+    return true;
+}
+
+unsigned long long Core::Idle::getResidency(unsigned int cpu) {
+    
+    return (cpu < MAX_CPUS) ? _cpus[cpu].residency : 0;
+}
+
+void Core::Idle::print() {
+    
+    Core::kprintf("Idle residency (%s):\n", _mwait ? "mwait" : "hlt");
+    
+    unsigned long long now = I386::readTimeStampCounter();
+    
+    for(unsigned int cpu = 0; cpu < MAX_CPUS; cpu++) {
+        
+        if(!Core::CPU::isOnline(cpu) || _cpus[cpu].started == 0) {
+            
+            continue;
+        }
+        
+        Core::kprintf("  cpu %u: %llu of %llu cycles in %lu sleeps\n", cpu, _cpus[cpu].residency, now - _cpus[cpu].started, _cpus[cpu].entries);
+    }
+}
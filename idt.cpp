@@ -0,0 +1,302 @@
+/***************************************************************************
+ *            idt.cpp
+ *
+ *  Copyright  2008  Matthias v.d. Vlies
+ *  matthias@mserver.nl
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*! \file idt.cpp
+ *  \brief IDT Manager
+ *   
+ * This file implements the IDT class. It handles the i386 Interrupt Descriptor Table
+ * and dispatches interrupts to their C-level handlers.
+ *
+ */
+
+#include <I386/idt.h>
+#include <I386/gdt.h>
+#include <I386/i386.h>
+#include <I386/apic.h>
+#include <core/softirq.h>
+#include <core/scheduler.h>
+#include <core/cpu.h>
+#include <core/rcu.h>
+#include <core/format.h>
+#include <core/console.h>
+#include <core/serial.h>
+#include <errors.h>
+
+// stubs from loader.asm
+extern "C" {
+    
+    void _isr0(); void _isr1(); void _isr2(); void _isr3(); void _isr4(); void _isr5(); void _isr6(); void _isr7();
+    void _isr8(); void _isr9(); void _isr10(); void _isr11(); void _isr12(); void _isr13(); void _isr14(); void _isr15();
+    void _isr16(); void _isr17(); void _isr18(); void _isr19(); void _isr20(); void _isr21(); void _isr22(); void _isr23();
+    void _isr24(); void _isr25(); void _isr26(); void _isr27(); void _isr28(); void _isr29(); void _isr30(); void _isr31();
+    
+    void _irq0(); void _irq1(); void _irq2(); void _irq3(); void _irq4(); void _irq5(); void _irq6(); void _irq7();
+    void _irq8(); void _irq9(); void _irq10(); void _irq11(); void _irq12(); void _irq13(); void _irq14(); void _irq15();
+    
+    void _irq_apic_timer(); void _irq_reschedule(); void _irq_spurious();
+};
+
+/*! Table of the exception and hardware interrupt stubs, in vector order */
+static void (*stubs[IRQ_BASE + IRQ_COUNT])() = {
+    
+    _isr0, _isr1, _isr2, _isr3, _isr4, _isr5, _isr6, _isr7,
+    _isr8, _isr9, _isr10, _isr11, _isr12, _isr13, _isr14, _isr15,
+    _isr16, _isr17, _isr18, _isr19, _isr20, _isr21, _isr22, _isr23,
+    _isr24, _isr25, _isr26, _isr27, _isr28, _isr29, _isr30, _isr31,
+    _irq0, _irq1, _irq2, _irq3, _irq4, _irq5, _irq6, _irq7,
+    _irq8, _irq9, _irq10, _irq11, _irq12, _irq13, _irq14, _irq15
+};
+
+// set instance pointer to a null pointer
+I386::IDT* I386::IDT::_instance = 0;
+
+// no handlers installed yet
+I386::InterruptHandler I386::IDT::_handlers[IDT_SIZE] = { 0 };
+
+// not in an interrupt
+volatile unsigned int I386::IDT::_nesting[MAX_CPUS] = { 0 };
+
+I386::IDT* I386::IDT::getInstance() {
+    
+    // check for exsisting instance
+    if(_instance == 0) {
+        
+        // none found, create new instance
+        _instance = new IDT();
+        
+        // check if we got a valid address
+        if(_instance == reinterpret_cast<IDT*>(E_ALLOC_NOMEM)) {
+            
+            _instance = 0;
+            
+            // no, major oops here!
+            return E_FAILURE;
+        }
+        
+        // auto register
+        Core::ResourceManager::getInstance()->registerResource(_instance);
+    }
+    
+    // return the instance
+    return _instance;
+}
+
+unsigned long I386::IDT::startResource() {
+    
+    // setup the IDT pointer
+    this->_idtPointer->limit = (sizeof(struct I386::IDTEntry) * IDT_SIZE) - 1;
+    this->_idtPointer->base = reinterpret_cast<unsigned int>(this->_idtEntries);
+    
+    // clear all gates, unused vectors will raise a fault
+    for(int n = 0; n < IDT_SIZE; n++) {
+        
+        this->setGate(n, 0, 0, 0);
+    }
+    
+    // install the exception and hardware interrupt stubs
+    for(int n = 0; n < IRQ_BASE + IRQ_COUNT; n++) {
+        
+        this->setGate(n, reinterpret_cast<unsigned long>(stubs[n]), KERNEL_CS, IDT_INTERRUPT_GATE);
+    }
+    
+    // local APIC interrupts, these are acknowledged at the APIC instead of the PIC
+    this->setGate(APIC_TIMER_VECTOR, reinterpret_cast<unsigned long>(_irq_apic_timer), KERNEL_CS, IDT_INTERRUPT_GATE);
+    this->setGate(APIC_RESCHEDULE_VECTOR, reinterpret_cast<unsigned long>(_irq_reschedule), KERNEL_CS, IDT_INTERRUPT_GATE);
+    this->setGate(APIC_SPURIOUS_VECTOR, reinterpret_cast<unsigned long>(_irq_spurious), KERNEL_CS, IDT_INTERRUPT_GATE);
+    
+    // move the hardware interrupts away from the exceptions
+    this->remapPIC();
+    
+    // load IDT pointer
+    asm volatile ("lidt %0" : : "m" (*this->_idtPointer));
+    
+    return E_SUCCESS;
+}
+
+const char* I386::IDT::getResourceName() {
+    
+    return "Interrupt Descriptor Table";
+}
+
+void I386::IDT::initialiseProcessor() {
+    
+    // all processors share the gates
+    asm volatile ("lidt %0" : : "m" (*this->_idtPointer));
+}
+
+I386::IDT::IDT() {
+    
+    this->_idtPointer = new struct I386::IDTPointer();
+    this->_idtEntries = reinterpret_cast<struct I386::IDTEntry*>(new struct I386::IDTEntry[IDT_SIZE]);
+}
+
+void I386::IDT::setGate(unsigned char interrupt, unsigned long base, unsigned short selector, unsigned char flags) {
+    
+    // setup handler address
+    this->_idtEntries[interrupt].base_low = (base & 0xffff);
+    this->_idtEntries[interrupt].base_high = (base >> 16) & 0xffff;
+    
+    // setup segment and type
+    this->_idtEntries[interrupt].selector = selector;
+    this->_idtEntries[interrupt].zero = 0;
+    this->_idtEntries[interrupt].flags = flags;
+}
+
+void I386::IDT::remapPIC() {
+    
+    // start initialisation sequence (ICW1)
+    I386::writePortByte(PIC1_COMMAND, 0x11);
+    I386::writePortByte(PIC2_COMMAND, 0x11);
+    
+    // vector offsets (ICW2)
+    I386::writePortByte(PIC1_DATA, IRQ_BASE);
+    I386::writePortByte(PIC2_DATA, IRQ_BASE + 8);
+    
+    // cascade on IRQ2 (ICW3)
+    I386::writePortByte(PIC1_DATA, 0x04);
+    I386::writePortByte(PIC2_DATA, 0x02);
+    
+    // 8086 mode (ICW4)
+    I386::writePortByte(PIC1_DATA, 0x01);
+    I386::writePortByte(PIC2_DATA, 0x01);
+    
+    // mask everything but the cascade, lines get enabled when a handler is installed
+    I386::writePortByte(PIC1_DATA, 0xfb);
+    I386::writePortByte(PIC2_DATA, 0xff);
+}
+
+void I386::IDT::setMask(unsigned char irq, bool enabled) {
+    
+    unsigned short port = PIC1_DATA;
+    
+    // lines 8-15 live on the slave
+    if(irq >= 8) {
+        
+        port = PIC2_DATA;
+        irq -= 8;
+    }
+    
+    unsigned char mask = I386::readPortByte(port);
+    
+    if(enabled) {
+        
+        mask &= ~(1 << irq);
+    }
+    else {
+        
+        mask |= (1 << irq);
+    }
+    
+    I386::writePortByte(port, mask);
+}
+
+void I386::IDT::registerHandler(unsigned char interrupt, InterruptHandler handler) {
+    
+    unsigned long flags = I386::saveFlags();
+    
+    Core::RCU::assign(_handlers[interrupt], handler);
+    
+    // is this a hardware interrupt line?
+    if(interrupt >= IRQ_BASE && interrupt < IRQ_BASE + IRQ_COUNT) {
+        
+        this->setMask(interrupt - IRQ_BASE, handler != 0);
+    }
+    
+    I386::restoreFlags(flags);
+}
+
+bool I386::IDT::isInInterrupt() {
+    
+    return _nesting[Core::CPU::getCurrentId()] != 0;
+}
+
+bool I386::IDT::dispatch(struct Registers* registers) {
+    
+    // interrupts are disabled, which makes this a read-side section
+    InterruptHandler handler = Core::RCU::dereference(_handlers[registers->interrupt & 0xff]);
+    
+    if(handler == 0) {
+        
+        return false;
+    }
+    
+    handler(registers);
+    
+    return true;
+}
+
+extern "C" void _fault_handler(struct I386::Registers* registers) {
+    
+    if(I386::IDT::dispatch(registers)) {
+        
+        return;
+    }
+    
+    // the faulting code may hold any lock, so only take the ones that are free
+    I386::disableInterrupts();
+    
+    char message[80];
+    
+    unsigned long length = Core::Format::string(message, sizeof(message), "Unhandled exception %u, error 0x%08x at eip 0x%08x\n",
+        registers->interrupt, registers->error, registers->eip);
+    
+    Core::Console::getInstance()->tryWrite(message);
+    Core::Serial::trySend(SERIAL_COM1, message, length);
+    
+    // returning would only run the faulting instruction again
+    I386::halt();
+}
+
+extern "C" void _irq_handler(struct I386::Registers* registers) {
+    
+    unsigned int cpu = Core::CPU::getCurrentId();
+    
+    I386::IDT::_nesting[cpu]++;
+    
+    // run the hard handler, it only acknowledges the device
+    I386::IDT::dispatch(registers);
+    
+    // acknowledge the interrupt controller before running deferred work so other lines can fire
+    if(registers->interrupt >= APIC_VECTOR_BASE) {
+        
+        I386::APIC::endOfInterrupt();
+    }
+    else {
+        
+        if(registers->interrupt >= IRQ_BASE + 8) {
+            
+            I386::writePortByte(PIC2_COMMAND, PIC_EOI);
+        }
+        
+        I386::writePortByte(PIC1_COMMAND, PIC_EOI);
+    }
+    
+    // run pending softirqs with interrupts enabled
+    Core::SoftIRQ::irqExit();
+    
+    // only the outermost interrupt may switch threads
+    if(--I386::IDT::_nesting[cpu] == 0) {
+        
+        Core::Scheduler::preempt();
+    }
+}
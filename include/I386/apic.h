@@ -0,0 +1,219 @@
+/***************************************************************************
+ *            apic.h
+ *
+ *  Copyright  2008  Matthias v.d. Vlies
+ *  matthias@mserver.nl
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*! \file apic.h
+ *  \brief Driver for the I386 local APIC
+ *   
+ *  This file defines the APIC Singleton class. It drives the local interrupt controller
+ *  of each processor for inter-processor interrupts and the per-processor timer.
+ *
+ */
+
+#ifndef _APIC_H
+#define	_APIC_H
+
+#include <core/resource.h>
+#include <I386/i386.h>
+
+namespace I386 {
+    
+    /*! Model specific register holding the physical base of the local APIC */
+    #define APIC_BASE_MSR               0x1b
+    
+    /*! Local APIC id register */
+    #define APIC_ID                     0x020
+    
+    /*! Task priority register */
+    #define APIC_TPR                    0x080
+    
+    /*! End of interrupt register */
+    #define APIC_EOI                    0x0b0
+    
+    /*! Spurious interrupt vector register */
+    #define APIC_SPURIOUS               0x0f0
+    
+    /*! Interrupt command register, low word */
+    #define APIC_ICR_LOW                0x300
+    
+    /*! Interrupt command register, destination */
+    #define APIC_ICR_HIGH               0x310
+    
+    /*! Local vector table entry of the timer */
+    #define APIC_LVT_TIMER              0x320
+    
+    /*! Timer initial count register */
+    #define APIC_TIMER_INITIAL          0x380
+    
+    /*! Timer current count register */
+    #define APIC_TIMER_CURRENT          0x390
+    
+    /*! Timer divide configuration register */
+    #define APIC_TIMER_DIVIDE           0x3e0
+    
+    /*! Software enable flag in the spurious interrupt vector register */
+    #define APIC_ENABLE                 0x100
+    
+    /*! Delivery mode INIT */
+    #define APIC_ICR_INIT               0x00000500
+    
+    /*! Delivery mode start-up */
+    #define APIC_ICR_STARTUP            0x00000600
+    
+    /*! Level assert flag */
+    #define APIC_ICR_ASSERT             0x00004000
+    
+    /*! Delivery status flag, set while the interrupt is being sent */
+    #define APIC_ICR_PENDING            0x00001000
+    
+    /*! Periodic mode flag in the timer vector table entry */
+    #define APIC_TIMER_PERIODIC         0x00020000
+    
+    /*! Mask flag in a local vector table entry */
+    #define APIC_LVT_MASKED             0x00010000
+    
+    /*! Timer divide by 16 */
+    #define APIC_TIMER_DIVIDE_16        0x03
+    
+    /*! Number of kernel ticks the timer gets calibrated over */
+    #define APIC_CALIBRATE_TICKS        10
+    
+    /*! First vector of the local APIC interrupts */
+    #define APIC_VECTOR_BASE            0xf0
+    
+    /*! Vector of the per-processor timer */
+    #define APIC_TIMER_VECTOR           0xf0
+    
+    /*! Vector of the reschedule inter-processor interrupt */
+    #define APIC_RESCHEDULE_VECTOR      0xf1
+    
+    /*! Vector of spurious interrupts, these need no acknowledgement */
+    #define APIC_SPURIOUS_VECTOR        0xff
+    
+    /*! \class APIC
+     *\brief Local APIC driver
+     *
+     * This class enables the local APIC of every processor. The boot processor keeps taking
+     * its tick from the PIT, the other processors get a periodic APIC timer calibrated
+     * against it.
+     */
+    class APIC : public Core::Resource {
+        
+    public:
+        
+        /*! A static function to get the singleton instance for the APIC driver
+        *
+        *\return The APIC instance
+        */
+        static APIC* getInstance();
+        
+        /*! Function for starting a resource
+         *
+         *\return A status indicating E_SUCCES or E_FAILURE
+         */
+        unsigned long startResource();
+
+        /*! Function for getting the name of a resource
+         *
+         *\return The resource's name
+         */
+        const char* getResourceName();
+        
+        /*! Function to check if the local APICs can be used
+         *
+         *\return Wether the resource started
+         */
+        bool isEnabled();
+        
+        /*! Function to enable the local APIC of the calling processor and start its timer */
+        void initialiseProcessor();
+        
+        /*! Function to get the hardware id of the calling processor
+         *
+         *\return The local APIC id
+         */
+        unsigned int getId();
+        
+        /*! Function to send an INIT to another processor
+         *
+         *\param id The local APIC id of the target
+         */
+        void sendInit(unsigned int id);
+        
+        /*! Function to send a start-up interrupt to another processor
+         *
+         *\param id The local APIC id of the target
+         *\param page The page below 1 MB the target starts executing at, in real mode
+         */
+        void sendStartup(unsigned int id, unsigned char page);
+        
+        /*! Function to send a fixed interrupt to another processor
+         *
+         *\param id The local APIC id of the target
+         *\param vector The vector to raise
+         */
+        void sendInterrupt(unsigned int id, unsigned char vector);
+        
+        /*! Function to acknowledge the interrupt being handled on the calling processor */
+        static inline void endOfInterrupt() {
+            
+            _registers[APIC_EOI / 4] = 0;
+        }
+
+    protected:
+
+        /*! Protected constructor to ensure singleton usage */
+        APIC();
+        
+    private:
+        
+        /*! Function to write the interrupt command register and wait until it got sent
+         *
+         *\param id The local APIC id of the target
+         *\param command The low word of the command
+         */
+        void sendCommand(unsigned int id, unsigned long command);
+        
+        /*! Hard handler for the timer of the secondary processors
+         *
+         *\param registers The stack frame of the interrupted code
+         */
+        static void timerInterrupt(struct Registers* registers);
+        
+        /*! Hard handler for the reschedule interrupt
+         *
+         *\param registers The stack frame of the interrupted code
+         */
+        static void rescheduleInterrupt(struct Registers* registers);
+        
+        /*! A static instance of the class for singleton usage */ 
+        static APIC* _instance;
+        
+        /*! The memory-mapped registers, every processor sees its own APIC here */
+        static volatile unsigned long* _registers;
+        
+        /*! Timer count matching one kernel tick */
+        unsigned long _timerCount;
+    };
+}
+
+#endif	/* _APIC_H */
@@ -0,0 +1,210 @@
+/***************************************************************************
+ *            fpu.h
+ *
+ *  Copyright  2008  Matthias v.d. Vlies
+ *  matthias@mserver.nl
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*! \file fpu.h
+ *  \brief Manager for the x87/SSE unit
+ *   
+ *  This file defines the FPU Singleton class. It enables x87 and SSE and switches
+ *  the FPU register state between tasks lazily.
+ *
+ */
+
+#ifndef _FPU_H
+#define	_FPU_H
+
+#include <config.h>
+#include <core/resource.h>
+#include <I386/i386.h>
+
+namespace I386 {
+    
+    /*! Vector of the device-not-available (#NM) exception */
+    #define FPU_NM_VECTOR               7
+    
+    /*! Size of an FXSAVE area */
+    #define FPU_FXSAVE_SIZE             512
+    
+    /*! Alignment required by XSAVE (FXSAVE needs 16) */
+    #define FPU_CONTEXT_ALIGN           64
+    
+    /*! x87 state component of XCR0 */
+    #define XCR0_X87                    0x01
+    
+    /*! SSE state component of XCR0 */
+    #define XCR0_SSE                    0x02
+    
+    /*! AVX state component of XCR0 */
+    #define XCR0_AVX                    0x04
+    
+    /*! \class FPU
+     *\brief FPU Manager
+     *
+     * This class enables the x87/SSE unit and keeps track of which context owns the
+     * FPU registers on each processor. Switching tasks only sets CR0.TS, the registers are
+     * saved and restored on the first FPU instruction of the next task (#NM trap), so tasks
+     * that never touch the FPU never pay for it.
+     */
+    class FPU : public Core::Resource {
+        
+    public:
+        
+        /*! A static function to get the singleton instance for the FPU manager
+        *
+        *\return The FPU instance
+        */
+        static FPU* getInstance();
+        
+        /*! A static function to get the FPU manager once it has been started. Never
+         *  creates the instance, so it is safe to call while holding the console lock
+         *
+         *\return The FPU instance or 0 while the FPU is not started yet
+         */
+        static FPU* getStarted();
+        
+        /*! Function for starting a resource
+         *
+         *\return A status indicating E_SUCCES or E_FAILURE
+         */
+        unsigned long startResource();
+
+        /*! Function for getting the name of a resource
+         *
+         *\return The resource's name
+         */
+        const char* getResourceName();
+        
+        /*! Function for allocating a context save area holding a clean FPU state
+         *
+         *\return A pointer to the save area or 0 when out of memory
+         */
+        void* allocateContext();
+        
+        /*! Function for freeing a save area from allocateContext(). The area must not be
+         *  loaded anymore, see forget()
+         *
+         *\param context The save area
+         */
+        void freeContext(void* context);
+        
+        /*! Function called on a task switch to select the context of the next task.
+         *  Only sets CR0.TS when the registers belong to another context.
+         *
+         *\param context The context of the next task, 0 for tasks without one
+         */
+        void switchTo(void* context);
+        
+        /*! Function for releasing a context, e.g. when its task exits
+         *
+         *\param context The context to forget
+         */
+        void forget(void* context);
+        
+        /*! Function to check if a context lives in the registers of a processor. Such a task
+         *  may not move to another processor, its saved state would be stale there.
+         *
+         *\param context The context to look for
+         *\return Wether a processor owns the context
+         */
+        bool isLoaded(void* context);
+        
+        /*! Function for enabling the FPU on a secondary processor, the boot processor
+         *  is set up when the resource starts
+         */
+        void initialiseProcessor();
+        
+        /*! Function for using SIMD instructions from kernel code. Saves the registers of
+         *  their owner and disables preemption until endKernelUse(). Sections do not nest,
+         *  an interrupt handler arriving inside one gets false and has to do without.
+         *
+         *\return Wether SIMD may be used, false when SSE is not available or the
+         *        processor is already in a section
+         */
+        bool beginKernelUse();
+        
+        /*! Function to end a section started with beginKernelUse() */
+        void endKernelUse();
+        
+        /*! Function to check for SSE support
+         *
+         *\return Wether SSE is enabled
+         */
+        bool hasSSE();
+        
+    protected:
+
+        /*! Protected constructor to ensure singleton usage */
+        FPU();
+        
+    private:
+        
+        /*! Handler for the #NM trap, loads the registers of the current context
+         *
+         *\param registers The stack frame of the interrupted code
+         */
+        static void deviceNotAvailable(struct Registers* registers);
+        
+        /*! Function for storing the registers into a save area
+         *
+         *\param context The save area
+         */
+        void save(void* context);
+        
+        /*! Function for loading the registers from a save area
+         *
+         *\param context The save area
+         */
+        void restore(void* context);
+        
+        /*! A static instance of the class for singleton usage */ 
+        static FPU* _instance;
+        
+        /*! The instance after startResource() succeeded, 0 before */
+        static FPU* _started;
+        
+        /*! Wether FXSAVE and SSE are available */
+        bool _sse;
+        
+        /*! Wether XSAVE is available */
+        bool _xsave;
+        
+        /*! State components saved by XSAVE */
+        unsigned long long _xsaveMask;
+        
+        /*! Size of a save area in bytes */
+        unsigned long _contextSize;
+        
+        /*! Save area with the state after initialisation */
+        void* _cleanContext;
+        
+        /*! The context whose state is in the registers, per processor */
+        void* _owner[MAX_CPUS];
+        
+        /*! The context of the running task, per processor */
+        void* _current[MAX_CPUS];
+        
+        /*! Wether each processor is between beginKernelUse() and endKernelUse() */
+        volatile bool _kernelUse[MAX_CPUS];
+    };
+}
+
+#endif	/* _FPU_H */
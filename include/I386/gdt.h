@@ -24,7 +24,8 @@
 /*! \file gdt.h
  *  \brief Manager for the I386 Global Descriptor Table
  *   
- *  This file defines the GDT Singleton class and GDT support structures.
+ *  This file defines the GDT Singleton class and GDT support structures. Every processor
+ *  gets its own table so it can have its own task state segment.
  *
  */
 
@@ -32,11 +33,12 @@
 #define	_GDT_H
 
 #include <core/resource.h>
+#include <config.h>
 
 namespace I386 {
     
     /*! Number of descriptors we need */
-    #define GDT_SIZE                    3
+    #define GDT_SIZE                    5
     
     /*! Code segment */
     #define KERNEL_CS                  0x08
@@ -44,6 +46,12 @@ namespace I386 {
     /*! Data segment */
     #define KERNEL_DS                  0x10
     
+    /*! Task state segment */
+    #define KERNEL_TSS                 0x18
+    
+    /*! Per-CPU area, loaded into GS. loader.asm uses the same selector before the GDT starts */
+    #define KERNEL_PERCPU              0x20
+    
     /*!\todo: define flags */
 
     /*! \struct GDTEntry
@@ -88,6 +96,39 @@ namespace I386 {
 
     } __attribute__((packed));
 
+    /*! \struct TSS
+     *\brief TSS
+     *
+     * This struct defines the i386 Task State Segment. Tasks are switched in software, the
+     * TSS only supplies the kernel stack for ring transitions.
+     */
+    struct TSS {
+        
+        /*! Selector of the previous task, unused */
+        unsigned int link;
+        
+        /*! Stack pointer loaded when entering ring0 */
+        unsigned int esp0;
+        
+        /*! Stack segment loaded when entering ring0 */
+        unsigned int ss0;
+        
+        /*! Stacks for ring1 and ring2, unused */
+        unsigned int esp1, ss1, esp2, ss2;
+        
+        /*! Register state for hardware task switches, unused */
+        unsigned int cr3, eip, eflags, eax, ecx, edx, ebx, esp, ebp, esi, edi;
+        
+        /*! Segment registers for hardware task switches, unused */
+        unsigned int es, cs, ss, ds, fs, gs, ldt;
+        
+        /*! Debug trap flag */
+        unsigned short trap;
+        
+        /*! Offset of the I/O permission bitmap */
+        unsigned short iomapBase;
+
+    } __attribute__((packed));
     
     /*! \class GDT
      *\brief GDT Manager
@@ -115,6 +156,22 @@ namespace I386 {
          *\return The resource's name
          */
         const char* getResourceName();
+        
+        /*! Function for building and loading the table of a processor, called on the
+         *  processor itself
+         *
+         *\param cpu The processor
+         *\param stack The top of the stack interrupts from lower rings use until a thread runs
+         *\return E_SUCCESS or E_ALLOC_NOMEM
+         */
+        unsigned long initialiseProcessor(unsigned int cpu, unsigned long stack);
+        
+        /*! Function for setting the stack used when an interrupt enters ring0 on the current
+         *  processor
+         *
+         *\param stack The top of the kernel stack of the running thread
+         */
+        void setKernelStack(unsigned long stack);
 
     protected:
 
@@ -125,22 +182,26 @@ namespace I386 {
         
         /*! Function for setting a gate to the Global Descriptor Table
          *
-         *\param segment The index of the GDTEntry in the GDT table
+         *\param entries The table to fill
+         *\param segment The selector of the GDTEntry in the GDT table
          *\param base The base address of the segment
          *\param limit The limit of the segment
          *\param access The access type
          *\param granularity The type of granularity 
          */
-        void setGate(int segment, unsigned long base, unsigned long limit, unsigned char access, unsigned char granularity);
+        void setGate(struct GDTEntry* entries, int segment, unsigned long base, unsigned long limit, unsigned char access, unsigned char granularity);
         
         /*! A static instance of the class for singleton usage */ 
         static GDT* _instance;
         
-        /*! The entries for the Global Descriptor Table */
-        struct GDTEntry* _gdtEntries;
+        /*! The entries for the Global Descriptor Table of each processor */
+        struct GDTEntry* _gdtEntries[MAX_CPUS];
  
-        /*! The pointer to the Global Descriptor Table */
-        struct GDTPointer* _gdtPointer;
+        /*! The pointer to the Global Descriptor Table of each processor */
+        struct GDTPointer* _gdtPointer[MAX_CPUS];
+        
+        /*! The task state segment of each processor */
+        struct TSS* _tss[MAX_CPUS];
         
     };
 }
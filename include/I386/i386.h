@@ -31,6 +31,28 @@
 #ifndef _I386_H
 #define	_I386_H
 
+// control register helpers from loader.asm
+extern "C" {
+
+    /*! Function for reading CR0 */
+    unsigned long _read_cr0();
+
+    /*! Function for writing CR0 */
+    void _write_cr0(unsigned long value);
+
+    /*! Function for reading CR3 */
+    unsigned long _read_cr3();
+
+    /*! Function for writing CR3 */
+    void _write_cr3(unsigned long value);
+
+    /*! Function for reading CR4 */
+    unsigned long _read_cr4();
+
+    /*! Function for writing CR4 */
+    void _write_cr4(unsigned long value);
+};
+
 namespace I386 {
     
     /*! Inline function for reading a byte from a port
@@ -57,6 +79,312 @@ namespace I386 {
         __asm__ __volatile__ ("outb %1, %0" : : "dN" (port), "a" (data));
     }
 
+    /*! Inline function for reading a word from a port
+     *
+     *\param port The hardware port to read from
+     *\return The read word
+     */
+    inline unsigned short readPortWord (unsigned short port) {
+        
+        unsigned short readWord;
+    
+        __asm__ __volatile__ ("inw %1, %0" : "=a" (readWord) : "dN" (port));
+    
+        return readWord;
+    }
+
+    /*! Inline function for writing a word to a port
+     *
+     *\param port The hardware port to write to
+     *\param data The data to write to the port
+     */
+    inline void writePortWord (unsigned short port, unsigned short data) {
+        
+        __asm__ __volatile__ ("outw %1, %0" : : "dN" (port), "a" (data));
+    }
+
+    /*! Monitor coprocessor flag in CR0 */
+    #define CR0_MP                      0x00000002
+
+    /*! Emulate coprocessor flag in CR0 */
+    #define CR0_EM                      0x00000004
+
+    /*! Task switched flag in CR0 */
+    #define CR0_TS                      0x00000008
+
+    /*! Native FPU error reporting flag in CR0 */
+    #define CR0_NE                      0x00000020
+
+    /*! FXSAVE/FXRSTOR and SSE enable flag in CR4 */
+    #define CR4_OSFXSR                  0x00000200
+
+    /*! Unmasked SIMD exception enable flag in CR4 */
+    #define CR4_OSXMMEXCPT              0x00000400
+
+    /*! XSAVE and extended state enable flag in CR4 */
+    #define CR4_OSXSAVE                 0x00040000
+
+    /*! Interrupt flag in the EFLAGS register */
+    #define EFLAGS_IF                   0x200
+
+    /*! \struct Registers
+     *\brief Registers
+     *
+     * This struct describes the stack frame built by the ISR/IRQ stubs in loader.asm
+     */
+    struct Registers {
+
+        /*! Segment registers pushed by the common stub */
+        unsigned int gs, fs, es, ds;
+
+        /*! General purpose registers pushed by pusha */
+        unsigned int edi, esi, ebp, esp, ebx, edx, ecx, eax;
+
+        /*! Interrupt number and error code pushed by the stub */
+        unsigned int interrupt, error;
+
+        /*! Pushed by the processor */
+        unsigned int eip, cs, eflags;
+
+    } __attribute__((packed));
+
+#ifdef LATENCY_TRACE
+
+    /*! Hook called after interrupts got disabled, records the call site */
+    extern "C" void _trace_irqs_off();
+
+    /*! Hook called right before interrupts get enabled, records the call site */
+    extern "C" void _trace_irqs_on();
+
+#endif
+
+    /*! Inline function for disabling interrupts on the current processor */
+    inline void disableInterrupts() {
+
+        __asm__ __volatile__ ("cli" : : : "memory");
+
+#ifdef LATENCY_TRACE
+        _trace_irqs_off();
+#endif
+    }
+
+    /*! Inline function for enabling interrupts on the current processor */
+    inline void enableInterrupts() {
+
+#ifdef LATENCY_TRACE
+        _trace_irqs_on();
+#endif
+
+        __asm__ __volatile__ ("sti" : : : "memory");
+    }
+
+    /*! Inline function for enabling interrupts and halting until the next one arrives. STI
+     *  only takes effect after the following instruction, so no interrupt gets handled
+     *  between the two and the wakeup can not be lost.
+     */
+    inline void enableInterruptsAndHalt() {
+
+#ifdef LATENCY_TRACE
+        _trace_irqs_on();
+#endif
+
+        __asm__ __volatile__ ("sti; hlt" : : : "memory");
+    }
+
+    /*! Inline function for stopping the current processor for good. Interrupts stay
+     *  masked, only an NMI can end the HLT and it halts again.
+     */
+    inline void halt() __attribute__((noreturn));
+
+    inline void halt() {
+
+        while(true) {
+
+            __asm__ __volatile__ ("cli; hlt" : : : "memory");
+        }
+    }
+
+    /*! Inline function for arming the address monitor for a later MWAIT
+     *
+     *\param address An address in the cache line to watch for stores
+     */
+    inline void monitor(const volatile void* address) {
+
+        __asm__ __volatile__ ("monitor" : : "a" (address), "c" (0), "d" (0));
+    }
+
+    /*! Inline function for enabling interrupts and waiting for a store to the monitored line
+     *  or an interrupt, in the shadow of STI like enableInterruptsAndHalt()
+     *
+     *\param hint The target C-state and sub-state for EAX
+     */
+    inline void enableInterruptsAndWait(unsigned long hint) {
+
+#ifdef LATENCY_TRACE
+        _trace_irqs_on();
+#endif
+
+        __asm__ __volatile__ ("sti; mwait" : : "a" (hint), "c" (0) : "memory");
+    }
+
+    /*! Inline function for reading the EFLAGS register
+     *
+     *\return The current EFLAGS
+     */
+    inline unsigned long readFlags() {
+
+        unsigned long flags;
+
+        __asm__ __volatile__ ("pushfl; popl %0" : "=r" (flags) : : "memory");
+
+        return flags;
+    }
+
+    /*! Inline function for saving EFLAGS and disabling interrupts
+     *
+     *\return The EFLAGS before disabling interrupts
+     */
+    inline unsigned long saveFlags() {
+
+        unsigned long flags = readFlags();
+
+        disableInterrupts();
+
+        return flags;
+    }
+
+    /*! Inline function for restoring the interrupt state saved by saveFlags()
+     *
+     *\param flags The EFLAGS returned by saveFlags()
+     */
+    inline void restoreFlags(unsigned long flags) {
+
+        if(flags & EFLAGS_IF) {
+
+            enableInterrupts();
+        }
+    }
+
+    /*! Inline function for reading the processor's time stamp counter
+     *
+     *\return The number of cycles since reset
+     */
+    inline unsigned long long readTimeStampCounter() {
+
+        unsigned long long cycles;
+
+        __asm__ __volatile__ ("rdtsc" : "=A" (cycles));
+
+        return cycles;
+    }
+
+    /*! Inline function for executing the CPUID instruction
+     *
+     *\param leaf The leaf to query (EAX)
+     *\param subleaf The subleaf to query (ECX)
+     *\param registers Array receiving EAX, EBX, ECX and EDX
+     */
+    inline void cpuid(unsigned long leaf, unsigned long subleaf, unsigned long registers[4]) {
+
+        __asm__ __volatile__ ("cpuid"
+            : "=a" (registers[0]), "=b" (registers[1]), "=c" (registers[2]), "=d" (registers[3])
+            : "a" (leaf), "c" (subleaf));
+    }
+
+    /*! Inline function for finding the lowest set bit in a word
+     *
+     *\param word The word to scan, must not be zero
+     *\return The index of the lowest set bit
+     */
+    inline unsigned long findFirstBit(unsigned long word) {
+
+        __asm__ ("bsfl %1, %0" : "=r" (word) : "rm" (word));
+
+        return word;
+    }
+
+    /*! Inline function for finding the highest set bit in a word
+     *
+     *\param word The word to scan, must not be zero
+     *\return The index of the highest set bit
+     */
+    inline unsigned long findLastBit(unsigned long word) {
+
+        __asm__ ("bsrl %1, %0" : "=r" (word) : "rm" (word));
+
+        return word;
+    }
+
+    /*! Inline function for reading a model specific register
+     *
+     *\param msr The number of the register
+     *\return The contents of the register
+     */
+    inline unsigned long long readModelSpecificRegister(unsigned long msr) {
+
+        unsigned long long value;
+
+        __asm__ __volatile__ ("rdmsr" : "=A" (value) : "c" (msr));
+
+        return value;
+    }
+
+    /*! Inline function for atomically swapping a word in memory
+     *
+     *\param address The word to swap
+     *\param value The new value
+     *\return The value the word held before
+     */
+    inline unsigned long atomicExchange(volatile unsigned long* address, unsigned long value) {
+
+        __asm__ __volatile__ ("xchgl %0, %1" : "+r" (value), "+m" (*address) : : "memory");
+
+        return value;
+    }
+
+    /*! Inline function for atomically adding to a word in memory
+     *
+     *\param address The word to add to
+     *\param value The value to add
+     *\return The value the word held before
+     */
+    inline unsigned long atomicFetchAdd(volatile unsigned long* address, unsigned long value) {
+
+        __asm__ __volatile__ ("lock; xaddl %0, %1" : "+r" (value), "+m" (*address) : : "memory");
+
+        return value;
+    }
+
+    /*! Inline function for atomically setting bits in a word in memory
+     *
+     *\param address The word to change
+     *\param bits The bits to set
+     */
+    inline void atomicOr(volatile unsigned long* address, unsigned long bits) {
+
+        __asm__ __volatile__ ("lock; orl %1, %0" : "+m" (*address) : "r" (bits) : "memory");
+    }
+
+    /*! Inline function for atomically replacing a word in memory if it holds an expected value
+     *
+     *\param address The word to replace
+     *\param expected The value the word must hold
+     *\param value The new value
+     *\return The value the word held before, the swap happened when this equals expected
+     */
+    inline unsigned long compareExchange(volatile unsigned long* address, unsigned long expected, unsigned long value) {
+
+        __asm__ __volatile__ ("lock; cmpxchgl %2, %1" : "+a" (expected), "+m" (*address) : "r" (value) : "memory");
+
+        return expected;
+    }
+
+    /*! Inline function for telling the processor it is in a spin-wait loop */
+    inline void cpuRelax() {
+
+        __asm__ __volatile__ ("pause" : : : "memory");
+    }
+
 
 }
 
@@ -0,0 +1,228 @@
+/***************************************************************************
+ *            idt.h
+ *
+ *  Copyright  2008  Matthias v.d. Vlies
+ *  matthias@mserver.nl
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*! \file idt.h
+ *  \brief Manager for the I386 Interrupt Descriptor Table
+ *   
+ *  This file defines the IDT Singleton class, IDT support structures and
+ *  the interrupt dispatch entry points used by the stubs in loader.asm.
+ *
+ */
+
+#ifndef _IDT_H
+#define	_IDT_H
+
+#include <config.h>
+#include <core/resource.h>
+#include <I386/i386.h>
+
+/*! Entry point for hardware interrupts, called from irq_common_stub
+ *
+ *\param registers The stack frame of the interrupted code
+ */
+extern "C" void _irq_handler(struct I386::Registers* registers);
+
+namespace I386 {
+    
+    /*! Number of descriptors in the IDT */
+    #define IDT_SIZE                    256
+    
+    /*! First vector used for hardware interrupts after remapping the PICs */
+    #define IRQ_BASE                    32
+    
+    /*! Number of hardware interrupt lines on the two PICs */
+    #define IRQ_COUNT                   16
+    
+    /*! Master PIC command port */
+    #define PIC1_COMMAND                0x20
+    
+    /*! Master PIC data port */
+    #define PIC1_DATA                   0x21
+    
+    /*! Slave PIC command port */
+    #define PIC2_COMMAND                0xa0
+    
+    /*! Slave PIC data port */
+    #define PIC2_DATA                   0xa1
+    
+    /*! End of interrupt command */
+    #define PIC_EOI                     0x20
+    
+    /*! Present, ring0, 32 bit interrupt gate */
+    #define IDT_INTERRUPT_GATE          0x8e
+    
+    /*! Type of a C-level interrupt handler
+     *
+     *\param registers The stack frame of the interrupted code
+     */
+    typedef void (*InterruptHandler)(struct Registers* registers);
+
+    /*! \struct IDTEntry
+     *\brief IDTEntry
+     *
+     * This struct defines an IDT gate
+     */
+    struct IDTEntry {
+        
+        /*! The lower part of the handler address */
+        unsigned short base_low;
+        
+        /*! The code segment selector of the handler */
+        unsigned short selector;
+        
+        /*! Always zero */
+        unsigned char zero;
+        
+        /*! Gate type and flags */
+        unsigned char flags;
+        
+        /*! The higher part of the handler address */
+        unsigned short base_high;
+
+    } __attribute__((packed));
+
+    /*! \struct IDTPointer
+     *\brief IDTPointer
+     *
+     * This struct defines the IDT Pointer type
+     */
+    struct IDTPointer {
+        
+        /*! The size of the IDT table in bytes minus one */
+        unsigned short limit;
+        
+        /*! Base address of the IDT Table */
+        unsigned int base;
+
+    } __attribute__((packed));
+
+    
+    /*! \class IDT
+     *\brief IDT Manager
+     *
+     * This class handles the Interrupt Descriptor Table and the 8259 PICs for the i386 CPU.
+     * Hardware handlers registered here run with interrupts disabled and should only
+     * acknowledge their device and raise a softirq for the remaining work.
+     */
+    class IDT : public Core::Resource {
+        
+    public:
+        
+        /*! A static function to get the singleton instance for the IDT manager
+        *
+        *\return The IDT instance
+        */
+        static IDT* getInstance();
+        
+        /*! Function for starting a resource
+         *
+         *\return A status indicating E_SUCCES or E_FAILURE
+         */
+        unsigned long startResource();
+
+        /*! Function for getting the name of a resource
+         *
+         *\return The resource's name
+         */
+        const char* getResourceName();
+        
+        /*! Function for loading the shared table on a secondary processor */
+        void initialiseProcessor();
+        
+        /*! Function for installing a handler for an interrupt vector.
+         *  Hardware interrupt lines are unmasked on the PIC when a handler is installed.
+         *  The handler gets published through RCU, dispatch reads it without a lock. A
+         *  replaced handler may still run on other processors until RCU::synchronize returns.
+         *
+         *\param interrupt The interrupt vector
+         *\param handler The handler to call, 0 to remove it
+         */
+        void registerHandler(unsigned char interrupt, InterruptHandler handler);
+        
+        /*! Function for dispatching an interrupt to its handler
+         *
+         *\param registers The stack frame built by the stub
+         *\return Wether a handler was installed for the vector
+         */
+        static bool dispatch(struct Registers* registers);
+        
+        /*! Function to check if the current processor is handling a hardware interrupt
+         *
+         *\return Wether a hardware interrupt handler or the softirqs of its exit are running
+         */
+        static bool isInInterrupt();
+
+    protected:
+
+        /*! Protected constructor to ensure singleton usage */
+        IDT();
+        
+    private:
+        
+        /*! Function for setting a gate in the Interrupt Descriptor Table
+         *
+         *\param interrupt The interrupt vector
+         *\param base The address of the stub
+         *\param selector The code segment selector
+         *\param flags The gate type and flags
+         */
+        void setGate(unsigned char interrupt, unsigned long base, unsigned short selector, unsigned char flags);
+        
+        /*! Function for remapping the PICs above the processor exceptions */
+        void remapPIC();
+        
+        /*! Function for masking or unmasking a hardware interrupt line
+         *
+         *\param irq The interrupt line
+         *\param enabled Wether the line should be unmasked
+         */
+        void setMask(unsigned char irq, bool enabled);
+        
+        /*! A static instance of the class for singleton usage */ 
+        static IDT* _instance;
+        
+        /*! The C-level handlers for each vector */
+        static InterruptHandler _handlers[IDT_SIZE];
+        
+        // the IRQ entry point keeps the nesting count
+        friend void ::_irq_handler(struct Registers* registers);
+        
+        /*! Nesting depth of hardware interrupts on each processor */
+        static volatile unsigned int _nesting[MAX_CPUS];
+        
+        /*! The entries for the Interrupt Descriptor Table */
+        struct IDTEntry* _idtEntries;
+ 
+        /*! The pointer to the Interrupt Descriptor Table */
+        struct IDTPointer* _idtPointer;
+        
+    };
+}
+
+/*! Entry point for processor exceptions, called from isr_common_stub
+ *
+ *\param registers The stack frame of the interrupted code
+ */
+extern "C" void _fault_handler(struct I386::Registers* registers);
+
+#endif	/* _IDT_H */
@@ -0,0 +1,103 @@
+/***************************************************************************
+ *            pit.h
+ *
+ *  Copyright  2008  Matthias v.d. Vlies
+ *  matthias@mserver.nl
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*! \file pit.h
+ *  \brief Driver for the 8253/8254 Programmable Interval Timer
+ *   
+ *  This file defines the PIT Singleton class. It drives the kernel tick on IRQ0.
+ *
+ */
+
+#ifndef _PIT_H
+#define	_PIT_H
+
+#include <core/resource.h>
+#include <I386/i386.h>
+
+namespace I386 {
+    
+    /*! Input clock of the PIT in Hz */
+    #define PIT_CLOCK                   1193182
+    
+    /*! Channel 0 data port */
+    #define PIT_CHANNEL0                0x40
+    
+    /*! Mode/command port */
+    #define PIT_COMMAND                 0x43
+    
+    /*! Vector of IRQ0 */
+    #define PIT_VECTOR                  32
+    
+    /*! \class PIT
+     *\brief PIT driver
+     *
+     * This class programs channel 0 of the PIT as a periodic tick of TIMER_FREQUENCY Hz
+     */
+    class PIT : public Core::Resource {
+        
+    public:
+        
+        /*! A static function to get the singleton instance for the PIT driver
+        *
+        *\return The PIT instance
+        */
+        static PIT* getInstance();
+        
+        /*! Function for starting a resource
+         *
+         *\return A status indicating E_SUCCES or E_FAILURE
+         */
+        unsigned long startResource();
+
+        /*! Function for getting the name of a resource
+         *
+         *\return The resource's name
+         */
+        const char* getResourceName();
+        
+        /*! Function to busy-wait until a number of ticks passed. Interrupts must be enabled,
+         *  the wait ends on a tick boundary and takes between ticks - 1 and ticks periods.
+         *
+         *\param ticks The number of ticks to wait
+         */
+        static void delay(unsigned long ticks);
+        
+    protected:
+
+        /*! Protected constructor to ensure singleton usage */
+        PIT();
+        
+    private:
+        
+        /*! Hard handler for IRQ0
+         *
+         *\param registers The stack frame of the interrupted code
+         */
+        static void interrupt(struct Registers* registers);
+        
+        /*! A static instance of the class for singleton usage */ 
+        static PIT* _instance;
+    };
+}
+
+#endif	/* _PIT_H */
@@ -0,0 +1,288 @@
+/***************************************************************************
+ *            smp.h
+ *
+ *  Copyright  2008  Matthias v.d. Vlies
+ *  matthias@mserver.nl
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*! \file smp.h
+ *  \brief Symmetric multiprocessing bring-up
+ *   
+ *  This file defines the SMP Singleton class. It finds the processors of the machine and
+ *  starts the application processors through a real-mode trampoline.
+ *
+ */
+
+#ifndef _SMP_H
+#define	_SMP_H
+
+#include <core/resource.h>
+#include <config.h>
+
+namespace I386 {
+    
+    /*! Physical address the trampoline gets copied to, must be page aligned, below 1 MB and
+     *  match TRAMPOLINE_BASE in loader.asm
+     */
+    #define SMP_TRAMPOLINE_BASE         0x7000
+    
+    /*! Number of ticks to wait after an INIT */
+    #define SMP_INIT_DELAY              10
+    
+    /*! Number of ticks to wait after a start-up interrupt */
+    #define SMP_STARTUP_DELAY           1
+    
+    /*! Number of ticks an application processor gets to come online */
+    #define SMP_ONLINE_TIMEOUT          100
+    
+    /*! Location of the real-mode segment of the extended BIOS data area */
+    #define SMP_EBDA_POINTER            0x40e
+    
+    /*! Start of the BIOS read-only area searched for firmware tables */
+    #define SMP_BIOS_START              0xe0000
+    
+    /*! End of the BIOS read-only area */
+    #define SMP_BIOS_END                0x100000
+    
+    /*! End of conventional memory, the MP table may live in its last kilobyte */
+    #define SMP_BASE_MEMORY_END         0xa0000
+    
+    /*! \struct RSDP
+     *\brief RSDP
+     *
+     * This struct defines the ACPI root system description pointer
+     */
+    struct RSDP {
+        
+        /*! "RSD PTR " */
+        char signature[8];
+        
+        /*! Makes the first 20 bytes add up to 0 */
+        unsigned char checksum;
+        
+        /*! Vendor of the tables */
+        char oem[6];
+        
+        /*! ACPI revision */
+        unsigned char revision;
+        
+        /*! Physical address of the RSDT */
+        unsigned int rsdt;
+
+    } __attribute__((packed));
+    
+    /*! \struct ACPIHeader
+     *\brief ACPIHeader
+     *
+     * This struct defines the header every ACPI system description table starts with
+     */
+    struct ACPIHeader {
+        
+        /*! Table signature, "RSDT" or "APIC" for the ones we read */
+        char signature[4];
+        
+        /*! Length of the table including this header */
+        unsigned int length;
+        
+        /*! Table revision */
+        unsigned char revision;
+        
+        /*! Makes the whole table add up to 0 */
+        unsigned char checksum;
+        
+        /*! Vendor and build information */
+        char oem[6], oemTable[8];
+        unsigned int oemRevision, creator, creatorRevision;
+
+    } __attribute__((packed));
+    
+    /*! \struct MPFloatingPointer
+     *\brief MPFloatingPointer
+     *
+     * This struct defines the MP specification floating pointer structure
+     */
+    struct MPFloatingPointer {
+        
+        /*! "_MP_" */
+        char signature[4];
+        
+        /*! Physical address of the configuration table */
+        unsigned int configuration;
+        
+        /*! Length in 16 byte units */
+        unsigned char length;
+        
+        /*! Version of the specification */
+        unsigned char revision;
+        
+        /*! Makes the structure add up to 0 */
+        unsigned char checksum;
+        
+        /*! Default configuration number, 0 when the configuration table is present */
+        unsigned char features[5];
+
+    } __attribute__((packed));
+    
+    /*! \struct MPConfiguration
+     *\brief MPConfiguration
+     *
+     * This struct defines the header of the MP configuration table
+     */
+    struct MPConfiguration {
+        
+        /*! "PCMP" */
+        char signature[4];
+        
+        /*! Length of the base table including this header */
+        unsigned short length;
+        
+        /*! Version of the specification */
+        unsigned char revision;
+        
+        /*! Makes the base table add up to 0 */
+        unsigned char checksum;
+        
+        /*! Vendor information */
+        char oem[8], product[12];
+        unsigned int oemTable;
+        unsigned short oemTableSize;
+        
+        /*! Number of entries following the header */
+        unsigned short entries;
+        
+        /*! Physical address of the local APICs */
+        unsigned int localApic;
+        
+        /*! Extended table information */
+        unsigned short extendedLength;
+        unsigned char extendedChecksum;
+        unsigned char reserved;
+
+    } __attribute__((packed));
+    
+    /*! \class SMP
+     *\brief SMP manager
+     *
+     * This class finds the processors from the ACPI MADT, or from the MP table on older
+     * machines, and starts every application processor with INIT-SIPI-SIPI. Each processor
+     * gets its own boot stack, GDT, TSS, idle thread and run queue before it goes online.
+     */
+    class SMP : public Core::Resource {
+        
+    public:
+        
+        /*! A static function to get the singleton instance for the SMP manager
+        *
+        *\return The SMP instance
+        */
+        static SMP* getInstance();
+        
+        /*! Function for starting a resource
+         *
+         *\return A status indicating E_SUCCES or E_FAILURE
+         */
+        unsigned long startResource();
+
+        /*! Function for getting the name of a resource
+         *
+         *\return The resource's name
+         */
+        const char* getResourceName();
+        
+        /*! Function to interrupt another processor so it reschedules
+         *
+         *\param cpu The processor, nothing happens when it is not online
+         */
+        static void kick(unsigned int cpu);
+
+    protected:
+
+        /*! Protected constructor to ensure singleton usage */
+        SMP();
+        
+    private:
+        
+        /*! Function to add a processor that was found in the firmware tables, duplicates
+         *  and processors beyond MAX_CPUS are ignored
+         *
+         *\param id The local APIC id
+         */
+        void addProcessor(unsigned int id);
+        
+        /*! Function to find the processors in the ACPI MADT
+         *
+         *\return Wether the table was found
+         */
+        bool parseMADT();
+        
+        /*! Function to find the processors in the MP configuration table
+         *
+         *\return Wether the table was found
+         */
+        bool parseMPTable();
+        
+        /*! Function to get the start of the extended BIOS data area from the BIOS data area
+         *
+         *\return The physical address of the EBDA
+         */
+        unsigned long getEBDA();
+        
+        /*! Function to search memory for a signature on a 16 byte boundary with a valid
+         *  checksum
+         *
+         *\param start The first address
+         *\param end The address to stop at
+         *\param signature The signature
+         *\param length Length of the signature
+         *\param checksumLength Number of bytes covered by the checksum
+         *\return The address of the match, 0 if none
+         */
+        unsigned char* findSignature(unsigned long start, unsigned long end, const char* signature, unsigned int length, unsigned int checksumLength);
+        
+        /*! Function to start one application processor and wait for it
+         *
+         *\param cpu The kernel processor number, its local APIC id is in _apicIds
+         *\return Wether the processor came online
+         */
+        bool startProcessor(unsigned int cpu);
+        
+        /*! Function the trampoline calls on an application processor
+         *
+         *\param cpu The kernel processor number
+         */
+        static void processorEntry(unsigned int cpu);
+        
+        /*! A static instance of the class for singleton usage */ 
+        static SMP* _instance;
+        
+        /*! The local APIC id of each processor, the boot processor comes first */
+        unsigned int _apicIds[MAX_CPUS];
+        
+        /*! Number of processors found */
+        unsigned int _count;
+        
+        /*! The top of the boot stack of each processor */
+        unsigned long _stacks[MAX_CPUS];
+        
+        /*! Wether each processor runs kernel code */
+        volatile bool _online[MAX_CPUS];
+    };
+}
+
+#endif	/* _SMP_H */
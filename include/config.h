@@ -71,12 +71,30 @@ extern "C" const unsigned long end;
 /*! start address for the static memory allocator */
 #define STATIC_ALLOC_BASE           KERNEL_END
 
-/*! size of the static memory region */
-#define STATIC_ALLOC_SIZE           0x10000
+/*! size of the static memory region, holds kernel thread stacks as well */
+#define STATIC_ALLOC_SIZE           0x100000
 
 /*! end of the static memory region */
 #define STATIC_ALLOC_END            STATIC_ALLOC_BASE + STATIC_ALLOC_SIZE
 
+/*! Maximum number of processors the kernel keeps per-CPU state for */
+#define MAX_CPUS                    8
+
+/*! Frequency of the kernel tick in Hz */
+#define TIMER_FREQUENCY             1000
+
+/*! Size of the kernel stack of a thread */
+#define THREAD_STACK_SIZE           0x2000
+
+/*! Number of ticks the lowest priority thread may run before it gets preempted */
+#define THREAD_MIN_TIME_SLICE       5
+
+/*! Number of ticks the highest priority thread may run before it gets preempted */
+#define THREAD_MAX_TIME_SLICE       100
+
+/*! Number of screens of history every video terminal keeps for scrolling back */
+#define TERMINAL_SCROLLBACK_SCREENS 4
+
 /*! True alias */
 #define TRUE                        1
 
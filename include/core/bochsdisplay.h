@@ -0,0 +1,151 @@
+/***************************************************************************
+ *            bochsdisplay.h
+ *
+ *  Copyright  2008  Matthias v.d. Vlies
+ *  matthias@mserver.nl
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+
+/*! \file bochsdisplay.h
+ *  \brief Bochs/QEMU display adapter
+ *   
+ *  This file declares the driver for the DISPI interface of the display
+ *  adapter emulated by Bochs and QEMU (-vga std).
+ *
+ */
+
+#ifndef _BOCHSDISPLAY_H
+#define	_BOCHSDISPLAY_H
+
+#include <I386/i386.h>
+
+namespace Core {
+
+/*! Port selecting a DISPI register */
+#define BOCHS_DISPLAY_INDEX_PORT                0x1ce
+
+/*! Port reading or writing the selected DISPI register */
+#define BOCHS_DISPLAY_DATA_PORT                 0x1cf
+
+// DISPI registers
+/*! Interface version */
+#define BOCHS_DISPLAY_ID                        0x00
+
+/*! Horizontal resolution */
+#define BOCHS_DISPLAY_XRES                      0x01
+
+/*! Vertical resolution */
+#define BOCHS_DISPLAY_YRES                      0x02
+
+/*! Bits per pixel */
+#define BOCHS_DISPLAY_BPP                       0x03
+
+/*! Enable flags */
+#define BOCHS_DISPLAY_ENABLE                    0x04
+
+/*! Width of the video memory in pixels */
+#define BOCHS_DISPLAY_VIRT_WIDTH                0x06
+
+/*! Height of the video memory in lines */
+#define BOCHS_DISPLAY_VIRT_HEIGHT               0x07
+
+/*! First line of the video memory on screen */
+#define BOCHS_DISPLAY_Y_OFFSET                  0x09
+
+/*! Lowest interface version with a virtual screen and offsets */
+#define BOCHS_DISPLAY_ID_MIN                    0xb0c1
+
+/*! Highest known interface version */
+#define BOCHS_DISPLAY_ID_MAX                    0xb0c5
+
+/*! The graphics mode is enabled */
+#define BOCHS_DISPLAY_ENABLED                   0x01
+
+/*! \class BochsDisplay
+ *\brief BochsDisplay class
+ * This class drives the DISPI registers of the Bochs and QEMU display
+ * adapter. The video memory is made several screens high so a frame can be
+ * drawn off-screen and shown by moving the first visible line.
+ * It uses the Singleton Pattern to ensure there is only one instance. To get
+ * the instance you should use the getInstance() method.
+ */
+class BochsDisplay {
+    
+public:
+    
+    /*! A static function to get the singleton instance for the display driver
+     *
+     *\return The BochsDisplay instance
+     */
+    static BochsDisplay* getInstance();
+    
+    /*! Function to check for the adapter
+     *
+     *\return Wether the DISPI interface is there
+     */
+    bool isPresent();
+    
+    /*! Function for making room for several pages in the running mode
+     *
+     *\param width Width of the mode in pixels
+     *\param height Height of the mode in pixels
+     *\param depth Bits per pixel of the mode
+     *\param pages Number of screens to fit in the video memory
+     *\return E_SUCCESS, or E_FAILURE when the adapter runs another mode or lacks the memory
+     */
+    unsigned long setPages(unsigned long width, unsigned long height, unsigned long depth, unsigned long pages);
+    
+    /*! Function for showing a page, takes effect with the next refresh
+     *
+     *\param page The page to show
+     */
+    void showPage(unsigned long page);
+    
+protected:
+    
+    /*! Protected constructor to ensure singleton usage */
+    BochsDisplay();
+    
+private:
+    
+    /*! Function for reading a DISPI register
+     *
+     *\param index The register
+     *\return Its value
+     */
+    unsigned short readRegister(unsigned short index);
+    
+    /*! Function for writing a DISPI register
+     *
+     *\param index The register
+     *\param value The value to write
+     */
+    void writeRegister(unsigned short index, unsigned short value);
+    
+    /*! A static instance of the class for singleton usage */ 
+    static BochsDisplay* _instance;
+    
+    /*! Height of a page in lines */
+    unsigned long _height;
+    
+};
+
+} /* namespace Core */
+
+#endif	/* _BOCHSDISPLAY_H */
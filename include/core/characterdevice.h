@@ -44,8 +44,9 @@ class CharacterDevice : public Resource {
     
 private:
     
-    // we only want the Console class to I/O with this class
+    // we only want the Console and Terminal classes to I/O with this class
     friend class Console;
+    friend class Terminal;
     
     /*! Function to clear the screen's contents */
     virtual void clearBuffer() = 0;
@@ -58,6 +59,29 @@ private:
      */
     virtual unsigned long write(void* buffer, unsigned long size) = 0;
     
+    /*! Function for writing part of a Character Device's buffer, only the
+     *  cells from offset up to offset + size are replaced
+     *
+     *\param buffer The cells to copy
+     *\param offset The first cell of the device to replace
+     *\param size The number of cells to copy
+     *\return An error code or E_SUCCESS
+     */
+    virtual unsigned long write(void* buffer, unsigned long offset, unsigned long size) = 0;
+    
+    /*! Function for showing the cells written since the last call, devices that
+     *  draw straight to the screen have nothing to do
+     */
+    virtual void present() = 0;
+    
+    /*! Function for showing another page, the contents of the pages are kept. Rows
+     *  past the end of the page continue on the next one
+     *
+     *\param page The page to show
+     *\param row The row of the page shown at the top of the screen
+     */
+    virtual void showPage(unsigned long page, unsigned long row) = 0;
+    
 public:
     
     /*! Function for what kind of terminal is supported for this CharacterDevice
@@ -66,6 +90,24 @@ public:
      *\see terminal.h
      */
     virtual unsigned long getTerminalType() = 0;
+    
+    /*! Function for getting the number of cells on a row
+     *
+     *\return The number of columns, 0 for devices without cells
+     */
+    virtual unsigned long getColumns() = 0;
+    
+    /*! Function for getting the number of rows of cells
+     *
+     *\return The number of rows, 0 for devices without cells
+     */
+    virtual unsigned long getRows() = 0;
+    
+    /*! Function for getting the number of screens the device holds at once
+     *
+     *\return The number of pages, 0 for devices without cells
+     */
+    virtual unsigned long getPages() = 0;
      
 };
 
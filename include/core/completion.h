@@ -0,0 +1,90 @@
+/***************************************************************************
+ *            completion.h
+ *
+ *  Copyright  2008  Matthias v.d. Vlies
+ *  matthias@mserver.nl
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*! \file completion.h
+ *  \brief Completions
+ *   
+ *  This file defines the Completion class, for waiting until another thread or an interrupt
+ *  handler signals that some work is done.
+ *
+ */
+
+#ifndef _COMPLETION_H
+#define	_COMPLETION_H
+
+#include <config.h>
+#include <core/waitqueue.h>
+
+namespace Core {
+
+/*! Count a completion gets after completeAll(), waits no longer consume it */
+#define COMPLETION_ALL                          0x80000000
+
+/*! \class Completion
+ *\brief Completion class
+ *
+ * A counted event. Every complete() lets one wait() return, also when it came first, so the
+ * signalling side never has to know if somebody is already waiting. A zeroed completion has
+ * not completed.
+ */
+class Completion {
+    
+public:
+    
+    /*! Constructor */
+    Completion();
+    
+    /*! Function to sleep until the completion got signalled */
+    void wait();
+    
+    /*! Function to let one waiter continue, safe from interrupt handlers */
+    void complete();
+    
+    /*! Function to let all current and future waiters continue, safe from interrupt handlers */
+    void completeAll();
+    
+    /*! Function to check for a signal without consuming it
+     *
+     *\return Wether wait() would return immediately
+     */
+    bool isDone();
+    
+private:
+    
+    /*! Wait condition consuming one signal
+     *
+     *\param data The completion
+     *\return Wether a signal got consumed
+     */
+    static bool consume(void* data);
+    
+    /*! Number of signals not consumed yet */
+    volatile unsigned long _done;
+    
+    /*! The waiting threads */
+    WaitQueue _waiters;
+};
+
+} /* namespace Core */
+
+#endif	/* _COMPLETION_H */
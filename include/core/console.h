@@ -34,9 +34,17 @@
 
 #include <core/terminal.h>
 #include <core/resource.h>
+#include <core/spinlock.h>
+#include <core/timer.h>
 
 namespace Core {
 
+/*! Number of ticks output without a newline may stay in the terminal before it gets flushed */
+#define CONSOLE_FLUSH_DELAY                     10
+
+/*! Number of virtual terminals, each keeps its own scrollback */
+#define CONSOLE_TERMINALS                       3
+
 /*! \class Console
  *\brief Console class
  *
@@ -53,7 +61,22 @@ public:
      */
     static Console* getInstance();
     
-    /*! Function to switch to another virtual terminal
+    /*! Function to add a virtual terminal, it gets a page of its own when the device has one to spare
+     *
+     *\param terminal The terminal to add
+     *\return E_SUCCESS, or E_FAILURE when all CONSOLE_TERMINALS slots are taken
+     */
+    unsigned long addTerminal(Terminal* terminal);
+    
+    /*! Function to get a virtual terminal
+     *
+     *\param index The number of the terminal, in the order they were added
+     *\return The terminal or 0 when there is none
+     */
+    Terminal* getTerminal(unsigned int index);
+    
+    /*! Function to switch to another virtual terminal. A terminal on a page of its own is
+     *  shown by moving the start of the display, others are copied to the device.
      *
      *\param terminal The terminal to switch to
      */
@@ -86,6 +109,46 @@ public:
      */
     void write(const char* sequence, short color);
     
+    /*! Function to write a sequence of characters of known length to the current active
+     *  virtual terminal, the sequence may be longer than the screen and need not be terminated.
+     *  Not an overload of write, a length would be ambiguous with the color of MAKE_COLOR.
+     *
+     *\param sequence The sequence of chars to write
+     *\param length The number of chars in the sequence
+     */
+    void writeBuffer(const char* sequence, unsigned long length);
+    
+    /*! Function to write a sequence of characters of known length to a virtual terminal.
+     *  Output to a terminal in the background only changes its buffer and is copied to the
+     *  device when switching to it.
+     *
+     *\param terminal The terminal to write to
+     *\param sequence The sequence of chars to write
+     *\param length The number of chars in the sequence
+     */
+    void writeTerminal(Terminal* terminal, const char* sequence, unsigned long length);
+    
+    /*! Function to show buffered output on the screen and move the cursor. Output ending
+     *  a line is flushed right away, everything else within CONSOLE_FLUSH_DELAY ticks.
+     */
+    void flush();
+    
+    /*! Function to write and show text from code that may have interrupted the holder of
+     *  the console lock, like a fault handler. Never waits for the lock, interrupts must
+     *  be disabled.
+     *
+     *\param sequence The text
+     *\return Wether the lock was free and the text got shown
+     */
+    bool tryWrite(const char* sequence);
+    
+    /*! Function to move the view of the active virtual terminal through its scrollback,
+     *  the next write returns to the live screen
+     *
+     *\param rows Number of rows to move back, negative moves forward
+     */
+    void scrollHistory(int rows);
+    
     /*! Function for starting a resource
      *
      *\return A status indicating E_SUCCES or E_FAILURE
@@ -105,15 +168,53 @@ protected:
     
 private:
     
-    /*! Function to copy the Terminal's buffer to the Character Device's buffer */
+    /*! Function to copy the changed rows of the Terminal's buffer to the Character Device's buffer */
     void copyBuffer();
     
+    /*! Function to put a sequence into the active terminal and schedule the flush, the
+     *  lock must be held
+     *
+     *\param sequence The sequence of chars to write
+     *\param length The number of chars in the sequence
+     */
+    void append(const char* sequence, unsigned long length);
+    
+    /*! Function to update the cursor and copy the buffer, the lock must be held */
+    void flushLocked();
+    
+    /*! Timer function flushing output which did not end a line
+     *
+     *\param data Unused
+     */
+    static void flushTimer(unsigned long data);
+    
    /*! A static instance of the class for singleton usage */ 
     static Console* _instance; 
     
     /*! The instance of the current active terminal */
     Terminal* _activeTerminal;
     
+    /*! The virtual terminals in the order they were added */
+    Terminal* _terminals[CONSOLE_TERMINALS];
+    
+    /*! Number of virtual terminals added */
+    unsigned int _terminalCount;
+    
+    /*! Lock serialising output from all processors and interrupt context */
+    SpinLock _lock;
+    
+    /*! Timer flushing output which did not end a line */
+    Timer _flushTimer;
+    
+    /*! Wether the flush timer is queued, only changed with the lock held */
+    bool _flushArmed;
+    
+    /*! Position the hardware cursor was last moved to, -1 when unknown */
+    int _cursor;
+    
+    /*! First cell the device was last told to show, -1 when unknown */
+    int _start;
+    
 };
 
 } /* namespace Core */
@@ -0,0 +1,98 @@
+/***************************************************************************
+ *            cpu.h
+ *
+ *  Copyright  2008  Matthias v.d. Vlies
+ *  matthias@mserver.nl
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*! \file cpu.h
+ *  \brief Processor identification
+ *   
+ *  This file defines the CPU class. It identifies the processor the calling code runs on,
+ *  which is used as index into per-CPU state.
+ *
+ */
+
+#ifndef _CPU_H
+#define	_CPU_H
+
+#include <config.h>
+#include <core/percpu.h>
+
+namespace Core {
+
+/*! \class CPU
+ *\brief CPU class
+ *
+ * Static helper class for identifying the current processor. The architecture hands out
+ * kernel processor numbers; every processor finds its own in its per-CPU area.
+ */
+class CPU {
+    
+public:
+    
+    /*! Function to get the index of the processor executing this code
+     *
+     *\return A number between 0 and MAX_CPUS - 1
+     */
+    static inline unsigned int getCurrentId() {
+        
+        // one load through GS, the zeroed boot area says processor 0
+        return PERCPU_READ(cpu);
+    }
+    
+    /*! Function to get the number of processors running kernel code
+     *
+     *\return The number of processors
+     */
+    static unsigned int getCount();
+    
+    /*! Function to assign a kernel processor number to a hardware processor, before the
+     *  processor gets started
+     *
+     *\param cpu The kernel processor number
+     *\param hardwareId The hardware id of the processor
+     */
+    static void registerProcessor(unsigned int cpu, unsigned int hardwareId);
+    
+    /*! Function to mark a processor as running kernel code
+     *
+     *\param cpu The kernel processor number
+     */
+    static void setOnline(unsigned int cpu);
+    
+    /*! Function to check if a processor runs kernel code
+     *
+     *\param cpu The kernel processor number
+     *\return Wether the processor is online
+     */
+    static bool isOnline(unsigned int cpu);
+    
+private:
+    
+    /*! Number of registered processors */
+    static unsigned int _count;
+    
+    /*! Bit n is set when processor n is online */
+    static volatile unsigned long _online;
+};
+
+} /* namespace Core */
+
+#endif	/* _CPU_H */
@@ -0,0 +1,50 @@
+/***************************************************************************
+ *            font.h
+ *
+ *  Copyright  2008  Matthias v.d. Vlies
+ *  matthias@mserver.nl
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*! \file font.h
+ *  \brief Console font
+ *   
+ *  This file declares the bitmap font used to draw text on a framebuffer.
+ *
+ */
+
+#ifndef _FONT_H
+#define	_FONT_H
+
+namespace Core {
+
+/*! Width of a glyph in pixels, one bit per pixel */
+#define FONT_WIDTH                              8
+
+/*! Height of a glyph in pixels, one byte per row */
+#define FONT_HEIGHT                             8
+
+/*! Number of glyphs, the ASCII range */
+#define FONT_GLYPHS                             128
+
+/*! The glyphs, the most significant bit of a row is the leftmost pixel. Control characters are blank. */
+extern const unsigned char fontGlyphs[FONT_GLYPHS][FONT_HEIGHT];
+
+} /* namespace Core */
+
+#endif	/* _FONT_H */
@@ -0,0 +1,138 @@
+/***************************************************************************
+ *            format.h
+ *
+ *  Copyright  2008  Matthias v.d. Vlies
+ *  matthias@mserver.nl
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+
+/*! \file format.h
+ *  \brief Formatted output
+ *   
+ *  This file declares printf style formatting without heap allocation. The
+ *  compiler checks the arguments against the format string.
+ *
+ */
+
+#ifndef _FORMAT_H
+#define	_FORMAT_H
+
+namespace Core {
+
+/*! Characters needed for the longest number, 20 decimal digits and a terminator */
+#define FORMAT_NUMBER_SIZE                      24
+
+/*! Characters formatted on the stack before they are handed to the output */
+#define FORMAT_BUFFER_SIZE                      128
+
+/*! Macro for letting the compiler check the arguments of a formatting function
+ *
+ *\param string Position of the format string
+ *\param first Position of the first argument to format
+ */
+#define FORMAT_CHECK(string, first)             __attribute__((format(printf, string, first)))
+
+/*! Variable argument list of the formatting functions */
+typedef __builtin_va_list FormatArguments;
+
+/*! Type of a function receiving formatted text
+ *
+ *\param data The data given to Format::print()
+ *\param text The text, not terminated
+ *\param length The number of characters
+ */
+typedef void (*FormatOutput)(void* data, const char* text, unsigned long length);
+
+/*! \class Format
+ *\brief Format class
+ *
+ * Formats text for printf style format strings. Supported are the flags
+ * '-' and '0', a field width, the length modifiers l and ll and the
+ * conversions d, i, u, x, X, p, c, s and %. Numbers are converted two
+ * digits at a time through tables.
+ */
+class Format {
+    
+public:
+    
+    /*! Function to convert a number to decimal
+     *
+     *\param value The value
+     *\param buffer Buffer of at least FORMAT_NUMBER_SIZE characters, the digits get terminated
+     *\return The number of digits
+     */
+    static unsigned long toDecimal(unsigned long long value, char* buffer);
+    
+    /*! Function to convert a number to hexadecimal, without a prefix
+     *
+     *\param value The value
+     *\param buffer Buffer of at least FORMAT_NUMBER_SIZE characters, the digits get terminated
+     *\param upper Wether to use upper case digits
+     *\return The number of digits
+     */
+    static unsigned long toHex(unsigned long long value, char* buffer, bool upper);
+    
+    /*! Function to format text and hand it to an output in pieces of up to FORMAT_BUFFER_SIZE characters
+     *
+     *\param output The function receiving the text
+     *\param data Passed to the output
+     *\param format The format string
+     *\param arguments The arguments
+     */
+    static void print(FormatOutput output, void* data, const char* format, FormatArguments arguments);
+    
+    /*! Function to format text into a buffer, text that does not fit is cut off
+     *
+     *\param buffer The buffer, always terminated
+     *\param size The size of the buffer
+     *\param format The format string
+     *\return The length of the text in the buffer
+     */
+    static unsigned long string(char* buffer, unsigned long size, const char* format, ...) FORMAT_CHECK(3, 4);
+    
+    /*! Function to format text into a buffer, text that does not fit is cut off
+     *
+     *\param buffer The buffer, always terminated
+     *\param size The size of the buffer
+     *\param format The format string
+     *\param arguments The arguments
+     *\return The length of the text in the buffer
+     */
+    static unsigned long stringList(char* buffer, unsigned long size, const char* format, FormatArguments arguments);
+    
+private:
+    
+    /*! Function to divide a 64 bit number without the compiler's runtime library
+     *
+     *\param value The value, replaced by the quotient
+     *\param divisor The divisor
+     *\return The remainder
+     */
+    static unsigned long divide(unsigned long long* value, unsigned long divisor);
+};
+
+/*! Function to write formatted text to the active virtual terminal
+ *
+ *\param format The format string
+ */
+void kprintf(const char* format, ...) FORMAT_CHECK(1, 2);
+
+} /* namespace Core */
+
+#endif	/* _FORMAT_H */
@@ -0,0 +1,244 @@
+/***************************************************************************
+ *            framebuffer.h
+ *
+ *  Copyright  2008  Matthias v.d. Vlies
+ *  matthias@mserver.nl
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+
+/*! \file framebuffer.h
+ *  \brief Linear framebuffer text device
+ *   
+ *  This file declares a character device that draws text cells on a linear
+ *  framebuffer set up by the boot loader.
+ *
+ */
+
+#ifndef _FRAMEBUFFER_H
+#define	_FRAMEBUFFER_H
+
+#include <core/characterdevice.h>
+#include <core/resource.h>
+#include <core/font.h>
+#include <core/bochsdisplay.h>
+#include <I386/fpu.h>
+
+namespace Core {
+
+/*! Width of a cell in pixels */
+#define FRAMEBUFFER_CELL_WIDTH                  FONT_WIDTH
+
+/*! Height of a cell in pixels, every row of a glyph is drawn twice */
+#define FRAMEBUFFER_CELL_HEIGHT                 (FONT_HEIGHT * 2)
+
+/*! The only supported number of bits per pixel */
+#define FRAMEBUFFER_DEPTH                       32
+
+/*! Number of pages drawn in turn when flipping, one on screen and one hidden */
+#define FRAMEBUFFER_PAGES                       2
+
+/*! Number of entries in the colour palette */
+#define FRAMEBUFFER_COLORS                      16
+
+/*! \class Framebuffer
+ *\brief Framebuffer class
+ * This class draws the cells of a terminal on a linear 32 bits per pixel
+ * framebuffer. A copy of the cells on screen is kept so only cells that
+ * changed are drawn again. Glyph rows are expanded through a table of pixel
+ * masks, which lets SSE store a whole row of a cell at once. On adapters with
+ * room for two screens, cells are drawn off-screen and shown by flipping
+ * pages in present().
+ * It uses the Singleton Pattern to ensure there is only one instance. To get
+ * the instance you should use the getInstance() method.
+ */
+class Framebuffer : public CharacterDevice {
+    
+public:
+    
+    /*! A static function to get the singleton instance for the framebuffer driver
+     *
+     *\return The Framebuffer instance
+     */
+    static Framebuffer* getInstance();
+    
+    /*! Function for taking over a framebuffer
+     *
+     *\param address Physical address of the first pixel
+     *\param pitch Number of bytes between the start of two lines
+     *\param width Width in pixels
+     *\param height Height in pixels
+     *\param depth Number of bits per pixel
+     *\return E_SUCCESS, or E_FAILURE for unsupported modes and when out of memory
+     */
+    unsigned long setMode(unsigned long address, unsigned long pitch, unsigned long width, unsigned long height, unsigned long depth);
+    
+    /*! Function for drawing off-screen and flipping pages from now on
+     *
+     *\param display The adapter running the mode
+     *\return E_SUCCESS, or E_FAILURE when the adapter can not hold two pages or when out of memory
+     */
+    unsigned long enableFlipping(BochsDisplay* display);
+    
+    /*! Function for what kind of terminal is supported for this CharacterDevice
+     *
+     *\return The type of terminal
+     *\see terminal.h
+     */
+    unsigned long getTerminalType();
+    
+    /*! Function for getting the number of cells on a row
+     *
+     *\return The number of columns, 0 for devices without cells
+     */
+    unsigned long getColumns();
+    
+    /*! Function for getting the number of rows of cells
+     *
+     *\return The number of rows, 0 for devices without cells
+     */
+    unsigned long getRows();
+    
+    /*! Function for getting the number of screens the device holds at once
+     *
+     *\return The number of pages, 0 for devices without cells
+     */
+    unsigned long getPages();
+    
+    /*! Function for starting a resource
+     *
+     *\return A status indicating E_SUCCES or E_FAILURE
+     */
+    unsigned long startResource();
+    
+    /*! Function for getting the name of a resource
+     *
+     *\return The resource's name
+     */
+    const char* getResourceName();
+    
+protected:
+    
+    /*! Protected constructor to ensure singleton usage */
+    Framebuffer();
+    
+private:
+    
+    // we only want the Console class to I/O with this class
+    friend class Console;
+    
+    /*! Function to clear the screen's contents */
+    void clearBuffer();
+    
+    /*! Function for writing to a Character Device's buffer 
+     *
+     *\param buffer The buffer to copy
+     *\param size The size of the buffer
+     *\return An error code or E_SUCCESS
+     */
+    unsigned long write(void* buffer, unsigned long size);
+    
+    /*! Function for writing part of a Character Device's buffer, only the
+     *  cells from offset up to offset + size are replaced
+     *
+     *\param buffer The cells to copy
+     *\param offset The first cell of the device to replace
+     *\param size The number of cells to copy
+     *\return An error code or E_SUCCESS
+     */
+    unsigned long write(void* buffer, unsigned long offset, unsigned long size);
+    
+    /*! Function for showing the cells written since the last call, draws the
+     *  changed cells on the hidden page and flips to it
+     */
+    void present();
+    
+    /*! Function for showing another page, the contents of the pages are kept. Rows
+     *  past the end of the page continue on the next one
+     *
+     *\param page The page to show
+     *\param row The row of the page shown at the top of the screen
+     */
+    void showPage(unsigned long page, unsigned long row);
+    
+    /*! Function for drawing a single cell
+     *
+     *\param page The page to draw on
+     *\param position The number of the cell on screen
+     *\param cell The character and its attribute
+     *\param simd Wether SSE may be used
+     */
+    void drawCell(unsigned long page, unsigned long position, short cell, bool simd);
+    
+    /*! Function for borrowing the SSE registers. Only uses an FPU that has already
+     *  been started, creating it here would print to the console we are drawing
+     *
+     *\return Wether SSE may be used, endKernelUse() must follow when true
+     */
+    bool beginSimd();
+    
+    /*! Function to fill the table of pixel masks */
+    static void expandMasks();
+    
+    /*! A static instance of the class for singleton usage */ 
+    static Framebuffer* _instance;
+    
+    /*! Pixel masks for every possible row of a glyph, all bits of a pixel are set when it is lit */
+    static unsigned long _masks[256][FONT_WIDTH] __attribute__((aligned(16)));
+    
+    /*! The colours of the text mode attributes as 0x00RRGGBB */
+    static const unsigned long _palette[FRAMEBUFFER_COLORS];
+    
+    /*! The first pixel, 0 while no mode is set */
+    unsigned char* _base;
+    
+    /*! Number of bytes between the start of two lines */
+    unsigned long _pitch;
+    
+    /*! Width in pixels */
+    unsigned long _width;
+    
+    /*! Height in pixels */
+    unsigned long _height;
+    
+    /*! Number of cells on a row */
+    unsigned long _columns;
+    
+    /*! Number of rows of cells */
+    unsigned long _rows;
+    
+    /*! The cells as they are on each page */
+    short* _shadows[FRAMEBUFFER_PAGES];
+    
+    /*! The cells written but not yet presented, only used when flipping */
+    short* _cells;
+    
+    /*! The adapter flipping the pages, 0 when drawing on screen */
+    BochsDisplay* _display;
+    
+    /*! The hidden page drawn by the next present() */
+    unsigned long _page;
+    
+    /*! The started FPU, 0 until it is found */
+    I386::FPU* _fpu;
+    
+};
+
+} /* namespace Core */
+
+#endif	/* _FRAMEBUFFER_H */
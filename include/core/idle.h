@@ -0,0 +1,128 @@
+/***************************************************************************
+ *            idle.h
+ *
+ *  Copyright  2008  Matthias v.d. Vlies
+ *  matthias@mserver.nl
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*! \file idle.h
+ *  \brief Idle loop
+ *   
+ *  This file defines the Idle class, the loop idle threads run when a processor has nothing
+ *  to do.
+ *
+ */
+
+#ifndef _IDLE_H
+#define	_IDLE_H
+
+#include <config.h>
+
+namespace Core {
+
+/*! CPUID leaf 1 ECX bit for MONITOR/MWAIT support */
+#define IDLE_CPUID_MONITOR                      (1 << 3)
+
+/*! CPUID leaf describing MONITOR/MWAIT */
+#define IDLE_CPUID_MWAIT_LEAF                   0x05
+
+/*! Size the per-CPU state is padded to, so a wakeup store only hits the monitored line */
+#define IDLE_CACHE_LINE                         64
+
+/*! \class Idle
+ *\brief Idle class
+ *
+ * Static class with the idle loop of all processors. A processor without work sleeps in
+ * MWAIT when CPUID reports it, monitoring a line of its own, so a thread queued from another
+ * processor wakes it with a plain store instead of an interrupt. The C-state hint is the
+ * deepest one the MONITOR leaf lists. Without MWAIT the processor halts until the next
+ * interrupt. The time spent sleeping is counted per processor.
+ */
+class Idle {
+    
+public:
+    
+    /*! Function to detect MWAIT support, called once on the boot processor */
+    static void initialise();
+    
+    /*! Function run by the idle thread of the current processor, never returns */
+    static void run();
+    
+    /*! Function to wake a processor that sleeps in MWAIT
+     *
+     *\param cpu The processor
+     *\return Wether the processor got woken, false when it needs an interrupt
+     */
+    static bool wake(unsigned int cpu);
+    
+    /*! Function to get the time a processor spent sleeping
+     *
+     *\param cpu The processor
+     *\return The sleeping time in cycles
+     */
+    static unsigned long long getResidency(unsigned int cpu);
+    
+    /*! Function to print the idle time of all processors on the console */
+    static void print();
+    
+private:
+    
+    /*! \struct CPUData
+     *\brief CPUData
+     *
+     * The idle state of one processor
+     */
+    struct CPUData {
+        
+        /*! Set while the processor waits in MWAIT */
+        volatile unsigned long polling;
+        
+        /*! The monitored word, written to wake the processor */
+        volatile unsigned long wake;
+        
+        /*! Cycles spent sleeping */
+        unsigned long long residency;
+        
+        /*! Time stamp the idle loop started at */
+        unsigned long long started;
+        
+        /*! Number of times the processor went to sleep */
+        unsigned long entries;
+        
+    } __attribute__((aligned(IDLE_CACHE_LINE)));
+    
+    /*! Function to sleep until there is work or an interrupt
+     *
+     *\param data The state of the current processor
+     */
+    static void sleep(CPUData* data);
+    
+    /*! Wether the processors sleep in MWAIT */
+    static bool _mwait;
+    
+    /*! The C-state hint for MWAIT */
+    static unsigned long _hint;
+    
+    /*! The idle state of each processor */
+    static CPUData _cpus[MAX_CPUS];
+};
+
+} /* namespace Core */
+
+#endif	/* _IDLE_H */
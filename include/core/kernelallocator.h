@@ -33,6 +33,7 @@
 #define	_KERNELALLOCATOR_H
 
 #include <core/allocator.h>
+#include <core/spinlock.h>
 
 namespace Core {
 
@@ -40,6 +41,8 @@ namespace Core {
  *\brief KernelAllocator class
  *
  * The allocator class will choose wich allocator should be used for a request. Singleton class.
+ * Requests from all processors are serialised here, the allocators behind it need no locking
+ * of their own.
  *
  */
 class KernelAllocator : public Allocator {
@@ -102,6 +105,9 @@ private:
     /*! The current default allocator */
     Allocator* _allocator;
     
+    /*! Queue lock, every new and delete on every processor passes through here */
+    MCSLock _lock;
+    
 protected:
     
     /*! Constructor for the KernelAllocator class */
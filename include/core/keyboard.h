@@ -0,0 +1,241 @@
+/***************************************************************************
+ *            keyboard.h
+ *
+ *  Copyright  2008  Matthias v.d. Vlies
+ *  matthias@mserver.nl
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*! \file keyboard.h
+ *  \brief PS/2 Keyboard Driver
+ *   
+ *  This file defines the Keyboard class. The keyboard class handles input from the PS/2 keyboard.
+ *  The class uses a Sigleton design pattern.
+ *
+ */
+
+#ifndef _KEYBOARD_H
+#define	_KEYBOARD_H
+
+#include <core/characterdevice.h>
+#include <core/resource.h>
+#include <core/ringbuffer.h>
+#include <I386/i386.h>
+
+namespace Core {
+
+/*! PS/2 controller data port */
+#define KEYBOARD_DATA                           0x60
+
+/*! PS/2 controller status port */
+#define KEYBOARD_STATUS                         0x64
+
+/*! Vector of IRQ1 */
+#define KEYBOARD_VECTOR                         33
+
+/*! Number of scancodes buffered between the interrupt handler and the softirq */
+#define KEYBOARD_BUFFER_SIZE                    256
+
+/*! Keycode of the first function key, F1 to F12 follow in order */
+#define KEY_F1                                  0x80
+
+/*! Number of function keys */
+#define KEY_FUNCTION_COUNT                      12
+
+/*! Keycode of shift + page up, scrolls the console back */
+#define KEY_SCROLL_UP                           (KEY_F1 + KEY_FUNCTION_COUNT)
+
+/*! Keycode of shift + page down, scrolls the console forward */
+#define KEY_SCROLL_DOWN                         (KEY_F1 + KEY_FUNCTION_COUNT + 1)
+
+/*! Keycode of the up arrow, down, right and left follow in the order of the ANSI
+ *  cursor sequences */
+#define KEY_CURSOR_UP                           (KEY_F1 + KEY_FUNCTION_COUNT + 2)
+
+/*! Keycode of the down arrow */
+#define KEY_CURSOR_DOWN                         (KEY_CURSOR_UP + 1)
+
+/*! Keycode of the right arrow */
+#define KEY_CURSOR_RIGHT                        (KEY_CURSOR_UP + 2)
+
+/*! Keycode of the left arrow */
+#define KEY_CURSOR_LEFT                         (KEY_CURSOR_UP + 3)
+
+/*! Keycode of alt + F1, alt + the following function keys give the following codes
+ *  and switch to the virtual terminal with that number */
+#define KEY_TERMINAL                            (KEY_CURSOR_UP + 4)
+
+/*! Type of a function key handler, runs in softirq context */
+typedef void (*HotkeyHandler)();
+
+/*! \class Keyboard
+ *\brief Keyboard class
+ *
+ * This class handles the PS/2 keyboard on IRQ1. The interrupt handler only moves the scancode
+ * into a lock-free ring, translation to characters runs from the input softirq and feeds the
+ * active terminal of the Console.
+ * It uses the Singleton Pattern to ensure there is only one instance. To get
+ * the instance you should use the getInstance() method.
+ */
+class Keyboard : public CharacterDevice {
+    
+public:
+    
+    /*! A static function to get the singleton instance for the keyboard driver
+     *
+     *\return The Keyboard instance
+     */
+    static Keyboard* getInstance();
+    
+    /*! Function for what kind of terminal is supported for this CharacterDevice
+     *
+     *\return The type of terminal
+     *\see terminal.h
+     */
+    unsigned long getTerminalType();
+    
+    /*! Function for getting the number of cells on a row
+     *
+     *\return The number of columns, 0 for devices without cells
+     */
+    unsigned long getColumns();
+    
+    /*! Function for getting the number of rows of cells
+     *
+     *\return The number of rows, 0 for devices without cells
+     */
+    unsigned long getRows();
+    
+    /*! Function for getting the number of screens the device holds at once
+     *
+     *\return The number of pages, 0 for devices without cells
+     */
+    unsigned long getPages();
+    
+    /*! Function for installing a handler for a function key
+     *
+     *\param key KEY_F1 to KEY_F1 + KEY_FUNCTION_COUNT - 1
+     *\param handler The handler, 0 to remove it
+     */
+    void registerHotkey(unsigned char key, HotkeyHandler handler);
+    
+    /*! Function for starting a resource
+     *
+     *\return A status indicating E_SUCCES or E_FAILURE
+     */
+    unsigned long startResource();
+    
+    /*! Function for getting the name of a resource
+     *
+     *\return The resource's name
+     */
+    const char* getResourceName();
+    
+    /*! Function for getting the resources that have to be started before this one
+     *
+     *\return The interrupt table and the console
+     */
+    const char* const* getResourceDependencies();
+    
+protected:
+    
+    /*! Protected constructor to ensure singleton usage */
+    Keyboard();
+    
+private:
+    
+    // we only want the Console class to I/O with this class
+    friend class Console;
+    
+    /*! Function to drop all buffered input */
+    void clearBuffer();
+    
+    /*! Function for writing to a Character Device's buffer, the keyboard is input only
+     *
+     *\param buffer The buffer to copy
+     *\param size The size of the buffer
+     *\return E_FAILURE
+     */
+    unsigned long write(void* buffer, unsigned long size);
+    
+    /*! Function for writing part of a Character Device's buffer, the keyboard is input only
+     *
+     *\param buffer The cells to copy
+     *\param offset The first cell of the device to replace
+     *\param size The number of cells to copy
+     *\return E_FAILURE
+     */
+    unsigned long write(void* buffer, unsigned long offset, unsigned long size);
+    
+    /*! Function for showing the cells written since the last call, devices that
+     *  draw straight to the screen have nothing to do
+     */
+    void present();
+    
+    /*! Function for showing another page, the contents of the pages are kept. Rows
+     *  past the end of the page continue on the next one
+     *
+     *\param page The page to show
+     *\param row The row of the page shown at the top of the screen
+     */
+    void showPage(unsigned long page, unsigned long row);
+    
+    /*! Hard handler for IRQ1, never blocks
+     *
+     *\param registers The stack frame of the interrupted code
+     */
+    static void interrupt(struct I386::Registers* registers);
+    
+    /*! Softirq handler translating the buffered scancodes */
+    static void translate();
+    
+    /*! Function to translate one scancode
+     *
+     *\param scancode The set 1 scancode
+     *\return The character, a KEY_ code or 0 when nothing needs to be reported
+     */
+    unsigned char decode(unsigned char scancode);
+    
+    /*! A static instance of the class for singleton usage */ 
+    static Keyboard* _instance;
+    
+    /*! Scancodes from the interrupt handler */
+    RingBuffer<unsigned char, KEYBOARD_BUFFER_SIZE> _scancodes;
+    
+    /*! Handlers for the function keys */
+    HotkeyHandler _hotkeys[KEY_FUNCTION_COUNT];
+    
+    /*! Wether a shift key is down */
+    bool _shift;
+    
+    /*! Wether a control key is down */
+    bool _control;
+    
+    /*! Wether an alt key is down */
+    bool _alt;
+    
+    /*! Wether caps lock is on */
+    bool _capsLock;
+    
+    /*! Wether the previous scancode was the 0xe0 prefix */
+    bool _extended;
+};
+
+} /* namespace Core */
+
+#endif	/* _KEYBOARD_H */
@@ -0,0 +1,234 @@
+/***************************************************************************
+ *            klog.h
+ *
+ *  Copyright  2008  Matthias v.d. Vlies
+ *  matthias@mserver.nl
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*! \file klog.h
+ *  \brief Kernel log
+ *   
+ *  This file defines the KernelLog class, which takes diagnostics off the console's
+ *  critical path.
+ *
+ */
+
+#ifndef _KLOG_H
+#define	_KLOG_H
+
+#include <config.h>
+#include <core/ringbuffer.h>
+#include <core/waitqueue.h>
+#include <core/spinlock.h>
+#include <core/timer.h>
+#include <core/thread.h>
+#include <core/serial.h>
+#include <core/format.h>
+
+namespace Core {
+
+/*! Level of records about something that failed */
+#define KLOG_ERROR                              0x00
+
+/*! Level of records about something unexpected that was handled */
+#define KLOG_WARNING                            0x01
+
+/*! Level of informational records */
+#define KLOG_INFO                               0x02
+
+/*! Level of records only interesting while debugging */
+#define KLOG_DEBUG                              0x03
+
+/*! Number of characters of text a record holds, longer text gets cut off */
+#define KLOG_MESSAGE_SIZE                       44
+
+/*! Number of records buffered per processor until the drain thread renders them, power of two */
+#define KLOG_RING_SIZE                          64
+
+/*! Number of rendered records kept for dumping the log */
+#define KLOG_HISTORY_SIZE                       128
+
+/*! Ticks after which the drain thread looks at the rings without being woken */
+#define KLOG_DRAIN_INTERVAL                     100
+
+/*! \class KernelLog
+ *\brief KernelLog class
+ *
+ * Static class for logging from any context. A record is stamped with the time stamp counter and
+ * copied into a lock-free ring of the current processor with interrupts masked, so logging costs
+ * no lock and never waits for output. A drain thread merges the rings of all processors in time
+ * stamp order, renders the records to the console and a serial port and keeps the last KLOG_HISTORY_SIZE of them
+ * for dump(). A full ring drops the record and counts it, the drain thread reports the losses.
+ */
+class KernelLog {
+    
+public:
+    
+    /*! Function to log a message
+     *
+     *\param level KLOG_ERROR to KLOG_DEBUG
+     *\param message The text
+     */
+    static void log(unsigned int level, const char* message);
+    
+    /*! Function to log a message about a subject, rendered as "subject: message"
+     *
+     *\param level KLOG_ERROR to KLOG_DEBUG
+     *\param subject What the message is about, for example a resource name
+     *\param message The text
+     */
+    static void log(unsigned int level, const char* subject, const char* message);
+    
+    /*! Function to log a message about a subject followed by a value in hexadecimal, the value
+     *  is only formatted by the drain thread
+     *
+     *\param level KLOG_ERROR to KLOG_DEBUG
+     *\param subject What the message is about, 0 for none
+     *\param message The text
+     *\param value The value
+     */
+    static void log(unsigned int level, const char* subject, const char* message, unsigned long value);
+    
+    /*! Function to log a formatted message about a subject, formatted on the stack of the
+     *  caller and cut off at KLOG_MESSAGE_SIZE characters
+     *
+     *\param level KLOG_ERROR to KLOG_DEBUG
+     *\param subject What the message is about, 0 for none
+     *\param format The format string
+     */
+    static void logFormat(unsigned int level, const char* subject, const char* format, ...) FORMAT_CHECK(3, 4);
+    
+    /*! Function to start the drain thread, records logged before stay buffered until then */
+    static void startDaemon();
+    
+    /*! Function to mirror the rendered records to a serial port
+     *
+     *\param port The port, 0 to stop mirroring
+     */
+    static void setSerialPort(Serial* port);
+    
+    /*! Function to render all buffered records right away, for example before halting */
+    static void flush();
+    
+    /*! Function to print the kept records on the console, like dmesg */
+    static void dump();
+    
+private:
+    
+    /*! \struct Record
+     *\brief Record
+     *
+     * One log record, padded to a cache line
+     */
+    struct Record {
+        
+        /*! Time stamp counter when the record was logged, orders records of different processors */
+        unsigned long long timestamp;
+        
+        /*! Tick count when the record was logged, shown with the record */
+        unsigned long ticks;
+        
+        /*! The value, only shown when hasValue is set */
+        unsigned long value;
+        
+        /*! The level */
+        unsigned char level;
+        
+        /*! The processor that logged the record */
+        unsigned char cpu;
+        
+        /*! Wether the value is part of the record */
+        bool hasValue;
+        
+        /*! The text, always terminated */
+        char text[KLOG_MESSAGE_SIZE + 1];
+    };
+    
+    /*! Function to fill a record and queue it on the current processor
+     *
+     *\param level The level
+     *\param subject The subject or 0
+     *\param message The text
+     *\param value The value
+     *\param hasValue Wether the value is part of the record
+     */
+    static void record(unsigned int level, const char* subject, const char* message, unsigned long value, bool hasValue);
+    
+    /*! Function to move the records of all rings to the console and the history, oldest first */
+    static void drain();
+    
+    /*! Function to print a record on the console and the serial port
+     *
+     *\param record The record
+     */
+    static void render(Record* record);
+    
+    /*! Wait condition of the drain thread
+     *
+     *\param data Unused
+     *\return Wether records are buffered
+     */
+    static bool isPending(void* data);
+    
+    /*! Drain thread
+     *
+     *\param data Unused
+     */
+    static void daemon(unsigned long data);
+    
+    /*! Timer function waking the drain thread, covers a wake up missed by a logging processor
+     *
+     *\param data Unused
+     */
+    static void poll(unsigned long data);
+    
+    /*! The record ring of each processor, the processor is the only producer */
+    static RingBuffer<Record, KLOG_RING_SIZE> _rings[MAX_CPUS];
+    
+    /*! Number of records each processor dropped because its ring was full */
+    static volatile unsigned long _dropped[MAX_CPUS];
+    
+    /*! Number of dropped records of each processor already reported */
+    static unsigned long _reported[MAX_CPUS];
+    
+    /*! The last rendered records */
+    static Record _history[KLOG_HISTORY_SIZE];
+    
+    /*! Number of records ever put in the history */
+    static unsigned long _historyCount;
+    
+    /*! Lock making the drain thread and flush() the only consumer of the rings */
+    static SpinLock _drainLock;
+    
+    /*! The drain thread waits here */
+    static WaitQueue _waiters;
+    
+    /*! The drain thread */
+    static Thread* _daemon;
+    
+    /*! The serial port records are mirrored to */
+    static Serial* _serial;
+    
+    /*! Timer polling the rings while the drain thread runs */
+    static Timer* _timer;
+};
+
+} /* namespace Core */
+
+#endif	/* _KLOG_H */
@@ -0,0 +1,139 @@
+/***************************************************************************
+ *            latencytracer.h
+ *
+ *  Copyright  2008  Matthias v.d. Vlies
+ *  matthias@mserver.nl
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*! \file latencytracer.h
+ *  \brief Interrupts-off and preemption-off latency tracer
+ *   
+ *  This file defines the LatencyTracer class. When the kernel is compiled with LATENCY_TRACE
+ *  every interrupts-off and preemption-off section gets timestamped and the longest ones are
+ *  kept together with the code addresses where they started and ended.
+ *
+ */
+
+#ifndef _LATENCYTRACER_H
+#define	_LATENCYTRACER_H
+
+#include <config.h>
+
+namespace Core {
+
+/*! Number of worst sections kept for each kind */
+#define LATENCY_TRACE_ENTRIES                   8
+
+/*! Record kind for interrupts-off sections */
+#define LATENCY_IRQS_OFF                        0x00
+
+/*! Record kind for preemption-off sections */
+#define LATENCY_PREEMPT_OFF                     0x01
+
+/*! \struct LatencyRecord
+ *\brief LatencyRecord
+ *
+ * This struct describes one traced critical section
+ */
+struct LatencyRecord {
+    
+    /*! Length of the section in cycles */
+    unsigned long long cycles;
+    
+    /*! Code address that started the section */
+    void* start;
+    
+    /*! Code address that ended the section */
+    void* end;
+    
+    /*! Processor the section ran on */
+    unsigned int cpu;
+};
+
+/*! \class LatencyTracer
+ *\brief LatencyTracer class
+ *
+ * Static class recording the longest interrupts-off and preemption-off sections. The hooks
+ * are called with interrupts disabled. The preemption hooks are never inlined, so their
+ * return address identifies the call site; the interrupt hooks get it passed from the
+ * extern "C" entry points.
+ */
+class LatencyTracer {
+    
+public:
+    
+    /*! Function called after interrupts got disabled
+     *
+     *\param site The code address that disabled them
+     */
+    static void irqsOff(void* site);
+    
+    /*! Function called right before interrupts get enabled
+     *
+     *\param site The code address that enables them
+     */
+    static void irqsOn(void* site);
+    
+    /*! Function called when preemption got disabled */
+    static void preemptOff() __attribute__((noinline));
+    
+    /*! Function called when preemption gets enabled again */
+    static void preemptOn() __attribute__((noinline));
+    
+    /*! Function to forget all recorded sections */
+    static void reset();
+    
+    /*! Function to print the worst sections of both kinds on the console */
+    static void printWorst();
+    
+private:
+    
+    /*! Function to open a section
+     *
+     *\param kind LATENCY_IRQS_OFF or LATENCY_PREEMPT_OFF
+     *\param site The code address opening the section
+     */
+    static void begin(int kind, void* site);
+    
+    /*! Function to close a section and keep it when it is among the worst
+     *
+     *\param kind LATENCY_IRQS_OFF or LATENCY_PREEMPT_OFF
+     *\param site The code address closing the section
+     */
+    static void finish(int kind, void* site);
+    
+    /*! Function to print the worst sections of one kind
+     *
+     *\param kind LATENCY_IRQS_OFF or LATENCY_PREEMPT_OFF
+     */
+    static void print(int kind);
+    
+    /*! Timestamp of the open section, per kind and processor */
+    static unsigned long long _started[2][MAX_CPUS];
+    
+    /*! Code address of the open section, 0 when no section is open */
+    static void* _site[2][MAX_CPUS];
+    
+    /*! The worst sections per kind, longest first */
+    static LatencyRecord _worst[2][LATENCY_TRACE_ENTRIES];
+};
+
+} /* namespace Core */
+
+#endif	/* _LATENCYTRACER_H */
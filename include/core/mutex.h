@@ -0,0 +1,100 @@
+/***************************************************************************
+ *            mutex.h
+ *
+ *  Copyright  2008  Matthias v.d. Vlies
+ *  matthias@mserver.nl
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*! \file mutex.h
+ *  \brief Sleeping locks
+ *   
+ *  This file defines the Mutex class, a lock for sections that may sleep or run long.
+ *
+ */
+
+#ifndef _MUTEX_H
+#define	_MUTEX_H
+
+#include <config.h>
+#include <core/waitqueue.h>
+
+namespace Core {
+
+/*! Number of PAUSE iterations a waiter spins on a running owner before going to sleep */
+#define MUTEX_SPIN_LIMIT                        2000
+
+/*! \class Mutex
+ *\brief Mutex class
+ *
+ * Adaptive mutex. As long as the owner is running on another processor the lock is likely
+ * released soon, so a waiter spins for a short while. Once the owner sleeps, waits for a
+ * processor or the spin limit runs out the waiter sleeps on a wait queue until unlock()
+ * wakes it. Only threads can use it, not interrupt handlers, and it does not nest. A zeroed
+ * mutex is unlocked.
+ */
+class Mutex {
+    
+public:
+    
+    /*! Constructor */
+    Mutex();
+    
+    /*! Function to acquire the mutex, may sleep */
+    void lock();
+    
+    /*! Function to acquire the mutex without waiting
+     *
+     *\return Wether the mutex got acquired
+     */
+    bool tryLock();
+    
+    /*! Function to release the mutex, wakes one sleeping waiter */
+    void unlock();
+    
+    /*! Function to check if somebody holds the mutex
+     *
+     *\return Wether the mutex is held
+     */
+    bool isLocked();
+    
+private:
+    
+    /*! Function to spin while the owner runs on another processor
+     *
+     *\return Wether the mutex got acquired
+     */
+    bool spin();
+    
+    /*! Wait condition trying to acquire the mutex
+     *
+     *\param data The mutex
+     *\return Wether the mutex got acquired
+     */
+    static bool acquire(void* data);
+    
+    /*! The thread holding the mutex, 0 when it is free */
+    volatile unsigned long _owner;
+    
+    /*! The sleeping waiters */
+    WaitQueue _waiters;
+};
+
+} /* namespace Core */
+
+#endif	/* _MUTEX_H */
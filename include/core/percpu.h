@@ -0,0 +1,158 @@
+/***************************************************************************
+ *            percpu.h
+ *
+ *  Copyright  2008  Matthias v.d. Vlies
+ *  matthias@mserver.nl
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*! \file percpu.h
+ *  \brief Per-CPU data
+ *   
+ *  This file defines the PerCPU class and the per-CPU area every processor reaches through
+ *  its GS segment.
+ *
+ */
+
+#ifndef _PERCPU_H
+#define	_PERCPU_H
+
+#include <config.h>
+
+namespace Core {
+
+/*! Size the areas are aligned to, so processors never share a cache line */
+#define PERCPU_CACHE_LINE                       64
+
+/*! \struct PerCPUArea
+ *\brief PerCPUArea
+ *
+ * This struct describes the data private to one processor. The GS segment of every
+ * processor has its area as base. Members are word sized at most, so the accessors below
+ * compile to one instruction. The area of the boot processor is usable from the first
+ * instruction of kernel(), a zeroed area describes it.
+ */
+struct PerCPUArea {
+    
+    /*! Linear address of the area itself, 0 until PerCPU::initialise ran */
+    PerCPUArea* self;
+    
+    /*! The kernel processor number */
+    unsigned int cpu;
+    
+    /*! The hardware id of the processor */
+    unsigned int hardwareId;
+    
+    /*! Nesting count of preemption-disabled sections */
+    unsigned int preemptCount;
+    
+} __attribute__((aligned(PERCPU_CACHE_LINE)));
+
+/*! Macro for reading a member of the area of the current processor
+ *
+ *\param member The member of PerCPUArea
+ */
+#define PERCPU_READ(member)         Core::PerCPU::read<__typeof__(((Core::PerCPUArea*)0)->member), __builtin_offsetof(Core::PerCPUArea, member)>()
+
+/*! Macro for writing a member of the area of the current processor
+ *
+ *\param member The member of PerCPUArea
+ *\param value The value to write
+ */
+#define PERCPU_WRITE(member, value) Core::PerCPU::write<__typeof__(((Core::PerCPUArea*)0)->member), __builtin_offsetof(Core::PerCPUArea, member)>(value)
+
+/*! Macro for adding to a member of the area of the current processor. A single instruction,
+ *  so interrupts on this processor see the counter either before or after the update.
+ *
+ *\param member The member of PerCPUArea
+ *\param value The value to add
+ */
+#define PERCPU_ADD(member, value)   Core::PerCPU::add<__typeof__(((Core::PerCPUArea*)0)->member), __builtin_offsetof(Core::PerCPUArea, member)>(value)
+
+/*! \class PerCPU
+ *\brief PerCPU class
+ *
+ * Static class for the per-CPU areas. Use the PERCPU_ macros to access the area of the
+ * current processor; getArea() gives the areas of other processors for code that inspects
+ * them from outside.
+ */
+class PerCPU {
+    
+public:
+    
+    /*! Function to fill in the area of a processor before the processor uses it
+     *
+     *\param cpu The processor
+     */
+    static void initialise(unsigned int cpu);
+    
+    /*! Function to get the area of a processor
+     *
+     *\param cpu The processor
+     *\return The area
+     */
+    static PerCPUArea* getArea(unsigned int cpu);
+    
+    /*! Function to get the area of the current processor, valid once initialise ran for it
+     *
+     *\return The area
+     */
+    static inline PerCPUArea* getLocalArea() {
+        
+        return PERCPU_READ(self);
+    }
+    
+    /*! Function to read a member of the current area, use PERCPU_READ
+     *
+     *\return The value
+     */
+    template<typename T, unsigned long Offset> static inline T read() {
+        
+        T value;
+        
+        // volatile, the thread may run on another processor by the next read
+        __asm__ __volatile__ ("mov %%gs:%c1, %0" : "=q" (value) : "i" (Offset));
+        
+        return value;
+    }
+    
+    /*! Function to write a member of the current area, use PERCPU_WRITE
+     *
+     *\param value The value
+     */
+    template<typename T, unsigned long Offset> static inline void write(T value) {
+        
+        __asm__ __volatile__ ("mov %1, %%gs:%c0" : : "i" (Offset), "q" (value) : "memory");
+    }
+    
+    /*! Function to add to a member of the current area, use PERCPU_ADD
+     *
+     *\param value The value to add
+     */
+    template<typename T, unsigned long Offset> static inline void add(T value) {
+        
+        __asm__ __volatile__ ("add %1, %%gs:%c0" : : "i" (Offset), "q" (value) : "memory", "cc");
+    }
+};
+
+} /* namespace Core */
+
+/*! The areas of all processors, loader.asm points the boot GS descriptor at the first one */
+extern "C" Core::PerCPUArea _percpu_areas[MAX_CPUS];
+
+#endif	/* _PERCPU_H */
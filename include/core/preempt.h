@@ -0,0 +1,94 @@
+/***************************************************************************
+ *            preempt.h
+ *
+ *  Copyright  2008  Matthias v.d. Vlies
+ *  matthias@mserver.nl
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*! \file preempt.h
+ *  \brief Preemption control
+ *   
+ *  This file defines the Preempt class. Code between disable() and enable() is never
+ *  switched away from by the scheduler, although interrupts still get serviced.
+ *
+ */
+
+#ifndef _PREEMPT_H
+#define	_PREEMPT_H
+
+#include <config.h>
+#include <core/percpu.h>
+#include <core/latencytracer.h>
+
+namespace Core {
+
+/*! \class Preempt
+ *\brief Preempt class
+ *
+ * Static class keeping a nesting count of preemption-disabled sections for each processor.
+ */
+class Preempt {
+    
+public:
+    
+    /*! Function to disable preemption on the current processor, calls may nest */
+    static inline void disable() {
+        
+        // one instruction, an interrupt in between can not see half an update
+        PERCPU_ADD(preemptCount, 1);
+        
+#ifdef LATENCY_TRACE
+        if(PERCPU_READ(preemptCount) == 1) {
+            
+            Core::LatencyTracer::preemptOff();
+        }
+#endif
+        
+        // keep the compiler from moving accesses out of the section
+        __asm__ __volatile__ ("" : : : "memory");
+    }
+    
+    /*! Function to enable preemption again on the current processor */
+    static inline void enable() {
+        
+        __asm__ __volatile__ ("" : : : "memory");
+        
+        PERCPU_ADD(preemptCount, -1);
+        
+#ifdef LATENCY_TRACE
+        if(PERCPU_READ(preemptCount) == 0) {
+            
+            Core::LatencyTracer::preemptOn();
+        }
+#endif
+    }
+    
+    /*! Function to check if the current processor may switch threads
+     *
+     *\return Wether preemption is enabled
+     */
+    static inline bool isEnabled() {
+        
+        return PERCPU_READ(preemptCount) == 0;
+    }
+};
+
+} /* namespace Core */
+
+#endif	/* _PREEMPT_H */
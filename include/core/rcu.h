@@ -0,0 +1,211 @@
+/***************************************************************************
+ *            rcu.h
+ *
+ *  Copyright  2008  Matthias v.d. Vlies
+ *  matthias@mserver.nl
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*! \file rcu.h
+ *  \brief Read-copy-update
+ *   
+ *  This file defines the RCU class. Readers of read-mostly data run without locks or atomic
+ *  instructions, writers publish a new version and free the old one after a grace period.
+ *
+ */
+
+#ifndef _RCU_H
+#define	_RCU_H
+
+#include <config.h>
+#include <core/preempt.h>
+#include <core/spinlock.h>
+#include <core/cpu.h>
+
+namespace Core {
+
+/*! Size the per-CPU state is padded to, so processors never share a cache line */
+#define RCU_CACHE_LINE                          64
+
+struct RCUHead;
+
+/*! Type of a function called once the grace period of a callback ended
+ *
+ *\param head The head passed to RCU::call
+ */
+typedef void (*RCUCallback)(RCUHead* head);
+
+/*! \struct RCUHead
+ *\brief RCUHead
+ *
+ * This struct is embedded in objects that are freed through RCU
+ */
+struct RCUHead {
+    
+    /*! The next callback in the same batch */
+    RCUHead* next;
+    
+    /*! The function to call */
+    RCUCallback function;
+};
+
+/*! \class RCU
+ *\brief RCU class
+ *
+ * Static class implementing classic non-preemptible read-copy-update. A read-side section
+ * only disables preemption, which is a per-CPU counter. A processor passes a quiescent state
+ * when it switches threads or when the tick finds it outside any read-side section; it only
+ * increments its own counter then. A grace period snapshots the counters of all processors
+ * and ends once every counter moved. Callbacks are queued per processor and run from
+ * SOFTIRQ_RCU after the grace period they waited for.
+ *
+ * Interrupt handlers run with interrupts disabled and are implicitly read-side sections.
+ */
+class RCU {
+    
+public:
+    
+    /*! Function to install the softirq handler */
+    static void initialise();
+    
+    /*! Function to enter a read-side section, may nest */
+    static inline void readLock() {
+        
+        Core::Preempt::disable();
+    }
+    
+    /*! Function to leave a read-side section */
+    static inline void readUnlock() {
+        
+        Core::Preempt::enable();
+    }
+    
+    /*! Function to read a pointer published with assign
+     *
+     *\param pointer The pointer to read
+     *\return Its value, the object it points to stays valid until readUnlock
+     */
+    template<typename T> static inline T* dereference(T* const& pointer) {
+        
+        T* value = *const_cast<T* const volatile*>(&pointer);
+        
+        // i386 does not reorder dependent loads, only the compiler may
+        __asm__ __volatile__ ("" : : : "memory");
+        
+        return value;
+    }
+    
+    /*! Function to publish a new version of an object
+     *
+     *\param pointer The pointer readers use
+     *\param value The fully initialised new version
+     */
+    template<typename T> static inline void assign(T*& pointer, T* value) {
+        
+        // the initialisation must be visible before the pointer, stores are not reordered on i386
+        __asm__ __volatile__ ("" : : : "memory");
+        
+        *const_cast<T* volatile*>(&pointer) = value;
+    }
+    
+    /*! Function to run a callback after all current readers left their read-side sections
+     *
+     *\param head The head embedded in the object
+     *\param function The function to call, from softirq context
+     */
+    static void call(RCUHead* head, RCUCallback function);
+    
+    /*! Function to wait until all current readers left their read-side sections. Must not
+     *  be called from a read-side section or interrupt context.
+     */
+    static void synchronize();
+    
+    /*! Function called by the scheduler when the current processor is outside any read-side
+     *  section
+     */
+    static inline void quiescentState() {
+        
+        _cpus[Core::CPU::getCurrentId()].quiescent++;
+    }
+    
+    /*! Function called on every tick, raises SOFTIRQ_RCU when there is work
+     *
+     *\param quiescent Wether the interrupted code was outside any read-side section
+     */
+    static void tick(bool quiescent);
+    
+private:
+    
+    /*! \struct CPUData
+     *\brief CPUData
+     *
+     * The RCU state of one processor
+     */
+    struct CPUData {
+        
+        /*! Number of quiescent states passed, only written by the owner */
+        volatile unsigned long quiescent;
+        
+        /*! Callbacks queued since the current batch got closed */
+        RCUHead* pending;
+        
+        /*! Callbacks waiting for grace period batchGrace */
+        RCUHead* batch;
+        
+        /*! The grace period the batch waits for */
+        unsigned long batchGrace;
+        
+    } __attribute__((aligned(RCU_CACHE_LINE)));
+    
+    /*! Handler of SOFTIRQ_RCU, advances the grace period and runs finished callbacks */
+    static void run();
+    
+    /*! Function to start the next grace period when one was requested, called with the lock
+     *  held
+     */
+    static void startGrace();
+    
+    /*! Function to check if every processor passed a quiescent state in the current grace
+     *  period, called with the lock held
+     *
+     *\return Wether the grace period is over
+     */
+    static bool isGraceOver();
+    
+    /*! The state of each processor */
+    static CPUData _cpus[MAX_CPUS];
+    
+    /*! The counters of each processor when the current grace period started */
+    static unsigned long _snapshot[MAX_CPUS];
+    
+    /*! Number of the last started grace period */
+    static volatile unsigned long _current;
+    
+    /*! Number of the last finished grace period */
+    static volatile unsigned long _completed;
+    
+    /*! Number of the last grace period a batch waits for */
+    static unsigned long _requested;
+    
+    /*! Lock for the grace period state */
+    static SpinLock _lock;
+};
+
+} /* namespace Core */
+
+#endif	/* _RCU_H */
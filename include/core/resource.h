@@ -31,6 +31,11 @@
 #ifndef _RESOURCE_H
 #define	_RESOURCE_H
 
+#include <core/spinlock.h>
+#include <core/rcu.h>
+#include <core/workqueue.h>
+#include <core/completion.h>
+
 namespace Core {
 
 /*! \class Resource
@@ -54,13 +59,23 @@ public:
      *\return The resource's name
      */
     virtual const char* getResourceName() = 0;
+    
+    /*! Function for getting the resources that have to be started before this one
+     *
+     *\return A list of resource names ending in 0, or 0 when there are none
+     */
+    virtual const char* const* getResourceDependencies();
 };
 
 
 /*! \class ResourceManager
  *\brief ResourceManager class
  *
- * The ResourceManager class registers Resources and manages them.
+ * The ResourceManager class registers Resources and manages them. Resources needed before
+ * threads exist are started one by one with registerResource(). Later ones are added with
+ * addResource() and started together by startResources(), which orders them by their
+ * dependencies and starts every resource whose dependencies are up on the system workqueue,
+ * spread over the processors, so boot waits for the longest chain instead of the sum.
  *
  */
 class ResourceManager {
@@ -74,17 +89,205 @@ public:
      */
     unsigned long registerResource(Resource* resource);
     
+    /*! Function to add a resource to the next startResources() batch
+     *
+     *\param resource The resource
+     *\return E_SUCCESS or E_ALLOC_NOMEM
+     */
+    unsigned long addResource(Resource* resource);
+    
+    /*! Function to start all added resources and wait until they are done. A resource whose
+     *  dependency failed, is missing or depends on itself through others is not started and
+     *  reported as failed.
+     *
+     *\return E_SUCCESS, or E_FAILURE when a resource did not start
+     */
+    unsigned long startResources();
+    
     /*! A static function to get the singleton instance for a ResourceManager
      *
      *\return The ResourceManager instance
      */
     static ResourceManager* getInstance();
     
+    /*! Function to get the number of started resources
+     *
+     *\return The number of resources
+     */
+    unsigned int getResourceCount();
+    
+    /*! Function to look up a started resource, safe from any context without locking
+     *
+     *\param name The name the resource reports
+     *\return The resource, 0 if none has this name
+     */
+    Resource* findResource(const char* name);
+    
 private:
     
+    /*! \class ResourceNode
+     *\brief ResourceNode class
+     *
+     * A resource of a startResources() batch
+     */
+    class ResourceNode {
+        
+    public:
+        
+        /*! Constructor for the ResourceNode class
+         *
+         *\param resource The resource
+         */
+        ResourceNode(Resource* resource);
+        
+        /*! The resource */
+        Resource* resource;
+        
+        /*! Starts the resource on a worker */
+        Work work;
+        
+        /*! Number of dependencies that did not finish yet */
+        unsigned int waiting;
+        
+        /*! Wether a dependency failed or is missing */
+        bool blocked;
+        
+        /*! Wether the resource got dispatched */
+        bool started;
+        
+        /*! Dependencies left while looking for cycles */
+        unsigned int unresolved;
+        
+        /*! Wether the resource can start once its dependencies did */
+        bool resolved;
+        
+        /*! The next resource in the batch */
+        ResourceNode* next;
+        
+        /*! The next resource that became ready */
+        ResourceNode* nextReady;
+    };
+    
+    /*! \struct ResourceTable
+     *\brief ResourceTable
+     *
+     * One version of the set of started resources. A registration publishes a copy with one
+     * more entry and frees the old version after an RCU grace period.
+     */
+    struct ResourceTable {
+        
+        /*! Deferred free, must come first */
+        RCUHead rcu;
+        
+        /*! Number of resources */
+        unsigned int count;
+        
+        /*! The resources in start order, allocated with count entries */
+        Resource* resources[1];
+    };
+    
+    /*! Function to publish a copy of the table with one more resource, called with the lock
+     *  held
+     *
+     *\param resource The resource to add
+     */
+    void publish(Resource* resource);
+    
+    /*! Function to start a resource and report the result
+     *
+     *\param resource The resource
+     *\param verbose Wether to announce the resource on the console before starting it,
+     *  otherwise the result goes to the kernel log
+     *\return The status of the resource
+     */
+    unsigned long start(Resource* resource, bool verbose);
+    
+    /*! Function to print the outcome of a start
+     *
+     *\param status The status of the resource
+     *\param cycles The cycles the start took
+     */
+    void report(unsigned long status, unsigned long long cycles);
+    
+    /*! Function to stop the system after a resource reported E_PANIC, shows the log first */
+    static void panic() __attribute__((noreturn));
+    
+    /*! Function to run or queue a resource whose dependencies finished
+     *
+     *\param node The resource
+     */
+    void dispatch(ResourceNode* node);
+    
+    /*! Function to release the dependents of a finished resource
+     *
+     *\param node The resource
+     *\param status The status of the resource
+     */
+    void finish(ResourceNode* node, unsigned long status);
+    
+    /*! Function to mark the resources that can never start because of a dependency cycle,
+     *  called with the lock held
+     *
+     *\return The resources in cycles, linked through nextReady
+     */
+    ResourceNode* findCycles();
+    
+    /*! Work function starting a resource of the batch
+     *
+     *\param data The resource node
+     */
+    static void startNode(unsigned long data);
+    
+    /*! Function to check if a resource lists a dependency
+     *
+     *\param resource The resource
+     *\param name The name of the dependency
+     *\return Wether the resource depends on it
+     */
+    static bool dependsOn(Resource* resource, const char* name);
+    
+    /*! Function to compare resource names
+     *
+     *\param a The first name
+     *\param b The second name
+     *\return Wether the names are equal
+     */
+    static bool isSameName(const char* a, const char* b);
+    
+    /*! Function to free a replaced table after its grace period
+     *
+     *\param head The rcu member of the table
+     */
+    static void freeTable(RCUHead* head);
+    
     /*! Singleton instance */
     static ResourceManager* _instance;
     
+    /*! The current version of the table, 0 while empty */
+    ResourceTable* _table;
+    
+    /*! Lock serialising writers of the table and the batch, resources may start on any
+     *  processor */
+    SpinLock _lock;
+    
+    /*! Resources waiting for startResources() */
+    ResourceNode* _added;
+    
+    /*! The batch being started */
+    ResourceNode* _batch;
+    
+    /*! Number of batch resources that did not finish */
+    unsigned int _remaining;
+    
+    /*! Wether a resource of the batch did not start */
+    bool _failed;
+    
+    /*! The processor the next resource starts on */
+    unsigned int _nextCpu;
+    
+    /*! Signalled when the last resource of the batch finished */
+    Completion _batchDone;
+    
 protected:
     
     /*! Singleton Constructor for the ResourceManager class */
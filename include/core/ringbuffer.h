@@ -0,0 +1,157 @@
+/***************************************************************************
+ *            ringbuffer.h
+ *
+ *  Copyright  2008  Matthias v.d. Vlies
+ *  matthias@mserver.nl
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*! \file ringbuffer.h
+ *  \brief Single-producer/single-consumer ring buffer
+ *   
+ *  This file defines the RingBuffer template. One side may push while the other side
+ *  pops without any locking, e.g. an interrupt handler feeding deferred work.
+ *
+ */
+
+#ifndef _RINGBUFFER_H
+#define	_RINGBUFFER_H
+
+namespace Core {
+
+/*! \class RingBuffer
+ *\brief RingBuffer class
+ *
+ * Lock-free ring buffer for exactly one producer and one consumer. The producer only writes
+ * _head and the consumer only writes _tail, so neither side ever waits for the other.
+ * SIZE must be a power of two.
+ */
+template<typename T, unsigned long SIZE>
+class RingBuffer {
+    
+public:
+    
+    /*! Constructor for the RingBuffer class */
+    RingBuffer() {
+        
+        this->_head = 0;
+        this->_tail = 0;
+    }
+    
+    /*! Function to add an element, only called by the producer
+     *
+     *\param element The element to add
+     *\return False when the buffer is full and the element got dropped
+     */
+    bool push(const T& element) {
+        
+        unsigned long head = this->_head;
+        
+        if(head - this->_tail == SIZE) {
+            
+            return false;
+        }
+        
+        this->_elements[head & (SIZE - 1)] = element;
+        
+        // publish the element before the new head (stores are not reordered on x86)
+        __asm__ __volatile__ ("" : : : "memory");
+        
+        this->_head = head + 1;
+        
+        return true;
+    }
+    
+    /*! Function to take the oldest element, only called by the consumer
+     *
+     *\param element Receives the element
+     *\return False when the buffer is empty
+     */
+    bool pop(T& element) {
+        
+        unsigned long tail = this->_tail;
+        
+        if(tail == this->_head) {
+            
+            return false;
+        }
+        
+        // read the element before handing the slot back
+        __asm__ __volatile__ ("" : : : "memory");
+        
+        element = this->_elements[tail & (SIZE - 1)];
+        
+        __asm__ __volatile__ ("" : : : "memory");
+        
+        this->_tail = tail + 1;
+        
+        return true;
+    }
+    
+    /*! Function to look at the oldest element without taking it, only called by the consumer
+     *
+     *\return The element, 0 when the buffer is empty
+     */
+    T* peek() {
+        
+        unsigned long tail = this->_tail;
+        
+        if(tail == this->_head) {
+            
+            return 0;
+        }
+        
+        // read the element only after seeing the head
+        __asm__ __volatile__ ("" : : : "memory");
+        
+        return &this->_elements[tail & (SIZE - 1)];
+    }
+    
+    /*! Function to check for available elements
+     *
+     *\return Wether the buffer is empty
+     */
+    bool isEmpty() {
+        
+        return this->_tail == this->_head;
+    }
+    
+    /*! Function to get the number of stored elements
+     *
+     *\return The number of elements
+     */
+    unsigned long getCount() {
+        
+        return this->_head - this->_tail;
+    }
+    
+private:
+    
+    /*! The storage */
+    T _elements[SIZE];
+    
+    /*! Number of elements ever pushed, written by the producer */
+    volatile unsigned long _head;
+    
+    /*! Number of elements ever popped, written by the consumer */
+    volatile unsigned long _tail;
+};
+
+} /* namespace Core */
+
+#endif	/* _RINGBUFFER_H */
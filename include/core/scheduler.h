@@ -0,0 +1,227 @@
+/***************************************************************************
+ *            scheduler.h
+ *
+ *  Copyright  2008  Matthias v.d. Vlies
+ *  matthias@mserver.nl
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*! \file scheduler.h
+ *  \brief Thread scheduler
+ *   
+ *  This file defines the Scheduler class. It keeps a priority run queue per processor,
+ *  preempts threads from the timer interrupt when their time slice runs out and lets idle
+ *  processors steal work from busy ones.
+ *
+ */
+
+#ifndef _SCHEDULER_H
+#define	_SCHEDULER_H
+
+#include <config.h>
+#include <core/thread.h>
+
+namespace Core {
+
+class SpinLock;
+
+/*! Number of words in the bitmap of non-empty priority levels */
+#define SCHEDULER_BITMAP_WORDS                  (THREAD_PRIORITIES / 32)
+
+/*! \class Scheduler
+ *\brief Scheduler class
+ *
+ * Static class switching between kernel threads. Every processor has a run queue with a FIFO
+ * per priority level and a bitmap of the non-empty levels, so picking the next thread is one
+ * BSF per bitmap word regardless of the number of threads. Higher priorities get longer
+ * time slices. Every processor also has an idle thread that runs when its run queue is
+ * empty; it is never queued itself. A processor without work of its own takes the most
+ * important waiting thread from the processor with the longest run queue.
+ */
+class Scheduler {
+    
+public:
+    
+    /*! Function to turn the code running on the current processor into its idle thread */
+    static void initialise();
+    
+    /*! Function to get the thread running on the current processor
+     *
+     *\return The current thread
+     */
+    static Thread* getCurrent();
+    
+    /*! Function to queue a new or woken thread on the run queue of its processor
+     *
+     *\param thread The thread
+     */
+    static void add(Thread* thread);
+    
+    /*! Function to pick the next thread and switch to it */
+    static void schedule();
+    
+    /*! Function to give up the rest of the time slice */
+    static void yield();
+    
+    /*! Function to put the current thread to sleep until wake() gets called. Must be
+     *  called with interrupts disabled after checking the wait condition, returns with
+     *  interrupts disabled.
+     */
+    static void block();
+    
+    /*! Function to put the current thread to sleep and release a lock once the thread is
+     *  marked blocked, so a waker holding the lock can not slip in before. Must be called
+     *  with interrupts disabled, returns with interrupts disabled and the lock released.
+     *
+     *\param lock The lock protecting the wait condition
+     */
+    static void block(SpinLock* lock);
+    
+    /*! Function to make a blocked thread runnable again
+     *
+     *\param thread The thread
+     *\return Wether the thread was blocked
+     */
+    static bool wake(Thread* thread);
+    
+    /*! Function to check if the current processor should switch threads
+     *
+     *\return Wether a reschedule was requested
+     */
+    static bool isReschedulePending();
+    
+    /*! Function called from the timer interrupt on every tick */
+    static void tick();
+    
+    /*! Function called on interrupt exit, switches threads when the time slice ran out */
+    static void preempt();
+    
+    /*! Function called by a thread right after it got switched to, releases the thread
+     *  switched away from to other processors and reaps it when it exited
+     */
+    static void finishSwitch();
+    
+private:
+    
+    /*! \struct RunQueue
+     *\brief RunQueue
+     *
+     * The run queue of one processor
+     */
+    struct RunQueue {
+        
+        /*! Bit n is set when level n has threads */
+        unsigned long bitmap[SCHEDULER_BITMAP_WORDS];
+        
+        /*! The first thread of each level */
+        Thread* head[THREAD_PRIORITIES];
+        
+        /*! The last thread of each level */
+        Thread* tail[THREAD_PRIORITIES];
+        
+        /*! Number of queued threads */
+        volatile unsigned int count;
+        
+        /*! Lock for access from other processors */
+        volatile unsigned long lock;
+    };
+    
+    /*! Function to lock a run queue, interrupts must be disabled
+     *
+     *\param queue The run queue
+     */
+    static void lockQueue(RunQueue* queue);
+    
+    /*! Function to unlock a run queue
+     *
+     *\param queue The run queue
+     */
+    static void unlockQueue(RunQueue* queue);
+    
+    /*! Function to put a thread at the back of its level
+     *
+     *\param queue The locked run queue
+     *\param thread The thread
+     */
+    static void enqueue(RunQueue* queue, Thread* thread);
+    
+    /*! Function to unlink a thread from its level
+     *
+     *\param queue The locked run queue
+     *\param thread The thread
+     *\param previous The thread in front of it, 0 if it is the first
+     */
+    static void remove(RunQueue* queue, Thread* thread, Thread* previous);
+    
+    /*! Function to take the next thread from a run queue
+     *
+     *\param cpu The processor
+     *\return The thread or 0 when the queue is empty
+     */
+    static Thread* dequeue(unsigned int cpu);
+    
+    /*! Function to find the processor with the most waiting threads
+     *
+     *\param cpu The processor asking
+     *\return The busiest other processor, cpu itself when all others are empty
+     */
+    static unsigned int findBusiest(unsigned int cpu);
+    
+    /*! Function to move a waiting thread from the busiest processor to this one
+     *
+     *\param cpu The processor asking
+     *\return The stolen thread, 0 if none could move
+     */
+    static Thread* steal(unsigned int cpu);
+    
+    /*! Function to switch to another thread, called with interrupts disabled
+     *
+     *\param previous The running thread
+     *\param next The thread to run
+     */
+    static void switchTo(Thread* previous, Thread* next);
+    
+    /*! Function to free the stack and FPU context of an exited thread once no processor
+     *  runs on them anymore
+     *
+     *\param thread The dead thread
+     */
+    static void reap(Thread* thread);
+    
+    /*! The thread running on each processor */
+    static Thread* _current[MAX_CPUS];
+    
+    /*! The idle thread of each processor */
+    static Thread* _idle[MAX_CPUS];
+    
+    /*! The thread each processor switched away from last */
+    static Thread* _previous[MAX_CPUS];
+    
+    /*! The run queue of each processor */
+    static RunQueue _queues[MAX_CPUS];
+    
+    /*! The time slice in ticks for each priority */
+    static unsigned long _timeSlices[THREAD_PRIORITIES];
+    
+    /*! Wether the current thread should be switched away from on interrupt exit */
+    static volatile bool _needResched[MAX_CPUS];
+};
+
+} /* namespace Core */
+
+#endif	/* _SCHEDULER_H */
@@ -0,0 +1,335 @@
+/***************************************************************************
+ *            serial.h
+ *
+ *  Copyright  2008  Matthias v.d. Vlies
+ *  matthias@mserver.nl
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*! \file serial.h
+ *  \brief 16550 UART Driver
+ *   
+ *  This file defines the Serial class. The serial class handles the 16550 UARTs on COM1 to COM4.
+ *  The class uses a Sigleton design pattern for every port.
+ *
+ */
+
+#ifndef _SERIAL_H
+#define	_SERIAL_H
+
+#include <core/characterdevice.h>
+#include <core/resource.h>
+#include <core/ringbuffer.h>
+#include <core/spinlock.h>
+#include <I386/i386.h>
+
+namespace Core {
+
+/*! Index of COM1 */
+#define SERIAL_COM1                             0x00
+
+/*! Index of COM2 */
+#define SERIAL_COM2                             0x01
+
+/*! Index of COM3 */
+#define SERIAL_COM3                             0x02
+
+/*! Index of COM4 */
+#define SERIAL_COM4                             0x03
+
+/*! Number of supported ports */
+#define SERIAL_PORTS                            4
+
+/*! Baud rate the ports are programmed for */
+#define SERIAL_BAUD_RATE                        115200
+
+/*! Frequency the divisor latch divides down to the baud rate */
+#define SERIAL_CLOCK                            115200
+
+/*! Number of bytes the transmit FIFO of a 16550 holds */
+#define SERIAL_FIFO_SIZE                        16
+
+/*! Number of bytes buffered for sending, power of two */
+#define SERIAL_TX_BUFFER_SIZE                   4096
+
+/*! Number of received bytes buffered until read, power of two */
+#define SERIAL_RX_BUFFER_SIZE                   256
+
+// register offsets from the base port
+/*! Receive buffer (read) and transmit holding register (write), divisor low byte with DLAB */
+#define SERIAL_DATA                             0x00
+
+/*! Interrupt enable register, divisor high byte with DLAB */
+#define SERIAL_INTERRUPT_ENABLE                 0x01
+
+/*! Interrupt identification (read) and FIFO control register (write) */
+#define SERIAL_INTERRUPT_ID                     0x02
+
+/*! Line control register */
+#define SERIAL_LINE_CONTROL                     0x03
+
+/*! Modem control register */
+#define SERIAL_MODEM_CONTROL                    0x04
+
+/*! Line status register */
+#define SERIAL_LINE_STATUS                      0x05
+
+/*! Modem status register */
+#define SERIAL_MODEM_STATUS                     0x06
+
+/*! Scratch register */
+#define SERIAL_SCRATCH                          0x07
+
+// register bits
+/*! Interrupt enable bit for received data */
+#define SERIAL_IER_RECEIVE                      0x01
+
+/*! Interrupt enable bit for an empty transmit holding register */
+#define SERIAL_IER_TRANSMIT                     0x02
+
+/*! Interrupt identification bit set when no interrupt is pending */
+#define SERIAL_IIR_NONE                         0x01
+
+/*! Mask of the interrupt identification */
+#define SERIAL_IIR_MASK                         0x0e
+
+/*! Interrupt identification of a modem status change */
+#define SERIAL_IIR_MODEM                        0x00
+
+/*! Interrupt identification of an empty transmit holding register */
+#define SERIAL_IIR_TRANSMIT                     0x02
+
+/*! Interrupt identification of received data */
+#define SERIAL_IIR_RECEIVE                      0x04
+
+/*! Interrupt identification of a line status change */
+#define SERIAL_IIR_LINE                         0x06
+
+/*! Interrupt identification of received data sitting in the FIFO for a while */
+#define SERIAL_IIR_TIMEOUT                      0x0c
+
+/*! Bits set in the interrupt identification when the FIFOs are enabled */
+#define SERIAL_IIR_FIFO                         0xc0
+
+/*! FIFO control: enable and clear both FIFOs, interrupt at 14 received bytes */
+#define SERIAL_FCR_ENABLE                       0xc7
+
+/*! Line control bit to reach the divisor latch */
+#define SERIAL_LCR_DLAB                         0x80
+
+/*! Line control for 8 data bits, no parity, 1 stop bit */
+#define SERIAL_LCR_8N1                          0x03
+
+/*! Modem control: DTR, RTS and OUT2, which connects the interrupt line */
+#define SERIAL_MCR_ENABLE                       0x0b
+
+/*! Line status bit for received data */
+#define SERIAL_LSR_DATA                         0x01
+
+/*! Line status bit for an empty transmit holding register */
+#define SERIAL_LSR_TRANSMIT                     0x20
+
+/*! \class Serial
+ *\brief Serial class
+ *
+ * This class handles a 16550 UART. Output goes into a transmit ring and the FIFO is refilled
+ * SERIAL_FIFO_SIZE bytes at a time from the transmit interrupt, so writers never wait for the
+ * line unless the ring is full. The receive interrupt empties the FIFO into a receive ring.
+ * COM1/COM3 and COM2/COM4 share an IRQ, the handler serves every port on the line.
+ * Every port has its own instance, get it with getInstance().
+ */
+class Serial : public CharacterDevice {
+    
+public:
+    
+    /*! A static function to get the singleton instance for a port
+     *
+     *\param port SERIAL_COM1 to SERIAL_COM4
+     *\return The Serial instance, 0 for an invalid port
+     */
+    static Serial* getInstance(unsigned int port);
+    
+    /*! Function for what kind of terminal is supported for this CharacterDevice
+     *
+     *\return The type of terminal
+     *\see terminal.h
+     */
+    unsigned long getTerminalType();
+    
+    /*! Function for getting the number of cells on a row
+     *
+     *\return The number of columns, 0 for devices without cells
+     */
+    unsigned long getColumns();
+    
+    /*! Function for getting the number of rows of cells
+     *
+     *\return The number of rows, 0 for devices without cells
+     */
+    unsigned long getRows();
+    
+    /*! Function for getting the number of screens the device holds at once
+     *
+     *\return The number of pages, 0 for devices without cells
+     */
+    unsigned long getPages();
+    
+    /*! Function to send text from code that may have interrupted the holder of the port's
+     *  lock, like a fault handler. Never waits for the lock and waits for the text to leave
+     *  the UART, interrupts must be disabled.
+     *
+     *\param port SERIAL_COM1 to SERIAL_COM4
+     *\param text The text
+     *\param length The number of characters
+     *\return Wether the port is set up and its lock was free
+     */
+    static bool trySend(unsigned int port, const char* text, unsigned long length);
+    
+    /*! Function to queue text for sending, newlines are sent as carriage return and newline.
+     *  Text for a port without a UART is dropped.
+     *
+     *\param text The text
+     *\param length The number of characters
+     */
+    void send(const char* text, unsigned long length);
+    
+    /*! Function to take received characters, never waits
+     *
+     *\param buffer Receives the characters
+     *\param size The size of the buffer
+     *\return The number of characters taken
+     */
+    unsigned long read(char* buffer, unsigned long size);
+    
+    /*! Function to check if the port has a working UART
+     *
+     *\return Wether the port was started successfully
+     */
+    bool isPresent();
+    
+    /*! Function for starting a resource
+     *
+     *\return A status indicating E_SUCCES or E_FAILURE
+     */
+    unsigned long startResource();
+    
+    /*! Function for getting the name of a resource
+     *
+     *\return The resource's name
+     */
+    const char* getResourceName();
+    
+    /*! Function for getting the resources that have to be started before this one
+     *
+     *\return The interrupt table
+     */
+    const char* const* getResourceDependencies();
+    
+protected:
+    
+    /*! Protected constructor to ensure singleton usage
+     *
+     *\param port SERIAL_COM1 to SERIAL_COM4
+     */
+    Serial(unsigned int port);
+    
+private:
+    
+    // we only want the Console and Terminal classes to I/O with this class
+    friend class Console;
+    friend class Terminal;
+    
+    /*! Function to drop all received input */
+    void clearBuffer();
+    
+    /*! Function for writing to a Character Device's buffer, the characters are sent
+     *
+     *\param buffer The characters
+     *\param size The number of characters
+     *\return E_SUCCESS
+     */
+    unsigned long write(void* buffer, unsigned long size);
+    
+    /*! Function for writing part of a Character Device's buffer, a serial line has no cells
+     *
+     *\param buffer The cells to copy
+     *\param offset The first cell of the device to replace
+     *\param size The number of cells to copy
+     *\return E_FAILURE
+     */
+    unsigned long write(void* buffer, unsigned long offset, unsigned long size);
+    
+    /*! Function for showing the cells written since the last call, devices that
+     *  draw straight to the screen have nothing to do
+     */
+    void present();
+    
+    /*! Function for showing another page, the contents of the pages are kept. Rows
+     *  past the end of the page continue on the next one
+     *
+     *\param page The page to show
+     *\param row The row of the page shown at the top of the screen
+     */
+    void showPage(unsigned long page, unsigned long row);
+    
+    /*! Function to move one FIFO load from the transmit ring to the UART, the lock must be held
+     *
+     *\param wait Wether to wait for the FIFO to drain first
+     */
+    void transmit(bool wait);
+    
+    /*! Function to handle the pending interrupts of this port, the lock must be held */
+    void service();
+    
+    /*! Hard handler for IRQ3 and IRQ4, never blocks
+     *
+     *\param registers The stack frame of the interrupted code
+     */
+    static void interrupt(struct I386::Registers* registers);
+    
+    /*! The instance of each port */
+    static Serial* _instances[SERIAL_PORTS];
+    
+    /*! The first I/O port of the UART */
+    unsigned short _base;
+    
+    /*! The IRQ line of the UART */
+    unsigned char _irq;
+    
+    /*! The port index */
+    unsigned int _port;
+    
+    /*! Wether a UART answered on the port */
+    bool _present;
+    
+    /*! The bits currently set in the interrupt enable register */
+    unsigned char _interrupts;
+    
+    /*! Characters waiting to be sent */
+    RingBuffer<char, SERIAL_TX_BUFFER_SIZE> _transmit;
+    
+    /*! Characters received and not read yet */
+    RingBuffer<char, SERIAL_RX_BUFFER_SIZE> _receive;
+    
+    /*! Lock serialising the writers and the interrupt handler */
+    SpinLock _lock;
+};
+
+} /* namespace Core */
+
+#endif	/* _SERIAL_H */
@@ -0,0 +1,185 @@
+/***************************************************************************
+ *            softirq.h
+ *
+ *  Copyright  2008  Matthias v.d. Vlies
+ *  matthias@mserver.nl
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*! \file softirq.h
+ *  \brief Deferred interrupt work
+ *   
+ *  This file defines the SoftIRQ and Tasklet classes. Hardware interrupt handlers only
+ *  acknowledge their device and raise a softirq, the actual work runs later with
+ *  interrupts enabled.
+ *
+ */
+
+#ifndef _SOFTIRQ_H
+#define	_SOFTIRQ_H
+
+#include <config.h>
+#include <core/thread.h>
+
+namespace Core {
+
+/*! Softirq for expiring timers */
+#define SOFTIRQ_TIMER                           0x00
+
+/*! Softirq for input devices */
+#define SOFTIRQ_INPUT                           0x01
+
+/*! Softirq for serial devices */
+#define SOFTIRQ_SERIAL                          0x02
+
+/*! Softirq for running scheduled tasklets */
+#define SOFTIRQ_TASKLET                         0x03
+
+/*! Softirq for advancing grace periods and running RCU callbacks */
+#define SOFTIRQ_RCU                             0x04
+
+/*! Number of softirq vectors, one bit each in the pending word */
+#define SOFTIRQ_COUNT                           32
+
+/*! Maximum number of cycles spent in one pass over the pending softirqs */
+#define SOFTIRQ_BUDGET_CYCLES                   2000000
+
+/*! Maximum number of times a pass restarts when new softirqs got raised */
+#define SOFTIRQ_MAX_RESTART                     10
+
+/*! Type of a softirq handler, runs with interrupts enabled */
+typedef void (*SoftIRQHandler)();
+
+/*! \class SoftIRQ
+ *\brief SoftIRQ class
+ *
+ * Static class for raising and running softirqs. Every processor has its own pending word,
+ * so raising a softirq never touches state of other processors. Pending softirqs run on
+ * interrupt exit, within a time budget. Work left over after the budget runs out is handed to
+ * the softirq thread of the processor, so a flood of softirqs cannot starve other threads.
+ */
+class SoftIRQ {
+    
+public:
+    
+    /*! Function to install the handler for a softirq
+     *
+     *\param number The softirq number
+     *\param handler The handler to run
+     */
+    static void registerHandler(unsigned int number, SoftIRQHandler handler);
+    
+    /*! Function to mark a softirq pending on the current processor.
+     *  Safe to call from hardware interrupt handlers.
+     *
+     *\param number The softirq number
+     */
+    static void raise(unsigned int number);
+    
+    /*! Function to check for pending softirqs on the current processor
+     *
+     *\return Wether softirqs are pending
+     */
+    static bool isPending();
+    
+    /*! Function to run the pending softirqs of the current processor within the time budget.
+     *  Must be called with interrupts disabled, returns with interrupts disabled.
+     */
+    static void run();
+    
+    /*! Function called by the interrupt dispatcher when a hardware handler has finished */
+    static void irqExit();
+    
+    /*! Function to start the softirq thread of the current processor */
+    static void startDaemon();
+    
+private:
+    
+    /*! Softirq thread, runs softirqs left over by interrupt exits
+     *
+     *\param data Unused
+     */
+    static void daemon(unsigned long data);
+    
+    /*! The softirq thread of each processor */
+    static Thread* _daemon[MAX_CPUS];
+    
+    /*! The pending softirqs for each processor */
+    static volatile unsigned long _pending[MAX_CPUS];
+    
+    /*! Wether a processor is already running softirqs */
+    static volatile bool _running[MAX_CPUS];
+    
+    /*! The installed handlers */
+    static SoftIRQHandler _handlers[SOFTIRQ_COUNT];
+};
+
+/*! \class Tasklet
+ *\brief Tasklet class
+ *
+ * A tasklet is a function that gets scheduled from a hardware interrupt handler and runs from
+ * the SOFTIRQ_TASKLET softirq on the same processor. A tasklet is never queued twice, scheduling
+ * a pending tasklet again is a no-op.
+ */
+class Tasklet {
+    
+public:
+    
+    /*! Type of the tasklet function */
+    typedef void (*Function)(unsigned long data);
+    
+    /*! Constructor for the Tasklet class
+     *
+     *\param function The function to run
+     *\param data The argument for the function
+     */
+    Tasklet(Function function, unsigned long data);
+    
+    /*! Function to schedule the tasklet on the current processor */
+    void schedule();
+    
+    /*! Function to install the tasklet softirq handler */
+    static void initialise();
+    
+private:
+    
+    /*! Softirq handler running the queued tasklets */
+    static void runQueued();
+    
+    /*! The function to run */
+    Function _function;
+    
+    /*! The argument for the function */
+    unsigned long _data;
+    
+    /*! Wether the tasklet is queued */
+    volatile bool _scheduled;
+    
+    /*! The next queued tasklet */
+    Tasklet* _next;
+    
+    /*! The first queued tasklet for each processor */
+    static Tasklet* _head[MAX_CPUS];
+    
+    /*! The last queued tasklet for each processor */
+    static Tasklet* _tail[MAX_CPUS];
+};
+
+} /* namespace Core */
+
+#endif	/* _SOFTIRQ_H */
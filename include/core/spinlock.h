@@ -0,0 +1,241 @@
+/***************************************************************************
+ *            spinlock.h
+ *
+ *  Copyright  2008  Matthias v.d. Vlies
+ *  matthias@mserver.nl
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*! \file spinlock.h
+ *  \brief Kernel spinlocks
+ *   
+ *  This file defines the SpinLock and MCSLock classes. SpinLock is a ticket lock for state
+ *  with little contention, MCSLock a queue lock where every waiter spins on its own cache
+ *  line for heavily contended paths. When the kernel is compiled with LOCKSTAT every lock
+ *  class counts its acquisitions, contended acquisitions and the cycles spent waiting.
+ *
+ */
+
+#ifndef _SPINLOCK_H
+#define	_SPINLOCK_H
+
+#include <config.h>
+
+namespace Core {
+
+/*! Number of PAUSE instructions a ticket waiter spins per waiter in front of it */
+#define SPINLOCK_BACKOFF                        16
+
+/*! Maximum number of lock classes the statistics keep track of */
+#define LOCKSTAT_CLASSES                        32
+
+/*! \struct LockClass
+ *\brief LockClass
+ *
+ * This struct describes a group of locks protecting the same kind of data. Counters are kept
+ * per processor so recording never bounces a cache line. Lock classes must have static
+ * storage and are declared with LOCK_CLASS.
+ */
+struct LockClass {
+    
+    /*! Name printed in the statistics */
+    const char* name;
+    
+    /*! Number of acquisitions on each processor */
+    unsigned long acquisitions[MAX_CPUS];
+    
+    /*! Number of acquisitions that had to wait on each processor */
+    unsigned long contentions[MAX_CPUS];
+    
+    /*! Cycles spent waiting on each processor */
+    unsigned long long waitCycles[MAX_CPUS];
+    
+    /*! Set once the class is in the statistics table */
+    volatile unsigned long registered;
+};
+
+/*! Macro for defining a lock class
+ *
+ *\param variable The name of the LockClass variable
+ *\param name The name printed in the statistics
+ */
+#define LOCK_CLASS(variable, name)              Core::LockClass variable = { name, { 0 }, { 0 }, { 0 }, 0 }
+
+/*! \class LockStat
+ *\brief LockStat class
+ *
+ * Static class collecting the lock classes that have been used and printing their counters.
+ */
+class LockStat {
+    
+public:
+    
+    /*! Function to count an acquisition, called with the lock held
+     *
+     *\param lockClass The class of the lock, 0 for unclassified locks
+     *\param contended Wether the acquisition had to wait
+     *\param cycles The cycles spent waiting
+     */
+    static void record(LockClass* lockClass, bool contended, unsigned long long cycles);
+    
+    /*! Function to clear the counters of all classes */
+    static void reset();
+    
+    /*! Function to print the counters of all classes on the console */
+    static void print();
+    
+private:
+    
+    /*! The classes that have been used */
+    static LockClass* _classes[LOCKSTAT_CLASSES];
+    
+    /*! Number of entries in _classes */
+    static volatile unsigned long _count;
+};
+
+/*! \class SpinLock
+ *\brief SpinLock class
+ *
+ * Ticket lock. Waiters take a ticket and spin until the owner counter reaches it, so the lock
+ * is handed out in arrival order. Waiters back off in proportion to their distance from the
+ * front of the queue. A zeroed lock is unlocked, so statically allocated locks need no
+ * constructor. Holding a lock disables preemption.
+ */
+class SpinLock {
+    
+public:
+    
+    /*! Constructor
+     *
+     *\param lockClass The class the statistics count this lock under
+     */
+    SpinLock(LockClass* lockClass = 0);
+    
+    /*! Function to acquire the lock */
+    void lock();
+    
+    /*! Function to acquire the lock without waiting
+     *
+     *\return Wether the lock got acquired
+     */
+    bool tryLock();
+    
+    /*! Function to release the lock */
+    void unlock();
+    
+    /*! Function to disable interrupts and acquire the lock, for data also used by interrupt
+     *  handlers and softirqs
+     *
+     *\return The flags to pass to unlockIrqRestore
+     */
+    unsigned long lockIrqSave();
+    
+    /*! Function to release the lock and restore the interrupt flag
+     *
+     *\param flags The flags returned by lockIrqSave
+     */
+    void unlockIrqRestore(unsigned long flags);
+    
+    /*! Function to check if somebody holds the lock
+     *
+     *\return Wether the lock is held
+     */
+    bool isLocked();
+    
+private:
+    
+    /*! The next ticket to hand out */
+    volatile unsigned long _next;
+    
+    /*! The ticket that holds the lock */
+    volatile unsigned long _owner;
+    
+    /*! The class of the lock */
+    LockClass* _class;
+};
+
+/*! \struct MCSNode
+ *\brief MCSNode
+ *
+ * This struct describes a waiter of an MCSLock. The caller provides it, usually on its stack,
+ * and keeps it alive until it unlocks.
+ */
+struct MCSNode {
+    
+    /*! The waiter queued behind this one */
+    MCSNode* volatile next;
+    
+    /*! Cleared by the previous holder when it hands the lock over */
+    volatile unsigned long locked;
+};
+
+/*! \class MCSLock
+ *\brief MCSLock class
+ *
+ * Queue lock after Mellor-Crummey and Scott. Waiters append their node to a queue with one
+ * atomic exchange and spin on a flag in their own node, so a release touches only the cache
+ * line of the next waiter. A zeroed lock is unlocked. Holding a lock disables preemption.
+ */
+class MCSLock {
+    
+public:
+    
+    /*! Constructor
+     *
+     *\param lockClass The class the statistics count this lock under
+     */
+    MCSLock(LockClass* lockClass = 0);
+    
+    /*! Function to acquire the lock
+     *
+     *\param node The node of this waiter
+     */
+    void lock(MCSNode* node);
+    
+    /*! Function to release the lock
+     *
+     *\param node The node passed to lock
+     */
+    void unlock(MCSNode* node);
+    
+    /*! Function to disable interrupts and acquire the lock
+     *
+     *\param node The node of this waiter
+     *\return The flags to pass to unlockIrqRestore
+     */
+    unsigned long lockIrqSave(MCSNode* node);
+    
+    /*! Function to release the lock and restore the interrupt flag
+     *
+     *\param node The node passed to lockIrqSave
+     *\param flags The flags returned by lockIrqSave
+     */
+    void unlockIrqRestore(MCSNode* node, unsigned long flags);
+    
+private:
+    
+    /*! The last waiter in the queue, 0 when the lock is free */
+    MCSNode* volatile _tail;
+    
+    /*! The class of the lock */
+    LockClass* _class;
+};
+
+} /* namespace Core */
+
+#endif	/* _SPINLOCK_H */
@@ -43,6 +43,95 @@ namespace Core {
 /*! Use serial port as output */
 #define TERMINAL_TYPE_SERIAL                    0x02
 
+/*! Maximum number of rows on a video terminal, larger devices only show this many */
+#define TERMINAL_MAX_ROWS                       256
+
+/*! Number of words in the dirty mask, one bit per row */
+#define TERMINAL_DIRTY_WORDS                    (TERMINAL_MAX_ROWS / 32)
+
+// escape sequence parser states
+
+/*! Printing text */
+#define TERMINAL_STATE_GROUND                   0x00
+
+/*! After an escape character */
+#define TERMINAL_STATE_ESCAPE                   0x01
+
+/*! Collecting the parameters of a control sequence (escape, '[') */
+#define TERMINAL_STATE_CSI                      0x02
+
+/*! Skipping the rest of an unsupported sequence */
+#define TERMINAL_STATE_IGNORE                   0x03
+
+/*! Number of parser states */
+#define TERMINAL_STATES                         4
+
+// character classes of the parser
+
+/*! Control characters */
+#define TERMINAL_CLASS_CONTROL                  0x00
+
+/*! The escape character */
+#define TERMINAL_CLASS_ESCAPE                   0x01
+
+/*! '0' to '9' */
+#define TERMINAL_CLASS_DIGIT                    0x02
+
+/*! ';' between parameters */
+#define TERMINAL_CLASS_SEPARATOR                0x03
+
+/*! ':' and '<' to '?', private parameters */
+#define TERMINAL_CLASS_PRIVATE                  0x04
+
+/*! ' ' to '/', intermediate characters */
+#define TERMINAL_CLASS_INTERMEDIATE             0x05
+
+/*! '[' introducing a control sequence */
+#define TERMINAL_CLASS_BRACKET                  0x06
+
+/*! '@' to '~', the characters ending a sequence */
+#define TERMINAL_CLASS_FINAL                    0x07
+
+/*! Characters outside ASCII */
+#define TERMINAL_CLASS_HIGH                     0x08
+
+/*! Number of character classes */
+#define TERMINAL_CLASSES                        9
+
+// parser actions
+
+/*! Only change state */
+#define TERMINAL_ACTION_NONE                    0x00
+
+/*! Put the character on the screen */
+#define TERMINAL_ACTION_PRINT                   0x01
+
+/*! Carry out a control character */
+#define TERMINAL_ACTION_EXECUTE                 0x02
+
+/*! Start a control sequence without parameters */
+#define TERMINAL_ACTION_CLEAR                   0x03
+
+/*! Add to the parameters */
+#define TERMINAL_ACTION_PARAMETER               0x04
+
+/*! Carry out the control sequence */
+#define TERMINAL_ACTION_DISPATCH                0x05
+
+/*! Macro for encoding a transition of the parser
+ *
+ *\param action The action to take
+ *\param state The next state
+ *\return A transition table entry
+ */
+#define TERMINAL_TRANSITION(action, state)     (((action) << 4) | (state))
+
+/*! Maximum number of parameters of a control sequence, further ones are merged into the last */
+#define TERMINAL_CSI_PARAMETERS                 8
+
+/*! Largest value of a parameter */
+#define TERMINAL_CSI_PARAMETER_MAX              9999
+
 // background and foreground colors        
 
 /*! Black background/foreground color for use on terminal */
@@ -120,13 +209,24 @@ public:
      */
     Terminal(CharacterDevice* device);
     
-    /*! Function for write a sequence of chars to a virtual terminal
+    /*! Function for write a sequence of chars to a virtual terminal. On a video terminal
+     *  control sequences (escape, '[') set colors with 'm', move the cursor with 'A' to 'D',
+     *  'G' and 'H' and erase with 'J' and 'K'.
      *
      *\param sequence The sequence to write
      *\return Status of the I/O operation
      */
     unsigned long write(const char* sequence);
     
+    /*! Function for write a sequence of chars of known length to a virtual terminal,
+     *  the sequence may be longer than the screen
+     *
+     *\param sequence The sequence to write
+     *\param length The number of chars in the sequence
+     *\return Status of the I/O operation
+     */
+    unsigned long write(const char* sequence, unsigned long length);
+    
     /*! Function to put a single character in the Virtual terminal's buffer
      *
      *\param x The x position
@@ -146,14 +246,26 @@ public:
      */
     unsigned long put(int x, int y, char c, short color);
     
-    /*! Function to set the current color for the text.
-     *  Only valid when the Terminal type is TERMINAL_TYPE_VIDEO
+    /*! Function to set the current color for the text, select graphic rendition 0
+     *  returns to it. Only valid when the Terminal type is TERMINAL_TYPE_VIDEO
      *
      *\param color The color created by MAKE_COLOR
      *\return Status of the operation (E_INVALID_TERMINAL when not TERMINAL_TYPE_VIDEO)
      */
     unsigned long setColor(short color);
     
+    /*! Function for getting the number of cells on a row
+     *
+     *\return The number of columns, 0 for a serial terminal
+     */
+    int getColumns();
+    
+    /*! Function for getting the number of rows on the screen
+     *
+     *\return The number of rows, 0 for a serial terminal
+     */
+    int getRows();
+    
     /*! Function for starting a resource
      *
      *\return A status indicating E_SUCCES or E_FAILURE
@@ -177,29 +289,159 @@ private:
     /*! current x position of the cursor */
     int _x;
     
-    /*! current y position of the cursor */
+    /*! current y position of the cursor, relative to the top of the screen */
     int _y;
     
     /*! type of terminal */
     int _type;
     
-    /*! The internal buffer */
+    /*! Number of cells on a row, taken from the device */
+    int _columns;
+    
+    /*! Number of rows on the screen, taken from the device */
+    int _rows;
+    
+    /*! Number of rows in the ring, the screen plus TERMINAL_SCROLLBACK_SCREENS screens of history */
+    int _ringRows;
+    
+    /*! The internal buffer, a ring of _ringRows rows */
     short* _buffer;
     
     /*! The size of the internal buffer */
     int _bufferSize;
     
+    /*! Ring row shown at the top of the screen */
+    int _head;
+    
+    /*! Number of valid rows in front of the head */
+    int _history;
+    
+    /*! Number of rows the view is scrolled back, 0 shows the live screen */
+    int _view;
+    
+    /*! Page of the device the terminal is shown on, set by the Console */
+    unsigned long _page;
+    
+    /*! First cell of that page */
+    unsigned long _origin;
+    
+    /*! Number of rows of the device the terminal owns from its page on, more than _rows
+     *  when the device scrolls by moving the start of the screen. Set by the Console
+     */
+    int _pageRows;
+    
+    /*! Row of those shown at the top of the screen */
+    int _top;
+    
     /*! The color for writing text, unused when type is TERMINAL_TYPE_SERIAL */
     short _color;
     
-    /*! Function for scrolling the buffer */
+    /*! The color set with setColor(), restored by select graphic rendition 0 */
+    short _defaultColor;
+    
+    /*! State of the escape sequence parser */
+    unsigned char _state;
+    
+    /*! Number of parameters of the control sequence */
+    int _parameterCount;
+    
+    /*! Parameters of the control sequence, 0 when omitted */
+    int _parameters[TERMINAL_CSI_PARAMETERS];
+    
+    /*! Mask of rows changed since the last flush, bit n is row n */
+    unsigned long _dirty[TERMINAL_DIRTY_WORDS];
+    
+    /*! Function for marking a row as changed
+     *
+     *\param row The row which needs to be flushed
+     */
+    void markDirty(int row);
+    
+    /*! Function for marking every row as changed, used when the whole
+     *  device contents are lost
+     */
+    void markAllDirty();
+    
+    /*! Function for checking if a row changed since the last flush
+     *
+     *\param row The screen row
+     *\return Wether the row needs to be flushed
+     */
+    bool isDirty(int row);
+    
+    /*! Function for forgetting the changed rows once they are flushed */
+    void clearDirty();
+    
+    /*! Function for moving the changed rows up by one, for when the rows the device
+     *  shows moved up with the screen
+     */
+    void shiftDirty();
+    
+    /*! Function for getting a row of the live screen
+     *
+     *\param y The screen row
+     *\return The cells of the row in the ring
+     */
+    short* getRow(int y);
+    
+    /*! Function for getting the ring row shown on a screen row, which takes the
+     *  scrollback view into account
+     *
+     *\param y The screen row
+     *\return Index of the row in the ring
+     */
+    int getVisibleRow(int y);
+    
+    /*! Function for scrolling the buffer, moves the head by one row and clears
+     *  the new bottom row, the oldest row becomes history. When the terminal owns more
+     *  rows than the screen the device scrolls by showing the next row at the top,
+     *  otherwise only rows showing other cells than before get flushed
+     */
     void scroll();
     
+    /*! Function for moving the view through the scrollback
+     *
+     *\param rows Number of rows to move back, negative moves forward
+     *\return True when the view changed
+     */
+    bool scrollView(int rows);
+    
     /*! Function for putting one character in the buffer
      *
      *\param c The character to put
      */
     void put(char c);
+    
+    /*! Function for feeding one character through the escape sequence parser
+     *
+     *\param c The character
+     */
+    void parse(char c);
+    
+    /*! Function for getting a parameter of the control sequence
+     *
+     *\param index The number of the parameter
+     *\param value The value to use when it was omitted or 0
+     *\return The parameter
+     */
+    int getParameter(int index, int value);
+    
+    /*! Function for carrying out a control sequence
+     *
+     *\param final The character ending the sequence
+     */
+    void dispatch(char final);
+    
+    /*! Function for applying select graphic rendition parameters to the color */
+    void selectGraphicRendition();
+    
+    /*! Function for blanking part of a row
+     *
+     *\param y The screen row
+     *\param from The first column to blank
+     *\param to The column after the last one to blank
+     */
+    void erase(int y, int from, int to);
 };
 
 } /* namespace Core */
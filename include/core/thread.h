@@ -0,0 +1,173 @@
+/***************************************************************************
+ *            thread.h
+ *
+ *  Copyright  2008  Matthias v.d. Vlies
+ *  matthias@mserver.nl
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*! \file thread.h
+ *  \brief Kernel threads
+ *   
+ *  This file defines the Thread class. Every thread has its own kernel stack and
+ *  FPU save area and is switched in software by the Scheduler.
+ *
+ */
+
+#ifndef _THREAD_H
+#define	_THREAD_H
+
+#include <config.h>
+
+namespace Core {
+
+/*! Thread is waiting in a run queue */
+#define THREAD_READY                            0x00
+
+/*! Thread is running on a processor */
+#define THREAD_RUNNING                          0x01
+
+/*! Thread is waiting for Scheduler::wake() */
+#define THREAD_BLOCKED                          0x02
+
+/*! Thread has exited */
+#define THREAD_DEAD                             0x03
+
+/*! Number of priority levels, 0 is the highest */
+#define THREAD_PRIORITIES                       64
+
+/*! Priority of threads that do not ask for another one */
+#define THREAD_DEFAULT_PRIORITY                 32
+
+/*! Priority of background work */
+#define THREAD_LOWEST_PRIORITY                  (THREAD_PRIORITIES - 1)
+
+/*! \class Thread
+ *\brief Thread class
+ *
+ * A kernel thread. Create it, then start() it to make it runnable on the current processor.
+ */
+class Thread {
+    
+public:
+    
+    /*! Type of the thread function */
+    typedef void (*Function)(unsigned long data);
+    
+    /*! Constructor for the Thread class
+     *
+     *\param function The function to run, the thread exits when it returns
+     *\param data The argument for the function
+     *\param name The name of the thread
+     *\param priority The priority, 0 is the highest
+     */
+    Thread(Function function, unsigned long data, const char* name, int priority = THREAD_DEFAULT_PRIORITY);
+    
+    /*! Function to allocate the stack and make the thread runnable
+     *
+     *\return E_SUCCESS or E_ALLOC_NOMEM
+     */
+    unsigned long start();
+    
+    /*! Function to pin the thread to a processor, so work stealing never moves it. Call
+     *  it before start(), which otherwise picks the current processor.
+     *
+     *\param cpu The processor
+     */
+    void bind(unsigned int cpu);
+    
+    /*! Function for getting the name of a thread
+     *
+     *\return The thread's name
+     */
+    const char* getName();
+    
+    /*! Function for getting the state of a thread
+     *
+     *\return One of the THREAD_ states
+     */
+    int getState();
+    
+    /*! Function for getting the priority of a thread
+     *
+     *\return The priority, 0 is the highest
+     */
+    int getPriority();
+    
+    /*! Function to end the calling thread */
+    static void exit();
+    
+private:
+    
+    friend class Scheduler;
+    
+    /*! Constructor wrapping the context that is already running on a processor
+     *
+     *\param name The name of the thread
+     */
+    Thread(const char* name);
+    
+    /*! First function a new thread runs
+     *
+     *\param thread The thread
+     */
+    static void bootstrap(Thread* thread);
+    
+    /*! The function to run */
+    Function _function;
+    
+    /*! The argument for the function */
+    unsigned long _data;
+    
+    /*! The name of the thread */
+    const char* _name;
+    
+    /*! The saved stack pointer while the thread is not running */
+    unsigned long _stackPointer;
+    
+    /*! The top of the kernel stack */
+    unsigned long _stackTop;
+    
+    /*! The FPU save area, 0 when the processor has no FPU */
+    void* _fpuContext;
+    
+    /*! The state of the thread, a word so wakers can change it atomically */
+    volatile unsigned long _state;
+    
+    /*! The priority, 0 is the highest */
+    int _priority;
+    
+    /*! Remaining ticks of the current time slice */
+    unsigned long _timeSlice;
+    
+    /*! The processor the thread runs on */
+    unsigned int _cpu;
+    
+    /*! Wether the thread may only run on _cpu */
+    bool _bound;
+    
+    /*! Wether a processor still executes on the stack of the thread */
+    volatile bool _onProcessor;
+    
+    /*! The next thread in the same run queue */
+    Thread* _next;
+};
+
+} /* namespace Core */
+
+#endif	/* _THREAD_H */
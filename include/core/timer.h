@@ -0,0 +1,235 @@
+/***************************************************************************
+ *            timer.h
+ *
+ *  Copyright  2008  Matthias v.d. Vlies
+ *  matthias@mserver.nl
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*! \file timer.h
+ *  \brief Kernel timers
+ *   
+ *  This file defines the Timer and TimerWheel classes. Timers live in a hierarchical
+ *  timing wheel per processor, so adding and cancelling a timer is O(1) no matter how
+ *  many timers are pending.
+ *
+ */
+
+#ifndef _TIMER_H
+#define	_TIMER_H
+
+#include <config.h>
+#include <core/spinlock.h>
+
+namespace Core {
+
+/*! Number of index bits of the first level */
+#define TIMER_ROOT_BITS                         8
+
+/*! Number of index bits of the cascading levels */
+#define TIMER_LEVEL_BITS                        6
+
+/*! Number of slots in the first level */
+#define TIMER_ROOT_SIZE                         (1 << TIMER_ROOT_BITS)
+
+/*! Number of slots in each cascading level */
+#define TIMER_LEVEL_SIZE                        (1 << TIMER_LEVEL_BITS)
+
+/*! Number of cascading levels, together with the first level they cover 32 bits */
+#define TIMER_LEVELS                            4
+
+/*! Timers get a slack of 1/2^TIMER_DEFAULT_SLACK_SHIFT of their delay unless set explicitly */
+#define TIMER_DEFAULT_SLACK_SHIFT               8
+
+/*! Timer is not queued on any wheel */
+#define TIMER_NOT_QUEUED                        -1
+
+/*! \class Timer
+ *\brief Timer class
+ *
+ * A one-shot timer. The function runs in softirq context on the processor that added the timer.
+ */
+class Timer {
+    
+public:
+    
+    /*! Type of the timer function */
+    typedef void (*Function)(unsigned long data);
+    
+    /*! Constructor for the Timer class
+     *
+     *\param function The function to run on expiry
+     *\param data The argument for the function
+     */
+    Timer(Function function, unsigned long data);
+    
+    /*! Function to set how many ticks the timer may fire late, so it can be
+     *  batched with timers expiring around the same time
+     *
+     *\param ticks The slack in ticks
+     */
+    void setSlack(unsigned long ticks);
+    
+    /*! Function to check if the timer is queued
+     *
+     *\return Wether the timer is pending
+     */
+    bool isPending();
+    
+private:
+    
+    friend class TimerWheel;
+    
+    /*! The function to run */
+    Function _function;
+    
+    /*! The argument for the function */
+    unsigned long _data;
+    
+    /*! The tick the timer expires on */
+    unsigned long _expires;
+    
+    /*! The allowed slack, or -1 for the default */
+    long _slack;
+    
+    /*! The processor whose wheel holds the timer, or TIMER_NOT_QUEUED */
+    int _cpu;
+    
+    /*! The next timer in the same slot */
+    Timer* _next;
+    
+    /*! The pointer pointing to this timer */
+    Timer** _pprev;
+};
+
+/*! \class TimerWheel
+ *\brief TimerWheel class
+ *
+ * Static class holding a hierarchical timing wheel for each processor. The first level has
+ * one slot per tick for the next TIMER_ROOT_SIZE ticks, each further level has slots that
+ * are TIMER_LEVEL_SIZE times as coarse. Whenever the first level wraps, one slot of the next
+ * level gets cascaded down.
+ */
+class TimerWheel {
+    
+public:
+    
+    /*! Function to install the timer softirq */
+    static void initialise();
+    
+    /*! Function called from the timer interrupt on every tick */
+    static void tick();
+    
+    /*! Function to get the number of ticks since boot
+     *
+     *\return The tick count
+     */
+    static unsigned long getTicks();
+    
+    /*! Function to queue a timer on the wheel of the current processor. A pending timer
+     *  gets moved to its new expiry.
+     *
+     *\param timer The timer
+     *\param delay Number of ticks from now
+     */
+    static void add(Timer* timer, unsigned long delay);
+    
+    /*! Function to cancel a timer
+     *
+     *\param timer The timer
+     *\return Wether the timer was pending
+     */
+    static bool cancel(Timer* timer);
+    
+private:
+    
+    /*! \struct Wheel
+     *\brief Wheel
+     *
+     * The timing wheel of one processor
+     */
+    struct Wheel {
+        
+        /*! The next tick to process */
+        unsigned long ticks;
+        
+        /*! The first level */
+        Timer* root[TIMER_ROOT_SIZE];
+        
+        /*! The cascading levels */
+        Timer* levels[TIMER_LEVELS][TIMER_LEVEL_SIZE];
+        
+        /*! Lock for the slots and the timers queued in them, other processors take it
+         *  to cancel or move a timer
+         */
+        SpinLock lock;
+    };
+    
+    /*! Softirq handler expiring the timers of the current processor */
+    static void run();
+    
+    /*! Function to lock the wheel of the current processor together with the wheel a timer
+     *  is queued on. The wheels get locked in index order, interrupts must be disabled.
+     *
+     *\param own The wheel of the current processor
+     *\param timer The timer
+     *\return The other locked wheel, 0 when the timer is not queued on another wheel
+     */
+    static Wheel* lockWheels(Wheel* own, Timer* timer);
+    
+    /*! Function to put a timer in the slot matching its expiry, called with the wheel locked
+     *
+     *\param wheel The wheel
+     *\param timer The timer
+     */
+    static void enqueue(Wheel* wheel, Timer* timer);
+    
+    /*! Function to take a timer out of its slot
+     *
+     *\param timer The timer
+     */
+    static void unlink(Timer* timer);
+    
+    /*! Function to move the timers of one slot of a cascading level down, called with the
+     *  wheel locked
+     *
+     *\param wheel The wheel
+     *\param level The cascading level
+     *\return The slot index, 0 when the next level needs cascading as well
+     */
+    static unsigned long cascade(Wheel* wheel, int level);
+    
+    /*! Function to round an expiry up within its slack to a coarse boundary, so
+     *  timers with nearby expiries end up in the same slot
+     *
+     *\param expires The requested expiry
+     *\param slack The allowed slack
+     *\return The expiry to use
+     */
+    static unsigned long applySlack(unsigned long expires, unsigned long slack);
+    
+    /*! The ticks since boot */
+    static volatile unsigned long _ticks;
+    
+    /*! The wheels of all processors */
+    static Wheel _wheels[MAX_CPUS];
+};
+
+} /* namespace Core */
+
+#endif	/* _TIMER_H */
@@ -37,6 +37,27 @@
 
 namespace Core {
 
+/*! Number of cells on a row of the text screen */
+#define VIDEO_COLUMNS                           80
+
+/*! Number of rows of the text screen */
+#define VIDEO_ROWS                              (VIDEO_SIZE / VIDEO_COLUMNS)
+
+/*! Number of screens fitting in the 32 KB of video memory */
+#define VIDEO_PAGES                             8
+
+/*! CRT controller register index port */
+#define VIDEO_CRTC_INDEX                        0x3d4
+
+/*! CRT controller register data port */
+#define VIDEO_CRTC_DATA                         0x3d5
+
+/*! CRT controller register holding the high byte of the first cell shown */
+#define VIDEO_CRTC_START_HIGH                   0x0c
+
+/*! CRT controller register holding the low byte of the first cell shown */
+#define VIDEO_CRTC_START_LOW                    0x0d
+
 /*! \class Video
  *\brief Video class
  *
@@ -61,6 +82,24 @@ public:
      */
     unsigned long getTerminalType();
     
+    /*! Function for getting the number of cells on a row
+     *
+     *\return The number of columns, 0 for devices without cells
+     */
+    unsigned long getColumns();
+    
+    /*! Function for getting the number of rows of cells
+     *
+     *\return The number of rows, 0 for devices without cells
+     */
+    unsigned long getRows();
+    
+    /*! Function for getting the number of screens the device holds at once
+     *
+     *\return The number of pages, 0 for devices without cells
+     */
+    unsigned long getPages();
+    
     /*! Function for starting a resource
      *
      *\return A status indicating E_SUCCES or E_FAILURE
@@ -94,6 +133,29 @@ private:
      */
     unsigned long write(void* buffer, unsigned long size);
     
+    /*! Function for writing part of a Character Device's buffer, only the
+     *  cells from offset up to offset + size are replaced
+     *
+     *\param buffer The cells to copy
+     *\param offset The first cell of the device to replace
+     *\param size The number of cells to copy
+     *\return An error code or E_SUCCESS
+     */
+    unsigned long write(void* buffer, unsigned long offset, unsigned long size);
+    
+    /*! Function for showing the cells written since the last call, devices that
+     *  draw straight to the screen have nothing to do
+     */
+    void present();
+    
+    /*! Function for showing another page, the contents of the pages are kept. Rows
+     *  past the end of the page continue on the next one
+     *
+     *\param page The page to show
+     *\param row The row of the page shown at the top of the screen
+     */
+    void showPage(unsigned long page, unsigned long row);
+    
     /*! A static instance of the class for singleton usage */ 
     static Video* _instance;
     
@@ -0,0 +1,137 @@
+/***************************************************************************
+ *            waitqueue.h
+ *
+ *  Copyright  2008  Matthias v.d. Vlies
+ *  matthias@mserver.nl
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*! \file waitqueue.h
+ *  \brief Wait queues
+ *   
+ *  This file defines the WaitQueue class. Threads waiting for a condition sleep on a wait
+ *  queue and are woken by whoever makes the condition true.
+ *
+ */
+
+#ifndef _WAITQUEUE_H
+#define	_WAITQUEUE_H
+
+#include <config.h>
+#include <core/spinlock.h>
+#include <core/thread.h>
+
+namespace Core {
+
+/*! \struct WaitQueueEntry
+ *\brief WaitQueueEntry
+ *
+ * This struct describes a thread sleeping on a wait queue. It lives on the stack of the
+ * waiting thread.
+ */
+struct WaitQueueEntry {
+    
+    /*! The waiting thread */
+    Thread* thread;
+    
+    /*! Wether a wake up hands the event to this waiter only */
+    bool exclusive;
+    
+    /*! Wether the entry is linked into the queue */
+    bool queued;
+    
+    /*! The next waiter */
+    WaitQueueEntry* next;
+};
+
+/*! \class WaitQueue
+ *\brief WaitQueue class
+ *
+ * A list of sleeping threads. Non-exclusive waiters are queued in front and are all woken by
+ * every wake up. Exclusive waiters are queued at the back in arrival order and a wake up
+ * wakes only the first of them, so a released resource does not wake a herd of threads that
+ * can not all get it. A zeroed queue is empty.
+ */
+class WaitQueue {
+    
+public:
+    
+    /*! Type of a wait condition, called with the queue lock held and interrupts disabled
+     *
+     *\param data The data passed to wait
+     *\return Wether the waiter may continue
+     */
+    typedef bool (*Condition)(void* data);
+    
+    /*! Constructor */
+    WaitQueue();
+    
+    /*! Function to sleep until a condition holds. The waiter gets queued before the
+     *  condition is checked, so a waker that makes the condition true and then calls
+     *  wakeUp is never missed. Must not be called with preemption disabled.
+     *
+     *\param condition The condition
+     *\param data The argument for the condition
+     *\param exclusive Wether to be woken alone
+     */
+    void wait(Condition condition, void* data, bool exclusive = false);
+    
+    /*! Function to wake all non-exclusive waiters and the first exclusive one, safe from
+     *  interrupt handlers
+     */
+    void wakeUp();
+    
+    /*! Function to wake all waiters, safe from interrupt handlers */
+    void wakeUpAll();
+    
+    /*! Function to check if there are waiters without taking the lock
+     *
+     *\return Wether the queue has waiters
+     */
+    bool isEmpty();
+    
+private:
+    
+    /*! Function to link a waiter into the queue, called with the lock held
+     *
+     *\param entry The waiter
+     */
+    void enqueue(WaitQueueEntry* entry);
+    
+    /*! Function to unlink a waiter from the queue, called with the lock held
+     *
+     *\param entry The waiter
+     */
+    void dequeue(WaitQueueEntry* entry);
+    
+    /*! Function to wake waiters
+     *
+     *\param all Wether exclusive waiters all get woken too
+     */
+    void wake(bool all);
+    
+    /*! The first waiter */
+    WaitQueueEntry* volatile _head;
+    
+    /*! Lock for the list */
+    SpinLock _lock;
+};
+
+} /* namespace Core */
+
+#endif	/* _WAITQUEUE_H */
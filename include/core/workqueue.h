@@ -0,0 +1,393 @@
+/***************************************************************************
+ *            workqueue.h
+ *
+ *  Copyright  2008  Matthias v.d. Vlies
+ *  matthias@mserver.nl
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*! \file workqueue.h
+ *  \brief Workqueues
+ *   
+ *  This file defines the Work, DelayedWork and WorkQueue classes. Work items run in process
+ *  context on pools of kernel threads, so they may sleep, unlike softirqs and tasklets.
+ *
+ */
+
+#ifndef _WORKQUEUE_H
+#define	_WORKQUEUE_H
+
+#include <config.h>
+#include <core/thread.h>
+#include <core/timer.h>
+#include <core/spinlock.h>
+#include <core/waitqueue.h>
+
+namespace Core {
+
+/*! Maximum number of worker threads per processor and workqueue */
+#define WORKQUEUE_MAX_WORKERS                   8
+
+/*! Number of worker threads per processor of the system workqueue */
+#define WORKQUEUE_SYSTEM_WORKERS                4
+
+class WorkQueue;
+struct WorkPool;
+
+/*! \class Work
+ *\brief Work class
+ *
+ * A work item. It can be queued again once its function started, the function then runs a
+ * second time.
+ */
+class Work {
+    
+public:
+    
+    /*! Type of the work function */
+    typedef void (*Function)(unsigned long data);
+    
+    /*! Constructor for the Work class
+     *
+     *\param function The function to run
+     *\param data The argument for the function
+     */
+    Work(Function function, unsigned long data);
+    
+    /*! Function to check if the work is queued or waiting for its delay
+     *
+     *\return Wether the work is pending
+     */
+    bool isPending();
+    
+private:
+    
+    friend class WorkQueue;
+    
+    /*! The function to run */
+    Function _function;
+    
+    /*! The argument for the function */
+    unsigned long _data;
+    
+    /*! Set by whoever queues the work, cleared when it starts or gets cancelled */
+    volatile unsigned long _pending;
+    
+    /*! The pool the work is queued on, 0 while it is not in a list */
+    WorkPool* volatile _pool;
+    
+    /*! Position in the pool, for flushing */
+    unsigned long _ticket;
+    
+    /*! The next work in the same pool */
+    Work* _next;
+};
+
+/*! \class DelayedWork
+ *\brief DelayedWork class
+ *
+ * A work item that gets queued when its timer expires. The timer and the work use the
+ * processor that queued it.
+ */
+class DelayedWork : public Work {
+    
+public:
+    
+    /*! Constructor for the DelayedWork class
+     *
+     *\param function The function to run
+     *\param data The argument for the function
+     */
+    DelayedWork(Function function, unsigned long data);
+    
+private:
+    
+    friend class WorkQueue;
+    
+    /*! Timer function queueing the work
+     *
+     *\param data The delayed work
+     */
+    static void expire(unsigned long data);
+    
+    /*! The delay timer */
+    Timer _timer;
+    
+    /*! The workqueue to queue on when the timer expires */
+    WorkQueue* _queue;
+};
+
+/*! \struct WorkerSlot
+ *\brief WorkerSlot
+ *
+ * This struct describes one worker thread of a pool
+ */
+struct WorkerSlot {
+    
+    /*! The pool of the worker */
+    WorkPool* pool;
+    
+    /*! The work being run, 0 while idle */
+    Work* current;
+    
+    /*! Ticket of the work being run */
+    unsigned long ticket;
+};
+
+/*! \struct WorkPool
+ *\brief WorkPool
+ *
+ * This struct describes the work list and the worker threads of one workqueue on one
+ * processor
+ */
+struct WorkPool {
+    
+    /*! The workqueue */
+    WorkQueue* queue;
+    
+    /*! The processor */
+    unsigned int cpu;
+    
+    /*! The first queued work */
+    Work* volatile head;
+    
+    /*! The last queued work */
+    Work* tail;
+    
+    /*! Ticket for the next queued work */
+    unsigned long nextTicket;
+    
+    /*! Number of started workers */
+    unsigned int workers;
+    
+    /*! Number of workers waiting for work */
+    unsigned int idle;
+    
+    /*! Wether a worker is starting another one */
+    bool growing;
+    
+    /*! The workers */
+    WorkerSlot slots[WORKQUEUE_MAX_WORKERS];
+    
+    /*! Idle workers sleep here */
+    WaitQueue waiters;
+    
+    /*! Lock for the list and the slots */
+    SpinLock lock;
+};
+
+/*! \class WorkQueue
+ *\brief WorkQueue class
+ *
+ * A workqueue with a pool of worker threads on every processor. Work runs on the processor
+ * that queued it, so its data is still in that processor's cache, and a burst of work wakes
+ * a single worker that runs it in order. Each pool starts with one worker pinned to its
+ * processor; whenever a worker takes work while more is waiting and no worker is idle it
+ * starts another, up to the pool limit, so sleeping work does not hold up the rest.
+ */
+class WorkQueue {
+    
+public:
+    
+    /*! Constructor for the WorkQueue class
+     *
+     *\param name The name of the worker threads
+     *\param maxWorkers Maximum number of workers per processor
+     *\param priority The priority of the worker threads
+     */
+    WorkQueue(const char* name, unsigned int maxWorkers, int priority = THREAD_DEFAULT_PRIORITY);
+    
+    /*! Function to start the first worker on every online processor
+     *
+     *\return E_SUCCESS or E_ALLOC_NOMEM
+     */
+    unsigned long start();
+    
+    /*! Function to queue work on the current processor, or the boot processor when this
+     *  processor has no workers. Safe from interrupt handlers.
+     *
+     *\param work The work
+     *\return False if the work was already pending
+     */
+    bool queue(Work* work);
+    
+    /*! Function to queue work on a given processor, or the boot processor when that
+     *  processor has no workers. Safe from interrupt handlers.
+     *
+     *\param work The work
+     *\param cpu The processor
+     *\return False if the work was already pending
+     */
+    bool queueOn(Work* work, unsigned int cpu);
+    
+    /*! Function to queue work once a delay ran out. Safe from interrupt handlers.
+     *
+     *\param work The work
+     *\param delay The delay in ticks
+     *\return False if the work was already pending
+     */
+    bool queueDelayed(DelayedWork* work, unsigned long delay);
+    
+    /*! Function to wait until all work queued before the call has run, may sleep */
+    void flush();
+    
+    /*! Function to take work off the queue before it starts
+     *
+     *\param work The work
+     *\return Wether the work was pending
+     */
+    bool cancel(Work* work);
+    
+    /*! Function to take delayed work off its timer or the queue. The timer must be on the
+     *  wheel of the current processor.
+     *
+     *\param work The work
+     *\return Wether the work was pending
+     */
+    bool cancel(DelayedWork* work);
+    
+    /*! Function to cancel work and wait until no worker runs it any more, may sleep
+     *
+     *\param work The work
+     *\return Wether the work was pending
+     */
+    bool cancelSync(Work* work);
+    
+    /*! Function to cancel delayed work and wait until no worker runs it any more, may sleep
+     *
+     *\param work The work
+     *\return Wether the work was pending
+     */
+    bool cancelSync(DelayedWork* work);
+    
+    /*! Function to create the system workqueue, call once the processors are up */
+    static void initialise();
+    
+    /*! Function to get the shared workqueue for work that needs no queue of its own
+     *
+     *\return The system workqueue
+     */
+    static WorkQueue* getSystemQueue();
+    
+private:
+    
+    friend class DelayedWork;
+    
+    /*! \struct FlushRequest
+     *\brief FlushRequest
+     *
+     * The work a flush or cancelSync waits for
+     */
+    struct FlushRequest {
+        
+        /*! The workqueue */
+        WorkQueue* queue;
+        
+        /*! The work cancelSync waits for */
+        Work* work;
+        
+        /*! The first ticket not to wait for, per processor */
+        unsigned long tickets[MAX_CPUS];
+    };
+    
+    /*! Function to put claimed work on the list of a processor
+     *
+     *\param work The work, its pending flag already set
+     *\param cpu The processor, MAX_CPUS for the current one
+     */
+    void insert(Work* work, unsigned int cpu = MAX_CPUS);
+    
+    /*! Function to unlink queued work
+     *
+     *\param work The work
+     *\return Wether the work was in a list
+     */
+    bool unqueue(Work* work);
+    
+    /*! Function to start another worker on a pool, called by the one worker that set
+     *  growing
+     *
+     *\param pool The pool
+     *\return E_SUCCESS or E_ALLOC_NOMEM
+     */
+    unsigned long startWorker(WorkPool* pool);
+    
+    /*! Function to wait until no worker runs a work
+     *
+     *\param work The work
+     */
+    void waitIdle(Work* work);
+    
+    /*! Function to wake flushers after work finished or got cancelled, when there are any
+     *
+     *\param wake Wether a flusher was seen with the pool lock held
+     */
+    void finished(bool wake);
+    
+    /*! Thread function of the workers
+     *
+     *\param data The slot of the worker
+     */
+    static void worker(unsigned long data);
+    
+    /*! Wait condition of idle workers
+     *
+     *\param data The pool
+     *\return Wether there is work
+     */
+    static bool hasWork(void* data);
+    
+    /*! Wait condition of flush()
+     *
+     *\param data The flush request
+     *\return Wether all work before the tickets is done
+     */
+    static bool isFlushed(void* data);
+    
+    /*! Wait condition of cancelSync()
+     *
+     *\param data The flush request
+     *\return Wether no worker runs the work
+     */
+    static bool isIdle(void* data);
+    
+    /*! The system workqueue */
+    static WorkQueue* _system;
+    
+    /*! The name of the worker threads */
+    const char* _name;
+    
+    /*! Maximum number of workers per processor */
+    unsigned int _maxWorkers;
+    
+    /*! The priority of the worker threads */
+    int _priority;
+    
+    /*! Number of threads in flush() or cancelSync() */
+    volatile unsigned long _flushing;
+    
+    /*! Flushers sleep here */
+    WaitQueue _flushers;
+    
+    /*! The pool of each processor */
+    WorkPool _pools[MAX_CPUS];
+};
+
+} /* namespace Core */
+
+#endif	/* _WORKQUEUE_H */
@@ -33,6 +33,14 @@
 /* The magic number passed by a Multiboot-compliant boot loader. */
 #define MULTIBOOT_BOOTLOADER_MAGIC      0x2BADB002
 
+/* The framebuffer fields of the Multiboot information are valid. */
+#define MULTIBOOT_INFO_FRAMEBUFFER      0x00001000
+
+/* Framebuffer types. */
+#define MULTIBOOT_FRAMEBUFFER_INDEXED   0
+#define MULTIBOOT_FRAMEBUFFER_RGB       1
+#define MULTIBOOT_FRAMEBUFFER_TEXT      2
+
 /* The size of our stack (16KB). */
 #define STACK_SIZE                      0x4000
 
@@ -58,6 +66,10 @@ typedef struct multiboot_header {
     unsigned long load_end_addr;
     unsigned long bss_end_addr;
     unsigned long entry_addr;
+    unsigned long mode_type;
+    unsigned long width;
+    unsigned long height;
+    unsigned long depth;
 } multiboot_header_t;
 
 /* The symbol table for a.out. */
@@ -92,7 +104,30 @@ typedef struct multiboot_info {
     } u;
     unsigned long mmap_length;
     unsigned long mmap_addr;
-} multiboot_info_t;
+    unsigned long drives_length;
+    unsigned long drives_addr;
+    unsigned long config_table;
+    unsigned long boot_loader_name;
+    unsigned long apm_table;
+    unsigned long vbe_control_info;
+    unsigned long vbe_mode_info;
+    unsigned short vbe_mode;
+    unsigned short vbe_interface_seg;
+    unsigned short vbe_interface_off;
+    unsigned short vbe_interface_len;
+    unsigned long long framebuffer_addr;
+    unsigned long framebuffer_pitch;
+    unsigned long framebuffer_width;
+    unsigned long framebuffer_height;
+    unsigned char framebuffer_bpp;
+    unsigned char framebuffer_type;
+    unsigned char framebuffer_red_field_position;
+    unsigned char framebuffer_red_mask_size;
+    unsigned char framebuffer_green_field_position;
+    unsigned char framebuffer_green_mask_size;
+    unsigned char framebuffer_blue_field_position;
+    unsigned char framebuffer_blue_mask_size;
+} __attribute__((packed)) multiboot_info_t;
 
 /* The module structure. */
 typedef struct module {
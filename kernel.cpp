@@ -30,18 +30,32 @@
 #include <config.h>
 #include <errors.h>
 #include <core/video.h>
+#include <core/framebuffer.h>
+#include <core/bochsdisplay.h>
 #include <grub/multiboot.h>
 
 #include <core/staticallocator.h>
 #include <core/kernelallocator.h>
 
 #include <core/console.h>
+#include <core/format.h>
 #include <core/terminal.h>
 
 #include <core/resource.h>
 #include <grub/grub.h>
 
 #include <core/architecture.h>
+#include <core/keyboard.h>
+#include <core/softirq.h>
+#include <core/timer.h>
+#include <core/scheduler.h>
+#include <core/spinlock.h>
+#include <core/rcu.h>
+#include <core/workqueue.h>
+#include <core/idle.h>
+#include <core/klog.h>
+#include <core/serial.h>
+#include <core/latencytracer.h>
 
 /*! High level code entrypoint
  *
@@ -51,14 +65,45 @@
  */
 extern "C" int kernel(unsigned long magic, unsigned long address) {
     
+    multiboot_info_t* multibootInfo = reinterpret_cast<multiboot_info_t*>(address);
+    
+    Core::CharacterDevice* screen = Core::Video::getInstance();
+    
+    // draw on the framebuffer when the boot loader switched to a graphics mode
+    if(magic == MULTIBOOT_BOOTLOADER_MAGIC && (multibootInfo->flags & MULTIBOOT_INFO_FRAMEBUFFER)
+        && multibootInfo->framebuffer_type == MULTIBOOT_FRAMEBUFFER_RGB) {
+        
+        Core::Framebuffer* framebuffer = Core::Framebuffer::getInstance();
+        
+        if(framebuffer->setMode(static_cast<unsigned long>(multibootInfo->framebuffer_addr), multibootInfo->framebuffer_pitch,
+            multibootInfo->framebuffer_width, multibootInfo->framebuffer_height, multibootInfo->framebuffer_bpp) == E_SUCCESS) {
+            
+            screen = framebuffer;
+            
+            // on Bochs and QEMU frames are drawn off-screen and flipped in
+            if(Core::BochsDisplay::getInstance()->isPresent()) {
+                
+                framebuffer->enableFlipping(Core::BochsDisplay::getInstance());
+            }
+        }
+    }
+    
     // create a new terminal
-    Core::Terminal* terminal = new Core::Terminal(Core::Video::getInstance());
+    Core::Terminal* terminal = new Core::Terminal(screen);
     
     // set new colors
     terminal->setColor(MAKE_COLOR(TERMINAL_BLACK, TERMINAL_WHITE, FALSE));
     
     Core::Console* console = Core::Console::getInstance();
     
+    // the first virtual terminal shows the boot messages, alt + F2 and on show the others
+    console->addTerminal(terminal);
+    
+    for(int n = 1; n < CONSOLE_TERMINALS; n++) {
+        
+        console->addTerminal(new Core::Terminal(screen));
+    }
+    
     // switch to it
     console->switchTerminal(terminal);
     
@@ -87,20 +132,66 @@ extern "C" int kernel(unsigned long magic, unsigned long address) {
     // static resource initialisation
     manager->registerResource(Core::KernelAllocator::getInstance());
     manager->registerResource(Core::StaticAllocator::getInstance());
-    manager->registerResource(Core::Video::getInstance());
+    manager->registerResource(screen);
     manager->registerResource(console);
     manager->registerResource(terminal);
     
     // check grub
     Grub::GrubChecker* grubChecker = new Grub::GrubChecker(magic, address);
     
-    /*!\todo print memory size */
-    grubChecker->getMemorySize();
+    // lower and upper memory as reported by GRUB, in kilobytes
+    Core::kprintf("Memory: %lu KB\n", grubChecker->getMemorySize());
 
+    // deferred interrupt work must be available before interrupts are enabled
+    Core::Tasklet::initialise();
+    Core::TimerWheel::initialise();
+    Core::RCU::initialise();
+    
+    // from here on we are the idle thread of the boot processor
+    Core::Scheduler::initialise();
+    Core::Idle::initialise();
+    
     Core::Architecture::detectArchitecture();
     
-    // infinite loop
-    for(;;);
+    // softirqs left over by interrupt exits
+    Core::SoftIRQ::startDaemon();
+    
+    // diagnostics logged so far reach the screen from here on
+    Core::KernelLog::startDaemon();
+    
+    // all processors are up, every one gets its workers
+    Core::WorkQueue::initialise();
+    
+    // drivers, started in parallel as far as their dependencies allow
+    manager->addResource(Core::Keyboard::getInstance());
+    manager->addResource(Core::Serial::getInstance(SERIAL_COM1));
+    
+    manager->startResources();
+    
+    // headless machines follow the log over the first serial port
+    if(Core::Serial::getInstance(SERIAL_COM1)->isPresent()) {
+        
+        Core::KernelLog::setSerialPort(Core::Serial::getInstance(SERIAL_COM1));
+    }
+    
+    // show how much the processors sleep
+    Core::Keyboard::getInstance()->registerHotkey(KEY_F1 + 9, Core::Idle::print);
+    
+    // show the kernel log again
+    Core::Keyboard::getInstance()->registerHotkey(KEY_F1 + 11, Core::KernelLog::dump);
+    
+#ifdef LOCKSTAT
+    // dump the lock statistics on demand
+    Core::Keyboard::getInstance()->registerHotkey(KEY_F1 + 10, Core::LockStat::print);
+#endif
+    
+#ifdef LATENCY_TRACE
+    // show the longest interrupts-off and preemption-off sections
+    Core::Keyboard::getInstance()->registerHotkey(KEY_F1 + 8, Core::LatencyTracer::printWorst);
+#endif
+    
+    // sleep whenever there is nothing to do
+    Core::Idle::run();
     
     return E_SUCCESS;
 }
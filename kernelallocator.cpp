@@ -43,6 +43,9 @@ inline void* operator new(unsigned int n, void* p)  throw() {
     return p;
 }
 
+// statistics for the allocator lock
+static LOCK_CLASS(allocatorLockClass, "allocator");
+
 // set instance pointer to a null pointer
 Core::KernelAllocator* Core::KernelAllocator::_instance = 0;
 
@@ -63,24 +66,39 @@ Core::KernelAllocator* Core::KernelAllocator::getInstance() {
 }
 
 unsigned long Core::KernelAllocator::allocate(unsigned long size) {
+    
+    MCSNode node;
+    
+    // interrupt handlers may allocate as well
+    unsigned long flags = this->_lock.lockIrqSave(&node);
 
 #ifdef DEBUG
     this->allocations++;
 #endif
     
-    return this->_allocator->allocate(size);
+    unsigned long address = this->_allocator->allocate(size);
+    
+    this->_lock.unlockIrqRestore(&node, flags);
+    
+    return address;
 }
 
 void Core::KernelAllocator::free(unsigned long address) {
+    
+    MCSNode node;
+    
+    unsigned long flags = this->_lock.lockIrqSave(&node);
  
 #ifdef DEBUG
     this->frees++;
 #endif
     
     this->_allocator->free(address);
+    
+    this->_lock.unlockIrqRestore(&node, flags);
 }
 
-Core::KernelAllocator::KernelAllocator() {
+Core::KernelAllocator::KernelAllocator() : _lock(&allocatorLockClass) {
     
     // dummy constructor
 }
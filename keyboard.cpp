@@ -0,0 +1,415 @@
+/***************************************************************************
+ *            keyboard.cpp
+ *
+ *  Copyright  2008  Matthias v.d. Vlies
+ *  matthias@mserver.nl
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*! \file keyboard.cpp
+ *  \brief PS/2 Keyboard Driver
+ *   
+ *  This file implements the Keyboard class.
+ *
+ */
+
+#include <core/keyboard.h>
+#include <core/console.h>
+#include <core/terminal.h>
+#include <core/softirq.h>
+#include <I386/idt.h>
+#include <config.h>
+#include <errors.h>
+
+/*! Number of entries in the scancode tables */
+#define KEYBOARD_MAP_SIZE                       0x3a
+
+/*! Scancode set 1 to ASCII, US layout */
+static const char normalMap[KEYBOARD_MAP_SIZE] = {
+    
+    0, 27, '1', '2', '3', '4', '5', '6', '7', '8', '9', '0', '-', '=', '\b', '\t',
+    'q', 'w', 'e', 'r', 't', 'y', 'u', 'i', 'o', 'p', '[', ']', '\n', 0, 'a', 's',
+    'd', 'f', 'g', 'h', 'j', 'k', 'l', ';', '\'', '`', 0, '\\', 'z', 'x', 'c', 'v',
+    'b', 'n', 'm', ',', '.', '/', 0, '*', 0, ' '
+};
+
+/*! Scancode set 1 to ASCII with shift held, US layout */
+static const char shiftMap[KEYBOARD_MAP_SIZE] = {
+    
+    0, 27, '!', '@', '#', '$', '%', '^', '&', '*', '(', ')', '_', '+', '\b', '\t',
+    'Q', 'W', 'E', 'R', 'T', 'Y', 'U', 'I', 'O', 'P', '{', '}', '\n', 0, 'A', 'S',
+    'D', 'F', 'G', 'H', 'J', 'K', 'L', ':', '"', '~', 0, '|', 'Z', 'X', 'C', 'V',
+    'B', 'N', 'M', '<', '>', '?', 0, '*', 0, ' '
+};
+
+// set instance pointer to a null pointer
+Core::Keyboard* Core::Keyboard::_instance = 0;
+
+Core::Keyboard* Core::Keyboard::getInstance() {
+    
+    // check for exsisting instance
+    if(_instance == 0) {
+        
+        // none found, create new instance
+        _instance = new Keyboard();
+        
+        // check if we got a valid address
+        if(_instance == reinterpret_cast<Keyboard*>(E_ALLOC_NOMEM)) {
+            
+            _instance = 0;
+            
+            // no, major oops here!
+            return E_FAILURE;
+        }
+    }
+    
+    // return the instance
+    return _instance;
+}
+
+Core::Keyboard::Keyboard() {
+    
+    this->_shift = false;
+    this->_control = false;
+    this->_alt = false;
+    this->_capsLock = false;
+    this->_extended = false;
+    
+    for(int n = 0; n < KEY_FUNCTION_COUNT; n++) {
+        
+        this->_hotkeys[n] = 0;
+    }
+}
+
+unsigned long Core::Keyboard::startResource() {
+    
+    // drain whatever the controller still holds
+    while(I386::readPortByte(KEYBOARD_STATUS) & 0x01) {
+        
+        I386::readPortByte(KEYBOARD_DATA);
+    }
+    
+    Core::SoftIRQ::registerHandler(SOFTIRQ_INPUT, Core::Keyboard::translate);
+    
+    I386::IDT::getInstance()->registerHandler(KEYBOARD_VECTOR, Core::Keyboard::interrupt);
+    
+    return E_SUCCESS;
+}
+
+const char* Core::Keyboard::getResourceName() {
+    
+    return "Keyboard";
+}
+
+const char* const* Core::Keyboard::getResourceDependencies() {
+    
+    // the interrupt handler goes into the IDT, typed keys echo on the console
+    static const char* const dependencies[] = { "Interrupt Descriptor Table", "Console", 0 };
+    
+    return dependencies;
+}
+
+unsigned long Core::Keyboard::getTerminalType() {
+    
+    // keyboard input belongs to the screen
+    return TERMINAL_TYPE_VIDEO;
+}
+
+unsigned long Core::Keyboard::getColumns() {
+    
+    // input only
+    return 0;
+}
+
+unsigned long Core::Keyboard::getRows() {
+    
+    return 0;
+}
+
+unsigned long Core::Keyboard::getPages() {
+    
+    return 0;
+}
+
+void Core::Keyboard::clearBuffer() {
+    
+    unsigned char scancode;
+    
+    while(this->_scancodes.pop(scancode));
+}
+
+unsigned long Core::Keyboard::write(void* buffer, unsigned long size) {
+    
+    // input only
+    return E_FAILURE;
+}
+
+unsigned long Core::Keyboard::write(void* buffer, unsigned long offset, unsigned long size) {
+    
+    // input only
+    return E_FAILURE;
+}
+
+void Core::Keyboard::present() {
+    
+    // input only
+}
+
+void Core::Keyboard::showPage(unsigned long page, unsigned long row) {
+    
+    // input only
+}
+
+void Core::Keyboard::registerHotkey(unsigned char key, HotkeyHandler handler) {
+    
+    if(key >= KEY_F1 && key < KEY_F1 + KEY_FUNCTION_COUNT) {
+        
+        this->_hotkeys[key - KEY_F1] = handler;
+    }
+}
+
+void Core::Keyboard::interrupt(struct I386::Registers* registers) {
+    
+    // reading the data port acknowledges the controller
+    unsigned char scancode = I386::readPortByte(KEYBOARD_DATA);
+    
+    // a full ring drops the key rather than waiting
+    _instance->_scancodes.push(scancode);
+    
+    Core::SoftIRQ::raise(SOFTIRQ_INPUT);
+}
+
+unsigned char Core::Keyboard::decode(unsigned char scancode) {
+    
+    // extended keys are prefixed with 0xe0
+    if(scancode == 0xe0) {
+        
+        this->_extended = true;
+        
+        return 0;
+    }
+    
+    bool extended = this->_extended;
+    bool released = (scancode & 0x80) != 0;
+    
+    this->_extended = false;
+    
+    scancode &= 0x7f;
+    
+    // the keyboard wraps gray keys in fake shift presses and releases while shift is held
+    if(extended && (scancode == 0x2a || scancode == 0x36)) {
+        
+        return 0;
+    }
+    
+    // modifiers
+    switch(scancode) {
+        
+        case 0x2a:
+        case 0x36:
+            this->_shift = !released;
+            return 0;
+            
+        case 0x1d:
+            this->_control = !released;
+            return 0;
+            
+        case 0x38:
+            this->_alt = !released;
+            return 0;
+            
+        case 0x3a:
+            if(!released) {
+                
+                this->_capsLock = !this->_capsLock;
+            }
+            return 0;
+    }
+    
+    if(released) {
+        
+        return 0;
+    }
+    
+    if(extended) {
+        
+        // page up and page down scroll through the console history
+        if(this->_shift && scancode == 0x49) {
+            
+            return KEY_SCROLL_UP;
+        }
+        
+        if(this->_shift && scancode == 0x51) {
+            
+            return KEY_SCROLL_DOWN;
+        }
+        
+        switch(scancode) {
+            
+            case 0x48:
+                return KEY_CURSOR_UP;
+                
+            case 0x50:
+                return KEY_CURSOR_DOWN;
+                
+            case 0x4d:
+                return KEY_CURSOR_RIGHT;
+                
+            case 0x4b:
+                return KEY_CURSOR_LEFT;
+        }
+        
+        return 0;
+    }
+    
+    // function keys, with alt the first ones select a virtual terminal
+    if(scancode >= 0x3b && scancode <= 0x44) {
+        
+        if(this->_alt) {
+            
+            return scancode - 0x3b < CONSOLE_TERMINALS ? KEY_TERMINAL + (scancode - 0x3b) : 0;
+        }
+        
+        return KEY_F1 + (scancode - 0x3b);
+    }
+    
+    if(scancode == 0x57 || scancode == 0x58) {
+        
+        return KEY_F1 + 10 + (scancode - 0x57);
+    }
+    
+    if(scancode >= KEYBOARD_MAP_SIZE) {
+        
+        return 0;
+    }
+    
+    char c = this->_shift ? shiftMap[scancode] : normalMap[scancode];
+    
+    // caps lock only affects letters
+    if(this->_capsLock && ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'))) {
+        
+        c ^= 0x20;
+    }
+    
+    if(this->_control && ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'))) {
+        
+        c &= 0x1f;
+    }
+    
+    return c;
+}
+
+void Core::Keyboard::translate() {
+    
+    Keyboard* keyboard = _instance;
+    
+    char buffer[64];
+    int length = 0;
+    
+    unsigned char scancode;
+    
+    while(keyboard->_scancodes.pop(scancode)) {
+        
+        unsigned char key = keyboard->decode(scancode);
+        
+        if(key == 0) {
+            
+            continue;
+        }
+        
+        if(key == KEY_SCROLL_UP || key == KEY_SCROLL_DOWN) {
+            
+            // echo what was typed before moving the view
+            if(length != 0) {
+                
+                Core::Console::getInstance()->writeBuffer(buffer, length);
+                length = 0;
+            }
+            
+            // half a screen at a time
+            int rows = Core::Console::getInstance()->getActiveTerminal()->getRows() / 2;
+            
+            Core::Console::getInstance()->scrollHistory(key == KEY_SCROLL_UP ? rows : -rows);
+            
+            continue;
+        }
+        
+        if(key >= KEY_TERMINAL) {
+            
+            // echo what was typed on the terminal it was typed on
+            if(length != 0) {
+                
+                Core::Console::getInstance()->writeBuffer(buffer, length);
+                length = 0;
+            }
+            
+            Core::Terminal* terminal = Core::Console::getInstance()->getTerminal(key - KEY_TERMINAL);
+            
+            if(terminal != 0) {
+                
+                Core::Console::getInstance()->switchTerminal(terminal);
+            }
+            
+            continue;
+        }
+        
+        if(key >= KEY_CURSOR_UP && key <= KEY_CURSOR_LEFT) {
+            
+            // keep room for the whole sequence
+            if(length > static_cast<int>(sizeof(buffer)) - 3) {
+                
+                Core::Console::getInstance()->writeBuffer(buffer, length);
+                length = 0;
+            }
+            
+            // echoed as ANSI cursor sequences, the terminal moves the cursor
+            buffer[length++] = '\033';
+            buffer[length++] = '[';
+            buffer[length++] = 'A' + (key - KEY_CURSOR_UP);
+            
+            continue;
+        }
+        
+        if(key >= KEY_F1) {
+            
+            if(key < KEY_F1 + KEY_FUNCTION_COUNT && keyboard->_hotkeys[key - KEY_F1] != 0) {
+                
+                keyboard->_hotkeys[key - KEY_F1]();
+            }
+            
+            continue;
+        }
+        
+        buffer[length++] = key;
+        
+        // echo in batches
+        if(length == sizeof(buffer)) {
+            
+            Core::Console::getInstance()->writeBuffer(buffer, length);
+            length = 0;
+        }
+    }
+    
+    if(length != 0) {
+        
+        Core::Console::getInstance()->writeBuffer(buffer, length);
+        
+        // typing should not wait for the flush timer
+        Core::Console::getInstance()->flush();
+    }
+}
@@ -0,0 +1,328 @@
+/***************************************************************************
+ *            klog.cpp
+ *
+ *  Copyright  2008  Matthias v.d. Vlies
+ *  matthias@mserver.nl
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*! \file klog.cpp
+ *  \brief Kernel log
+ *   
+ *  This file implements the KernelLog class.
+ *
+ */
+
+#include <core/klog.h>
+#include <core/cpu.h>
+#include <I386/i386.h>
+#include <errors.h>
+
+/*! Function to append text to a record, cutting it off at the end of the record
+ *
+ *\param text The text of the record
+ *\param length Current length of the text
+ *\param append The text to append
+ *\return The new length
+ */
+static unsigned int append(char* text, unsigned int length, const char* append) {
+    
+    while(length < KLOG_MESSAGE_SIZE && *append != 0) {
+        
+        text[length++] = *append++;
+    }
+    
+    return length;
+}
+
+// nothing logged at boot
+Core::RingBuffer<Core::KernelLog::Record, KLOG_RING_SIZE> Core::KernelLog::_rings[MAX_CPUS];
+volatile unsigned long Core::KernelLog::_dropped[MAX_CPUS] = { 0 };
+unsigned long Core::KernelLog::_reported[MAX_CPUS] = { 0 };
+Core::KernelLog::Record Core::KernelLog::_history[KLOG_HISTORY_SIZE];
+unsigned long Core::KernelLog::_historyCount = 0;
+Core::SpinLock Core::KernelLog::_drainLock;
+Core::WaitQueue Core::KernelLog::_waiters;
+Core::Thread* Core::KernelLog::_daemon = 0;
+Core::Timer* Core::KernelLog::_timer = 0;
+Core::Serial* Core::KernelLog::_serial = 0;
+
+void Core::KernelLog::log(unsigned int level, const char* message) {
+    
+    record(level, 0, message, 0, false);
+}
+
+void Core::KernelLog::log(unsigned int level, const char* subject, const char* message) {
+    
+    record(level, subject, message, 0, false);
+}
+
+void Core::KernelLog::log(unsigned int level, const char* subject, const char* message, unsigned long value) {
+    
+    record(level, subject, message, value, true);
+}
+
+void Core::KernelLog::logFormat(unsigned int level, const char* subject, const char* format, ...) {
+    
+    char message[KLOG_MESSAGE_SIZE + 1];
+    
+    FormatArguments arguments;
+    
+    __builtin_va_start(arguments, format);
+    
+    Format::stringList(message, sizeof(message), format, arguments);
+    
+    __builtin_va_end(arguments);
+    
+    record(level, subject, message, 0, false);
+}
+
+void Core::KernelLog::record(unsigned int level, const char* subject, const char* message, unsigned long value, bool hasValue) {
+    
+    Record record;
+    
+    record.level = level;
+    record.value = value;
+    record.hasValue = hasValue;
+    
+    unsigned int length = 0;
+    
+    if(subject != 0) {
+        
+        length = append(record.text, length, subject);
+        length = append(record.text, length, ": ");
+    }
+    
+    length = append(record.text, length, message);
+    
+    record.text[length] = 0;
+    
+    // with interrupts masked this processor is the only producer of its ring
+    unsigned long flags = I386::saveFlags();
+    
+    unsigned int cpu = Core::CPU::getCurrentId();
+    
+    record.cpu = cpu;
+    record.ticks = Core::TimerWheel::getTicks();
+    record.timestamp = I386::readTimeStampCounter();
+    
+    if(!_rings[cpu].push(record)) {
+        
+        _dropped[cpu]++;
+    }
+    
+    I386::restoreFlags(flags);
+    
+    // a wake up missed here because of store ordering is picked up by the poll timer
+    if(!_waiters.isEmpty()) {
+        
+        _waiters.wakeUp();
+    }
+}
+
+void Core::KernelLog::startDaemon() {
+    
+    Thread* thread = new Thread(Core::KernelLog::daemon, 0, "klog", THREAD_LOWEST_PRIORITY);
+    
+    if(thread->start() != E_SUCCESS) {
+        
+        return;
+    }
+    
+    _daemon = thread;
+    
+    // the timer always fires and gets re-added on this processor
+    _timer = new Timer(Core::KernelLog::poll, 0);
+    
+    Core::TimerWheel::add(_timer, KLOG_DRAIN_INTERVAL);
+}
+
+void Core::KernelLog::daemon(unsigned long data) {
+    
+    for(;;) {
+        
+        _waiters.wait(Core::KernelLog::isPending, 0);
+        
+        drain();
+    }
+}
+
+void Core::KernelLog::poll(unsigned long data) {
+    
+    if(isPending(0)) {
+        
+        _waiters.wakeUp();
+    }
+    
+    Core::TimerWheel::add(_timer, KLOG_DRAIN_INTERVAL);
+}
+
+bool Core::KernelLog::isPending(void* data) {
+    
+    for(unsigned int cpu = 0; cpu < MAX_CPUS; cpu++) {
+        
+        if(!_rings[cpu].isEmpty() || _dropped[cpu] != _reported[cpu]) {
+            
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+void Core::KernelLog::setSerialPort(Serial* port) {
+    
+    unsigned long flags = _drainLock.lockIrqSave();
+    
+    _serial = port;
+    
+    _drainLock.unlockIrqRestore(flags);
+}
+
+void Core::KernelLog::flush() {
+    
+    drain();
+}
+
+void Core::KernelLog::drain() {
+    
+    Record record;
+    
+    for(;;) {
+        
+        // one record at a time, so interrupts are never masked for long
+        unsigned long flags = _drainLock.lockIrqSave();
+        
+        RingBuffer<Record, KLOG_RING_SIZE>* oldest = 0;
+        unsigned long long timestamp = 0;
+        
+        // merge: the ring with the oldest record goes first
+        for(unsigned int cpu = 0; cpu < MAX_CPUS; cpu++) {
+            
+            Record* record = _rings[cpu].peek();
+            
+            if(record != 0 && (oldest == 0 || record->timestamp < timestamp)) {
+                
+                oldest = &_rings[cpu];
+                timestamp = record->timestamp;
+            }
+        }
+        
+        if(oldest == 0) {
+            
+            _drainLock.unlockIrqRestore(flags);
+            
+            break;
+        }
+        
+        oldest->pop(record);
+        
+        _history[_historyCount++ % KLOG_HISTORY_SIZE] = record;
+        
+        _drainLock.unlockIrqRestore(flags);
+        
+        // printing may wait for the serial line, never with the lock held
+        render(&record);
+    }
+    
+    for(unsigned int cpu = 0; cpu < MAX_CPUS; cpu++) {
+        
+        unsigned long flags = _drainLock.lockIrqSave();
+        
+        unsigned long dropped = _dropped[cpu] - _reported[cpu];
+        
+        _reported[cpu] += dropped;
+        
+        _drainLock.unlockIrqRestore(flags);
+        
+        if(dropped != 0) {
+            
+            Core::kprintf("\x1b[93mklog: cpu %u dropped %lu records\x1b[39m\n", cpu, dropped);
+        }
+    }
+}
+
+void Core::KernelLog::render(Record* record) {
+    
+    // select graphic rendition of each level, red, yellow, the terminal's color and dark gray
+    static const char* const colors[KLOG_DEBUG + 1] = { "\x1b[31m", "\x1b[93m", "", "\x1b[90m" };
+    
+    const char* color = record->level <= KLOG_DEBUG ? colors[record->level] : "";
+    
+    if(record->hasValue) {
+        
+        Core::kprintf("[%lu] %s%s\x1b[39m 0x%lx\n", record->ticks, color, record->text, record->value);
+    }
+    else {
+        
+        Core::kprintf("[%lu] %s%s\x1b[39m\n", record->ticks, color, record->text);
+    }
+    
+    // the serial line has no colors
+    if(_serial != 0) {
+        
+        char line[FORMAT_BUFFER_SIZE];
+        unsigned long length;
+        
+        if(record->hasValue) {
+            
+            length = Format::string(line, sizeof(line), "[%lu] %s 0x%lx\n", record->ticks, record->text, record->value);
+        }
+        else {
+            
+            length = Format::string(line, sizeof(line), "[%lu] %s\n", record->ticks, record->text);
+        }
+        
+        _serial->send(line, length);
+    }
+}
+
+void Core::KernelLog::dump() {
+    
+    Record record;
+    
+    unsigned long flags = _drainLock.lockIrqSave();
+    
+    unsigned long n = (_historyCount > KLOG_HISTORY_SIZE) ? _historyCount - KLOG_HISTORY_SIZE : 0;
+    
+    _drainLock.unlockIrqRestore(flags);
+    
+    for(;; n++) {
+        
+        flags = _drainLock.lockIrqSave();
+        
+        // the drain thread adds to the history meanwhile, skip what it overwrote
+        if(_historyCount > KLOG_HISTORY_SIZE && n < _historyCount - KLOG_HISTORY_SIZE) {
+            
+            n = _historyCount - KLOG_HISTORY_SIZE;
+        }
+        
+        if(n >= _historyCount) {
+            
+            _drainLock.unlockIrqRestore(flags);
+            
+            break;
+        }
+        
+        record = _history[n % KLOG_HISTORY_SIZE];
+        
+        _drainLock.unlockIrqRestore(flags);
+        
+        render(&record);
+    }
+}
@@ -0,0 +1,204 @@
+/***************************************************************************
+ *            latencytracer.cpp
+ *
+ *  Copyright  2008  Matthias v.d. Vlies
+ *  matthias@mserver.nl
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*! \file latencytracer.cpp
+ *  \brief Interrupts-off and preemption-off latency tracer
+ *   
+ *  This file implements the LatencyTracer class and the C hooks used by i386.h and loader.asm.
+ *
+ */
+
+#include <core/latencytracer.h>
+#include <core/console.h>
+#include <core/format.h>
+#include <core/cpu.h>
+#include <I386/i386.h>
+
+#ifdef LATENCY_TRACE
+
+// no open sections
+unsigned long long Core::LatencyTracer::_started[2][MAX_CPUS];
+void* Core::LatencyTracer::_site[2][MAX_CPUS] = { { 0 } };
+
+// nothing recorded yet
+Core::LatencyRecord Core::LatencyTracer::_worst[2][LATENCY_TRACE_ENTRIES];
+
+/*! Function to mask interrupts without going through the traced I386 helpers
+ *
+ *\return The EFLAGS before masking
+ */
+static inline unsigned long untracedSaveFlags() {
+    
+    unsigned long flags;
+    
+    __asm__ __volatile__ ("pushfl; popl %0; cli" : "=r" (flags) : : "memory");
+    
+    return flags;
+}
+
+/*! Function to restore EFLAGS without going through the traced I386 helpers
+ *
+ *\param flags The EFLAGS returned by untracedSaveFlags()
+ */
+static inline void untracedRestoreFlags(unsigned long flags) {
+    
+    __asm__ __volatile__ ("pushl %0; popfl" : : "r" (flags) : "memory", "cc");
+}
+
+// the return address of the hooks is the code that toggled the interrupt flag
+extern "C" void _trace_irqs_off() {
+    
+    Core::LatencyTracer::irqsOff(__builtin_return_address(0));
+}
+
+extern "C" void _trace_irqs_on() {
+    
+    Core::LatencyTracer::irqsOn(__builtin_return_address(0));
+}
+
+void Core::LatencyTracer::irqsOff(void* site) {
+    
+    begin(LATENCY_IRQS_OFF, site);
+}
+
+void Core::LatencyTracer::irqsOn(void* site) {
+    
+    finish(LATENCY_IRQS_OFF, site);
+}
+
+void Core::LatencyTracer::preemptOff() {
+    
+    unsigned long flags = untracedSaveFlags();
+    
+    begin(LATENCY_PREEMPT_OFF, __builtin_return_address(0));
+    
+    untracedRestoreFlags(flags);
+}
+
+void Core::LatencyTracer::preemptOn() {
+    
+    unsigned long flags = untracedSaveFlags();
+    
+    finish(LATENCY_PREEMPT_OFF, __builtin_return_address(0));
+    
+    untracedRestoreFlags(flags);
+}
+
+void Core::LatencyTracer::begin(int kind, void* site) {
+    
+    unsigned int cpu = Core::CPU::getCurrentId();
+    
+    // nested disable, the outermost one counts
+    if(_site[kind][cpu] != 0) {
+        
+        return;
+    }
+    
+    _site[kind][cpu] = site;
+    _started[kind][cpu] = I386::readTimeStampCounter();
+}
+
+void Core::LatencyTracer::finish(int kind, void* site) {
+    
+    unsigned int cpu = Core::CPU::getCurrentId();
+    
+    // enable without a traced disable (e.g. the first sti after boot)
+    if(_site[kind][cpu] == 0) {
+        
+        return;
+    }
+    
+    unsigned long long cycles = I386::readTimeStampCounter() - _started[kind][cpu];
+    
+    LatencyRecord* worst = _worst[kind];
+    
+    // only keep it if it beats the shortest recorded section
+    if(cycles > worst[LATENCY_TRACE_ENTRIES - 1].cycles) {
+        
+        int n = LATENCY_TRACE_ENTRIES - 1;
+        
+        // insertion sort, longest first
+        for(; n > 0 && worst[n - 1].cycles < cycles; n--) {
+            
+            worst[n] = worst[n - 1];
+        }
+        
+        worst[n].cycles = cycles;
+        worst[n].start = _site[kind][cpu];
+        worst[n].end = site;
+        worst[n].cpu = cpu;
+    }
+    
+    _site[kind][cpu] = 0;
+}
+
+void Core::LatencyTracer::reset() {
+    
+    unsigned long flags = untracedSaveFlags();
+    
+    for(int kind = 0; kind < 2; kind++) {
+        
+        for(int n = 0; n < LATENCY_TRACE_ENTRIES; n++) {
+            
+            _worst[kind][n].cycles = 0;
+            _worst[kind][n].start = 0;
+            _worst[kind][n].end = 0;
+            _worst[kind][n].cpu = 0;
+        }
+    }
+    
+    untracedRestoreFlags(flags);
+}
+
+void Core::LatencyTracer::print(int kind) {
+    
+    // copy the records first, printing disables interrupts itself
+    unsigned long flags = untracedSaveFlags();
+    
+    LatencyRecord worst[LATENCY_TRACE_ENTRIES];
+    
+    for(int n = 0; n < LATENCY_TRACE_ENTRIES; n++) {
+        
+        worst[n] = _worst[kind][n];
+    }
+    
+    untracedRestoreFlags(flags);
+    
+    for(int n = 0; n < LATENCY_TRACE_ENTRIES && worst[n].cycles != 0; n++) {
+        
+        Core::kprintf("  %llu cycles, cpu %u: %p -> %p\n", worst[n].cycles, worst[n].cpu, worst[n].start, worst[n].end);
+    }
+}
+
+void Core::LatencyTracer::printWorst() {
+    
+    Core::Console* console = Core::Console::getInstance();
+    
+    console->write("Longest interrupts-off sections:\n");
+    print(LATENCY_IRQS_OFF);
+    
+    console->write("Longest preemption-off sections:\n");
+    print(LATENCY_PREEMPT_OFF);
+}
+
+#endif
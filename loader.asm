@@ -26,6 +26,33 @@
 ; perhaps setting up the GDT and segments. Please note that interrupts
 ; are disabled at this point
 [BITS 32]
+
+; Latency tracer hooks, assemble with -dLATENCY_TRACE to enable. The
+; trace functions follow the C calling convention and clobber eax, ecx
+; and edx, so they are only called where those are saved or unused.
+%ifdef LATENCY_TRACE
+extern _trace_irqs_off
+extern _trace_irqs_on
+%endif
+
+; Record the start of an interrupts-off section
+%macro TRACE_IRQS_OFF 0
+%ifdef LATENCY_TRACE
+    call _trace_irqs_off
+%endif
+%endmacro
+
+; Record the end of an interrupts-off section when the interrupted code
+; runs with interrupts enabled. Expects esp to point at the saved gs.
+%macro TRACE_IRQS_RETURN 0
+%ifdef LATENCY_TRACE
+    test dword [esp+64], 0x200
+    jz %%keep
+    call _trace_irqs_on
+%%keep:
+%endif
+%endmacro
+
 global start
 start:
     mov esp, _sys_stack     ; This points the stack to our new stack area
@@ -37,9 +64,17 @@ mboot:
     ; Multiboot macros to make a few lines later more readable
     MULTIBOOT_PAGE_ALIGN	equ 1<<0
     MULTIBOOT_MEMORY_INFO	equ 1<<1
+    MULTIBOOT_VIDEO_MODE	equ 1<<2
     MULTIBOOT_AOUT_KLUDGE	equ 1<<16
     MULTIBOOT_HEADER_MAGIC	equ 0x1BADB002
+
+    ; A linear framebuffer is requested only when assembled with
+    ; -dFRAMEBUFFER, GRUB legacy refuses to load kernels asking for one
+%ifdef FRAMEBUFFER
+    MULTIBOOT_HEADER_FLAGS	equ MULTIBOOT_PAGE_ALIGN | MULTIBOOT_MEMORY_INFO | MULTIBOOT_VIDEO_MODE | MULTIBOOT_AOUT_KLUDGE
+%else
     MULTIBOOT_HEADER_FLAGS	equ MULTIBOOT_PAGE_ALIGN | MULTIBOOT_MEMORY_INFO | MULTIBOOT_AOUT_KLUDGE
+%endif
     MULTIBOOT_CHECKSUM	equ -(MULTIBOOT_HEADER_MAGIC + MULTIBOOT_HEADER_FLAGS)
     EXTERN code, bss, end
 
@@ -56,19 +91,57 @@ mboot:
     dd end
     dd start
 
+    ; Preferred video mode: linear, 1024x768 at 32 bits per pixel. The
+    ; boot loader may pick another one, the kernel reads what it got
+    dd 0
+    dd 1024
+    dd 768
+    dd 32
+
 ; This is an endless loop here. Just call kernel()
 stublet:
     extern kernel
     extern __cxa_finalize
+    extern _percpu_areas
     
     ; make sure we said pic to stfu
     cli
     
+    ; give the boot processor its per-CPU area before any C++ code runs,
+    ; the base of the GS descriptor is only known at link time
+    mov ecx, _percpu_areas
+    mov [boot_gdt + 0x20 + 2], cx
+    shr ecx, 16
+    mov [boot_gdt + 0x20 + 4], cl
+    mov [boot_gdt + 0x20 + 7], ch
+    lgdt [boot_gdt_pointer]
+    mov cx, 0x20
+    mov gs, cx
+    
     push ebx						; push the multiboot info structure
     push eax						; push the magic number
+    TRACE_IRQS_OFF					; eax is saved on the stack now
     call kernel
     call __cxa_finalize
-    jmp $
+
+    ; kernel() never returns, should it ever, sleep for good
+.halt:
+    cli
+    hlt
+    jmp .halt
+
+; Table used until I386::GDT builds the real one. Its layout matches
+; the selectors in gdt.h, the task state segment is left empty.
+ALIGN 8
+boot_gdt:
+    dq 0x0000000000000000           ; null descriptor
+    dq 0x00cf9a000000ffff           ; flat ring0 code
+    dq 0x00cf92000000ffff           ; flat ring0 data
+    dq 0x0000000000000000           ; task state segment
+    dq 0x004092000000ffff           ; per-CPU area, base filled in above
+boot_gdt_pointer:
+    dw boot_gdt_pointer - boot_gdt - 1
+    dd boot_gdt
     
 ; This will set up our new segment registers. We need to do
 ; something special in order to set CS. We do what is called a
@@ -107,13 +180,95 @@ _idt_load:
 ;    lidt [_idtp]
     ret
 
-global _switch_to
-_switch_to:
+; Software context switch between two kernel threads. Only the callee
+; saved registers and EFLAGS need saving, the C caller takes care of
+; the rest. This is declared in C as
+; 'extern void _context_switch(unsigned long* oldStack, unsigned long newStack);'
+global _context_switch
+_context_switch:
+        mov     eax, [esp+4]            ; where to store the old stack pointer
+        mov     edx, [esp+8]            ; the stack pointer to switch to
         push    ebp
-        mov     ebp, esp
-        call far [ss:ebp+4]
+        push    ebx
+        push    esi
+        push    edi
+        pushfd
+        mov     [eax], esp
+        mov     esp, edx
+        popfd
+        pop     edi
+        pop     esi
+        pop     ebx
         pop     ebp
         ret
+
+; Real-mode start-up code for the application processors. It gets copied
+; to TRAMPOLINE_BASE and entered through a start-up IPI with CS set to
+; TRAMPOLINE_BASE >> 4, so all addresses are computed relative to that
+; copy. It switches to protected mode with a flat GDT, points GS at the
+; per-CPU area of the processor, loads the stack and calls the entry
+; point with the processor number as argument. The parameters at the
+; end are filled in before every start-up.
+TRAMPOLINE_BASE equ 0x7000              ; must match SMP_TRAMPOLINE_BASE in smp.h
+%define TRAMPOLINE(label) (TRAMPOLINE_BASE + (label - _trampoline_start))
+
+[BITS 16]
+global _trampoline_start
+_trampoline_start:
+        cli
+        cld
+        xor     ax, ax
+        mov     ds, ax
+        lgdt    [TRAMPOLINE(trampoline_gdt_pointer)]
+        mov     eax, cr0
+        or      eax, 1                  ; protection enable
+        mov     cr0, eax
+        jmp     dword 0x08:TRAMPOLINE(trampoline_protected)
+
+[BITS 32]
+trampoline_protected:
+        mov     ax, 0x10
+        mov     ds, ax
+        mov     es, ax
+        mov     fs, ax
+        mov     ss, ax
+        mov     eax, [TRAMPOLINE(_trampoline_percpu)]
+        mov     [TRAMPOLINE(trampoline_gdt) + 0x20 + 2], ax
+        shr     eax, 16
+        mov     [TRAMPOLINE(trampoline_gdt) + 0x20 + 4], al
+        mov     [TRAMPOLINE(trampoline_gdt) + 0x20 + 7], ah
+        mov     ax, 0x20
+        mov     gs, ax
+        mov     esp, [TRAMPOLINE(_trampoline_stack)]
+        push    dword [TRAMPOLINE(_trampoline_cpu)]
+        call    [TRAMPOLINE(_trampoline_entry)]
+        jmp     $                       ; the entry point never returns
+
+ALIGN 8
+trampoline_gdt:
+        dq      0x0000000000000000      ; null descriptor
+        dq      0x00cf9a000000ffff      ; flat ring0 code
+        dq      0x00cf92000000ffff      ; flat ring0 data
+        dq      0x0000000000000000      ; task state segment, unused
+        dq      0x004092000000ffff      ; per-CPU area, base filled in above
+trampoline_gdt_pointer:
+        dw      trampoline_gdt_pointer - trampoline_gdt - 1
+        dd      TRAMPOLINE(trampoline_gdt)
+
+global _trampoline_stack
+_trampoline_stack:
+        dd      0                       ; top of the boot stack
+global _trampoline_entry
+_trampoline_entry:
+        dd      0                       ; C entry point
+global _trampoline_cpu
+_trampoline_cpu:
+        dd      0                       ; kernel processor number
+global _trampoline_percpu
+_trampoline_percpu:
+        dd      0                       ; per-CPU area of the processor
+global _trampoline_end
+_trampoline_end:
     
 ; In just a few pages in this tutorial, we will add our Interrupt
 ; Service Routines (ISRs) right here!
@@ -372,7 +527,7 @@ _isr31:
 
 ; We call a C function in here. We need to let the assembler know
 ; that '_fault_handler' exists in another file
-;extern _fault_handler
+extern _fault_handler
 
 ; This is our common ISR stub. It saves the processor state, sets
 ; up for kernel mode segments, calls the C-level fault handler,
@@ -387,12 +542,13 @@ isr_common_stub:
     mov ds, ax
     mov es, ax
     mov fs, ax
-    mov gs, ax
+    TRACE_IRQS_OFF
     mov eax, esp
     push eax
-;    mov eax, _fault_handler
+    mov eax, _fault_handler
     call eax
     pop eax
+    TRACE_IRQS_RETURN
     pop gs
     pop fs
     pop es
@@ -402,9 +558,8 @@ isr_common_stub:
     sti
     iret
     
-;extern _page_fault_handler
-    
-; default stub for page faults
+; default stub for page faults, the C-level fault handler
+; dispatches on the interrupt number
 page_fault_stub:
     pusha
     push ds
@@ -415,12 +570,13 @@ page_fault_stub:
     mov ds, ax
     mov es, ax
     mov fs, ax
-    mov gs, ax
+    TRACE_IRQS_OFF
     mov eax, esp
     push eax
-;    mov eax, _page_fault_handler
+    mov eax, _fault_handler
     call eax
     pop eax
+    TRACE_IRQS_RETURN
     pop gs
     pop fs
     pop es
@@ -447,7 +603,7 @@ global _irq13
 global _irq14
 global _irq15
 
-;extern _irq_handler
+extern _irq_handler
 ;extern _schedule
 
 ;_irq0:
@@ -635,6 +791,30 @@ _irq15:
     push byte 47
     jmp irq_common_stub
 
+; Local APIC interrupts. The vectors do not fit a signed byte, so these
+; push a full dword.
+global _irq_apic_timer
+global _irq_reschedule
+global _irq_spurious
+
+; 240: APIC timer of the application processors
+_irq_apic_timer:
+    cli
+    push byte 0
+    push dword 240
+    jmp irq_common_stub
+
+; 241: Reschedule inter-processor interrupt
+_irq_reschedule:
+    cli
+    push byte 0
+    push dword 241
+    jmp irq_common_stub
+
+; 255: Spurious APIC interrupt, must not be acknowledged
+_irq_spurious:
+    iret
+
 irq_common_stub:
     pusha
     push ds
@@ -646,13 +826,14 @@ irq_common_stub:
     mov ds, ax
     mov es, ax
     mov fs, ax
-    mov gs, ax
+    TRACE_IRQS_OFF
     mov eax, esp
 
     push eax
-;    mov eax, _irq_handler
+    mov eax, _irq_handler
     call eax
     pop eax
+    TRACE_IRQS_RETURN
 
     pop gs
     pop fs
@@ -676,6 +857,20 @@ _write_cr0:
 	pop ebp
 	retn
 
+[global _read_cr4]
+_read_cr4:
+	mov eax, cr4
+	retn
+
+[global _write_cr4]
+_write_cr4:
+	push ebp
+	mov ebp, esp
+	mov eax, [ebp+8]
+	mov cr4, eax
+	pop ebp
+	retn
+
 [global _read_cr3]
 _read_cr3:
 	mov eax, cr3
@@ -0,0 +1,106 @@
+/***************************************************************************
+ *            mutex.cpp
+ *
+ *  Copyright  2008  Matthias v.d. Vlies
+ *  matthias@mserver.nl
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*! \file mutex.cpp
+ *  \brief Sleeping locks
+ *   
+ *  This file implements the Mutex class.
+ *
+ */
+
+#include <core/mutex.h>
+#include <core/scheduler.h>
+#include <I386/i386.h>
+
+Core::Mutex::Mutex() : _owner(0) {
+    
+}
+
+void Core::Mutex::lock() {
+    
+    if(this->tryLock() || this->spin()) {
+        
+        return;
+    }
+    
+    // all waiters are exclusive, an unlock wakes exactly one of them
+    this->_waiters.wait(Core::Mutex::acquire, this, true);
+}
+
+bool Core::Mutex::tryLock() {
+    
+    unsigned long self = reinterpret_cast<unsigned long>(Core::Scheduler::getCurrent());
+    
+    return I386::compareExchange(&this->_owner, 0, self) == 0;
+}
+
+void Core::Mutex::unlock() {
+    
+    // the exchange orders the release before the look at the queue, a waiter queues itself
+    // before its last try, so either it sees the free mutex or we see it
+    I386::atomicExchange(&this->_owner, 0);
+    
+    if(!this->_waiters.isEmpty()) {
+        
+        this->_waiters.wakeUp();
+    }
+}
+
+bool Core::Mutex::isLocked() {
+    
+    return this->_owner != 0;
+}
+
+bool Core::Mutex::spin() {
+    
+    for(unsigned int n = 0; n < MUTEX_SPIN_LIMIT; n++) {
+        
+        // threads are never freed, the owner stays safe to look at after it unlocked
+        Thread* owner = reinterpret_cast<Thread*>(this->_owner);
+        
+        if(owner == 0) {
+            
+            if(this->tryLock()) {
+                
+                return true;
+            }
+            
+            continue;
+        }
+        
+        // we are running, so a running owner is on another processor
+        if(owner->getState() != THREAD_RUNNING) {
+            
+            return false;
+        }
+        
+        I386::cpuRelax();
+    }
+    
+    return false;
+}
+
+bool Core::Mutex::acquire(void* data) {
+    
+    return reinterpret_cast<Mutex*>(data)->tryLock();
+}
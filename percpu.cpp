@@ -0,0 +1,47 @@
+/***************************************************************************
+ *            percpu.cpp
+ *
+ *  Copyright  2008  Matthias v.d. Vlies
+ *  matthias@mserver.nl
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*! \file percpu.cpp
+ *  \brief Per-CPU data
+ *   
+ *  This file implements the PerCPU class.
+ *
+ */
+
+#include <core/percpu.h>
+
+// zeroed, which is what the boot processor needs before it is initialised
+Core::PerCPUArea _percpu_areas[MAX_CPUS];
+
+void Core::PerCPU::initialise(unsigned int cpu) {
+    
+    PerCPUArea* area = &_percpu_areas[cpu];
+    
+    area->self = area;
+    area->cpu = cpu;
+}
+
+Core::PerCPUArea* Core::PerCPU::getArea(unsigned int cpu) {
+    
+    return &_percpu_areas[cpu];
+}
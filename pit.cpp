@@ -0,0 +1,104 @@
+/***************************************************************************
+ *            pit.cpp
+ *
+ *  Copyright  2008  Matthias v.d. Vlies
+ *  matthias@mserver.nl
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*! \file pit.cpp
+ *  \brief PIT driver
+ *   
+ * This file implements the PIT class.
+ *
+ */
+
+#include <I386/pit.h>
+#include <I386/idt.h>
+#include <core/timer.h>
+#include <core/scheduler.h>
+#include <config.h>
+#include <errors.h>
+
+// set instance pointer to a null pointer
+I386::PIT* I386::PIT::_instance = 0;
+
+I386::PIT* I386::PIT::getInstance() {
+    
+    // check for exsisting instance
+    if(_instance == 0) {
+        
+        // none found, create new instance
+        _instance = new PIT();
+        
+        // check if we got a valid address
+        if(_instance == reinterpret_cast<PIT*>(E_ALLOC_NOMEM)) {
+            
+            _instance = 0;
+            
+            // no, major oops here!
+            return E_FAILURE;
+        }
+        
+        // auto register
+        Core::ResourceManager::getInstance()->registerResource(_instance);
+    }
+    
+    // return the instance
+    return _instance;
+}
+
+I386::PIT::PIT() {
+    
+    // do nothing
+}
+
+unsigned long I386::PIT::startResource() {
+    
+    unsigned long divisor = PIT_CLOCK / TIMER_FREQUENCY;
+    
+    // channel 0, low/high byte, rate generator
+    I386::writePortByte(PIT_COMMAND, 0x34);
+    I386::writePortByte(PIT_CHANNEL0, divisor & 0xff);
+    I386::writePortByte(PIT_CHANNEL0, (divisor >> 8) & 0xff);
+    
+    I386::IDT::getInstance()->registerHandler(PIT_VECTOR, I386::PIT::interrupt);
+    
+    return E_SUCCESS;
+}
+
+const char* I386::PIT::getResourceName() {
+    
+    return "Programmable Interval Timer";
+}
+
+void I386::PIT::delay(unsigned long ticks) {
+    
+    unsigned long target = Core::TimerWheel::getTicks() + ticks;
+    
+    while(static_cast<long>(Core::TimerWheel::getTicks() - target) < 0) {
+        
+        I386::cpuRelax();
+    }
+}
+
+void I386::PIT::interrupt(struct Registers* registers) {
+    
+    Core::TimerWheel::tick();
+    Core::Scheduler::tick();
+}
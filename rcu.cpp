@@ -0,0 +1,190 @@
+/***************************************************************************
+ *            rcu.cpp
+ *
+ *  Copyright  2008  Matthias v.d. Vlies
+ *  matthias@mserver.nl
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*! \file rcu.cpp
+ *  \brief Read-copy-update
+ *   
+ *  This file implements the RCU class.
+ *
+ */
+
+#include <core/rcu.h>
+#include <core/softirq.h>
+#include <core/completion.h>
+#include <I386/i386.h>
+
+/*! \struct RCUWaiter
+ *\brief RCUWaiter
+ *
+ * This struct describes a thread waiting in RCU::synchronize
+ */
+struct RCUWaiter {
+    
+    /*! The callback, must come first */
+    Core::RCUHead head;
+    
+    /*! Signalled when the grace period ended */
+    Core::Completion done;
+};
+
+/*! Function to end the wait of a thread in RCU::synchronize
+ *
+ *\param head The head of the waiter
+ */
+static void wakeWaiter(Core::RCUHead* head) {
+    
+    reinterpret_cast<RCUWaiter*>(head)->done.complete();
+}
+
+// no grace periods yet
+Core::RCU::CPUData Core::RCU::_cpus[MAX_CPUS];
+unsigned long Core::RCU::_snapshot[MAX_CPUS] = { 0 };
+volatile unsigned long Core::RCU::_current = 0;
+volatile unsigned long Core::RCU::_completed = 0;
+unsigned long Core::RCU::_requested = 0;
+Core::SpinLock Core::RCU::_lock;
+
+void Core::RCU::initialise() {
+    
+    Core::SoftIRQ::registerHandler(SOFTIRQ_RCU, Core::RCU::run);
+}
+
+void Core::RCU::call(RCUHead* head, RCUCallback function) {
+    
+    unsigned long flags = I386::saveFlags();
+    
+    CPUData* data = &_cpus[Core::CPU::getCurrentId()];
+    
+    head->function = function;
+    head->next = data->pending;
+    
+    data->pending = head;
+    
+    I386::restoreFlags(flags);
+}
+
+void Core::RCU::synchronize() {
+    
+    RCUWaiter waiter;
+    
+    call(&waiter.head, wakeWaiter);
+    
+    // sleeping passes through the scheduler, which is a quiescent state of this processor too
+    waiter.done.wait();
+}
+
+void Core::RCU::tick(bool quiescent) {
+    
+    CPUData* data = &_cpus[Core::CPU::getCurrentId()];
+    
+    if(quiescent) {
+        
+        data->quiescent++;
+    }
+    
+    // our own callbacks, or a grace period other processors wait for
+    if(data->pending != 0 || data->batch != 0 || _current != _completed) {
+        
+        Core::SoftIRQ::raise(SOFTIRQ_RCU);
+    }
+}
+
+void Core::RCU::startGrace() {
+    
+    // one at a time, and only when somebody waits for it
+    if(_current != _completed || static_cast<long>(_requested - _completed) <= 0) {
+        
+        return;
+    }
+    
+    for(int n = 0; n < MAX_CPUS; n++) {
+        
+        _snapshot[n] = _cpus[n].quiescent;
+    }
+    
+    _current = _completed + 1;
+}
+
+bool Core::RCU::isGraceOver() {
+    
+    for(unsigned int n = 0; n < MAX_CPUS; n++) {
+        
+        if(Core::CPU::isOnline(n) && _cpus[n].quiescent == _snapshot[n]) {
+            
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+void Core::RCU::run() {
+    
+    RCUHead* done = 0;
+    
+    unsigned long flags = _lock.lockIrqSave();
+    
+    CPUData* data = &_cpus[Core::CPU::getCurrentId()];
+    
+    // finish the running grace period and start the next one
+    if(_current != _completed && isGraceOver()) {
+        
+        _completed = _current;
+    }
+    
+    startGrace();
+    
+    // our batch survived its grace period
+    if(data->batch != 0 && static_cast<long>(_completed - data->batchGrace) >= 0) {
+        
+        done = data->batch;
+        data->batch = 0;
+    }
+    
+    // close the next batch, readers may still be in a grace period that already started
+    if(data->batch == 0 && data->pending != 0) {
+        
+        data->batch = data->pending;
+        data->batchGrace = _current + 1;
+        data->pending = 0;
+        
+        if(static_cast<long>(data->batchGrace - _requested) > 0) {
+            
+            _requested = data->batchGrace;
+        }
+        
+        startGrace();
+    }
+    
+    _lock.unlockIrqRestore(flags);
+    
+    // callbacks free memory and may take locks of their own
+    while(done != 0) {
+        
+        RCUHead* next = done->next;
+        
+        done->function(done);
+        
+        done = next;
+    }
+}
@@ -30,57 +30,528 @@
 
 #include <core/resource.h>
 #include <core/console.h>
+#include <core/format.h>
+#include <core/klog.h>
+#include <core/cpu.h>
+#include <I386/i386.h>
 #include <errors.h>
 
-Core::ResourceManager::ResourceManager() {
+// statistics for the resource table lock
+static LOCK_CLASS(resourceLockClass, "resources");
+
+const char* const* Core::Resource::getResourceDependencies() {
+    
+    // most resources only need what was started before them
+    return 0;
+}
+
+Core::ResourceManager::ResourceNode::ResourceNode(Resource* resource) : work(Core::ResourceManager::startNode, reinterpret_cast<unsigned long>(this)) {
+    
+    this->resource = resource;
+    this->waiting = 0;
+    this->blocked = false;
+    this->started = false;
+    this->unresolved = 0;
+    this->resolved = false;
+    this->next = 0;
+    this->nextReady = 0;
+}
+
+Core::ResourceManager::ResourceManager() : _lock(&resourceLockClass) {
     
     Core::Console* console = Core::Console::getInstance();
     
-    /*! \todo: implement me */
+    this->_table = 0;
+    this->_added = 0;
+    this->_batch = 0;
+    this->_remaining = 0;
+    this->_failed = false;
+    this->_nextCpu = 0;
     
     console->write("Initialised resource manager\n");
 }
 
 unsigned long Core::ResourceManager::registerResource(Resource* resource) {
     
+    return this->start(resource, true);
+}
+
+unsigned long Core::ResourceManager::start(Resource* resource, bool verbose) {
+    
     Core::Console* console = Core::Console::getInstance();
     
-    console->write("Registering resource: ");
-    console->write(resource->getResourceName());
-    console->write("...");
+    // a resource hanging in its start shows up on the screen
+    if(verbose) {
+        
+        console->write("Registering resource: ");
+        console->write(resource->getResourceName());
+        console->write("...");
+    }
+    
+    unsigned long long started = I386::readTimeStampCounter();
     
     unsigned long status = resource->startResource();
     
+    unsigned long long cycles = I386::readTimeStampCounter() - started;
+    
+    if(status == E_SUCCESS) {
+        
+        // starting may take long and register other resources, only lock the table
+        this->_lock.lock();
+        
+        this->publish(resource);
+        
+        this->_lock.unlock();
+    }
+    
+    if(verbose) {
+        
+        this->report(status, cycles);
+    }
+    else {
+        
+        // other resources finish at the same time, the log keeps their lines apart
+        switch(status) {
+            
+            case E_SUCCESS:
+                Core::KernelLog::log(KLOG_INFO, resource->getResourceName(), "OK, cycles", cycles);
+                break;
+                
+            case E_WARNING:
+                Core::KernelLog::log(KLOG_WARNING, resource->getResourceName(), "WARNING, cycles", cycles);
+                break;
+                
+            case E_PANIC:
+                Core::KernelLog::log(KLOG_ERROR, resource->getResourceName(), "PANIC, cycles", cycles);
+                
+                panic();
+                
+            default:
+                Core::KernelLog::log(KLOG_ERROR, resource->getResourceName(), "FAILED, cycles", cycles);
+                break;
+        }
+    }
+    
+    return status;
+}
+
+void Core::ResourceManager::report(unsigned long status, unsigned long long cycles) {
+    
+    Core::Console* console = Core::Console::getInstance();
+    
     switch(status) {
         
         case E_SUCCESS:
-            console->write("OK\n", MAKE_COLOR(TERMINAL_BLACK, TERMINAL_GREEN, FALSE));
-            
-            /*! \todo register resource */
+            console->write("OK", MAKE_COLOR(TERMINAL_BLACK, TERMINAL_GREEN, FALSE));
             break;
             
         case E_FAILURE:
-            console->write("FAILED\n", MAKE_COLOR(TERMINAL_BLACK, TERMINAL_RED, FALSE));
+            console->write("FAILED", MAKE_COLOR(TERMINAL_BLACK, TERMINAL_RED, FALSE));
             break;
             
         case E_PANIC:
-            console->write("PANIC\n", MAKE_COLOR(TERMINAL_BLACK, TERMINAL_RED, FALSE));
-            
-            /*! \todo clean panic handling */
-            asm("hlt");
+            console->write("PANIC", MAKE_COLOR(TERMINAL_BLACK, TERMINAL_RED, FALSE));
             break;
         
         case E_WARNING:
-            console->write("WARNING\n", MAKE_COLOR(TERMINAL_BLACK, TERMINAL_YELLOW, FALSE));
+            console->write("WARNING", MAKE_COLOR(TERMINAL_BLACK, TERMINAL_YELLOW, FALSE));
             break;
             
         default:
-            console->write("UNKNOWN\n", MAKE_COLOR(TERMINAL_BLACK, TERMINAL_YELLOW, FALSE));
+            console->write("UNKNOWN", MAKE_COLOR(TERMINAL_BLACK, TERMINAL_YELLOW, FALSE));
             break;
             
     }
     
-    return status;
+    Core::kprintf(" (%llu cycles)\n", cycles);
+    
+    if(status == E_PANIC) {
+        
+        panic();
+    }
+}
+
+void Core::ResourceManager::panic() {
+    
+    // nobody gets to drain the log after this
+    Core::KernelLog::flush();
+    
+    // interrupts are enabled while resources start, a bare HLT would return on the next tick
+    I386::halt();
+}
+
+unsigned long Core::ResourceManager::addResource(Resource* resource) {
+    
+    ResourceNode* node = new ResourceNode(resource);
+    
+    // check if we got a valid address
+    if(node == reinterpret_cast<ResourceNode*>(E_ALLOC_NOMEM)) {
+        
+        return E_ALLOC_NOMEM;
+    }
+    
+    unsigned long flags = this->_lock.lockIrqSave();
+    
+    // keep the order they were added in, it decides who goes first among equals
+    ResourceNode** last = &this->_added;
+    
+    while(*last != 0) {
+        
+        last = &(*last)->next;
+    }
+    
+    *last = node;
+    
+    this->_lock.unlockIrqRestore(flags);
+    
+    return E_SUCCESS;
+}
+
+unsigned long Core::ResourceManager::startResources() {
+    
+    ResourceNode* ready = 0;
+    
+    unsigned long flags = this->_lock.lockIrqSave();
+    
+    ResourceNode* batch = this->_added;
+    
+    this->_added = 0;
+    this->_batch = batch;
+    this->_remaining = 0;
+    this->_failed = false;
+    
+    // build the graph, an edge for every dependency inside the batch
+    for(ResourceNode* node = batch; node != 0; node = node->next) {
+        
+        this->_remaining++;
+        
+        const char* const* dependencies = node->resource->getResourceDependencies();
+        
+        for(int n = 0; dependencies != 0 && dependencies[n] != 0; n++) {
+            
+            bool found = false;
+            
+            for(ResourceNode* other = batch; other != 0 && !found; other = other->next) {
+                
+                found = isSameName(other->resource->getResourceName(), dependencies[n]);
+            }
+            
+            // neither in the batch nor started before
+            if(!found && this->findResource(dependencies[n]) == 0) {
+                
+                node->blocked = true;
+            }
+        }
+        
+        for(ResourceNode* other = batch; other != 0; other = other->next) {
+            
+            if(dependsOn(node->resource, other->resource->getResourceName())) {
+                
+                node->waiting++;
+            }
+        }
+    }
+    
+    // resources in a cycle would wait forever, fail them right away
+    ready = this->findCycles();
+    
+    for(ResourceNode* node = batch; node != 0; node = node->next) {
+        
+        if(!node->started && node->waiting == 0) {
+            
+            node->started = true;
+            node->nextReady = ready;
+            
+            ready = node;
+        }
+    }
+    
+    this->_lock.unlockIrqRestore(flags);
+    
+    if(batch == 0) {
+        
+        return E_SUCCESS;
+    }
+    
+    while(ready != 0) {
+        
+        ResourceNode* next = ready->nextReady;
+        
+        this->dispatch(ready);
+        
+        ready = next;
+    }
+    
+    this->_batchDone.wait();
+    
+    this->_batch = 0;
+    
+    // the workers are done with the nodes
+    while(batch != 0) {
+        
+        ResourceNode* next = batch->next;
+        
+        delete batch;
+        
+        batch = next;
+    }
+    
+    return this->_failed ? E_FAILURE : E_SUCCESS;
+}
+
+Core::ResourceManager::ResourceNode* Core::ResourceManager::findCycles() {
+    
+    ResourceNode* cycles = 0;
+    
+    for(ResourceNode* node = this->_batch; node != 0; node = node->next) {
+        
+        node->unresolved = node->waiting;
+        node->resolved = false;
+    }
+    
+    // peel off every resource whose dependencies can all start, what is left never can
+    bool progress = true;
+    
+    while(progress) {
+        
+        progress = false;
+        
+        for(ResourceNode* node = this->_batch; node != 0; node = node->next) {
+            
+            if(node->resolved || node->unresolved != 0) {
+                
+                continue;
+            }
+            
+            node->resolved = true;
+            progress = true;
+            
+            for(ResourceNode* other = this->_batch; other != 0; other = other->next) {
+                
+                if(!other->resolved && dependsOn(other->resource, node->resource->getResourceName())) {
+                    
+                    other->unresolved--;
+                }
+            }
+        }
+    }
+    
+    for(ResourceNode* node = this->_batch; node != 0; node = node->next) {
+        
+        if(!node->resolved) {
+            
+            node->blocked = true;
+            node->started = true;
+            node->nextReady = cycles;
+            
+            cycles = node;
+        }
+    }
+    
+    return cycles;
+}
+
+void Core::ResourceManager::dispatch(ResourceNode* node) {
+    
+    if(node->blocked) {
+        
+        Core::KernelLog::log(KLOG_ERROR, node->resource->getResourceName(), "FAILED (dependency)");
+        
+        this->finish(node, E_FAILURE);
+        
+        return;
+    }
+    
+    Core::WorkQueue* queue = Core::WorkQueue::getSystemQueue();
+    
+    // no workers yet, start it here
+    if(queue == 0) {
+        
+        startNode(reinterpret_cast<unsigned long>(node));
+        
+        return;
+    }
+    
+    unsigned long flags = this->_lock.lockIrqSave();
+    
+    unsigned int cpu;
+    
+    // round robin over the processors that are up, the boot processor always is
+    do {
+        
+        cpu = this->_nextCpu;
+        
+        this->_nextCpu = (this->_nextCpu + 1) % MAX_CPUS;
+        
+    } while(!Core::CPU::isOnline(cpu));
+    
+    this->_lock.unlockIrqRestore(flags);
+    
+    queue->queueOn(&node->work, cpu);
+}
+
+void Core::ResourceManager::startNode(unsigned long data) {
+    
+    ResourceNode* node = reinterpret_cast<ResourceNode*>(data);
+    
+    ResourceManager* manager = _instance;
+    
+    manager->finish(node, manager->start(node->resource, false));
+}
+
+void Core::ResourceManager::finish(ResourceNode* node, unsigned long status) {
+    
+    const char* name = node->resource->getResourceName();
+    
+    ResourceNode* ready = 0;
+    
+    unsigned long flags = this->_lock.lockIrqSave();
+    
+    if(status != E_SUCCESS) {
+        
+        this->_failed = true;
+    }
+    
+    for(ResourceNode* other = this->_batch; other != 0; other = other->next) {
+        
+        if(other->started || !dependsOn(other->resource, name)) {
+            
+            continue;
+        }
+        
+        // a dependency that did not come up takes its dependents down
+        if(status != E_SUCCESS) {
+            
+            other->blocked = true;
+        }
+        
+        if(--other->waiting == 0) {
+            
+            other->started = true;
+            other->nextReady = ready;
+            
+            ready = other;
+        }
+    }
+    
+    bool done = --this->_remaining == 0;
+    
+    this->_lock.unlockIrqRestore(flags);
+    
+    while(ready != 0) {
+        
+        ResourceNode* next = ready->nextReady;
+        
+        this->dispatch(ready);
+        
+        ready = next;
+    }
+    
+    if(done) {
+        
+        this->_batchDone.complete();
+    }
+}
+
+bool Core::ResourceManager::dependsOn(Resource* resource, const char* name) {
+    
+    const char* const* dependencies = resource->getResourceDependencies();
+    
+    for(int n = 0; dependencies != 0 && dependencies[n] != 0; n++) {
+        
+        if(isSameName(dependencies[n], name)) {
+            
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+bool Core::ResourceManager::isSameName(const char* a, const char* b) {
+    
+    unsigned int i = 0;
+    
+    while(a[i] == b[i] && a[i] != 0) {
+        
+        i++;
+    }
+    
+    return a[i] == b[i];
+}
+
+void Core::ResourceManager::publish(Resource* resource) {
+    
+    ResourceTable* old = this->_table;
+    
+    unsigned int count = (old != 0) ? old->count : 0;
+    
+    // the table ends in count + 1 entries
+    unsigned char* memory = new unsigned char[sizeof(ResourceTable) + count * sizeof(Resource*)];
+    
+    // check if we got a valid address
+    if(memory == reinterpret_cast<unsigned char*>(E_ALLOC_NOMEM)) {
+        
+        return;
+    }
+    
+    ResourceTable* table = reinterpret_cast<ResourceTable*>(memory);
+    
+    for(unsigned int n = 0; n < count; n++) {
+        
+        table->resources[n] = old->resources[n];
+    }
+    
+    table->resources[count] = resource;
+    table->count = count + 1;
+    
+    Core::RCU::assign(this->_table, table);
+    
+    // readers may still walk the old version
+    if(old != 0) {
+        
+        Core::RCU::call(&old->rcu, Core::ResourceManager::freeTable);
+    }
+}
+
+void Core::ResourceManager::freeTable(RCUHead* head) {
+    
+    delete[] reinterpret_cast<unsigned char*>(head);
+}
+
+unsigned int Core::ResourceManager::getResourceCount() {
+    
+    Core::RCU::readLock();
+    
+    ResourceTable* table = Core::RCU::dereference(this->_table);
+    
+    unsigned int count = (table != 0) ? table->count : 0;
+    
+    Core::RCU::readUnlock();
+    
+    return count;
+}
+
+Core::Resource* Core::ResourceManager::findResource(const char* name) {
+    
+    Resource* found = 0;
+    
+    Core::RCU::readLock();
+    
+    ResourceTable* table = Core::RCU::dereference(this->_table);
+    
+    for(unsigned int n = 0; table != 0 && n < table->count && found == 0; n++) {
+        
+        if(isSameName(table->resources[n]->getResourceName(), name)) {
+            
+            found = table->resources[n];
+        }
+    }
+    
+    Core::RCU::readUnlock();
+    
+    // resources are never unregistered, the pointer stays valid
+    return found;
 }
 
 // set instance pointer to a null pointer
@@ -0,0 +1,467 @@
+/***************************************************************************
+ *            scheduler.cpp
+ *
+ *  Copyright  2008  Matthias v.d. Vlies
+ *  matthias@mserver.nl
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*! \file scheduler.cpp
+ *  \brief Thread scheduler
+ *   
+ *  This file implements the Scheduler class.
+ *
+ */
+
+#include <core/scheduler.h>
+#include <core/preempt.h>
+#include <core/rcu.h>
+#include <core/spinlock.h>
+#include <core/idle.h>
+#include <core/cpu.h>
+#include <I386/i386.h>
+#include <I386/gdt.h>
+#include <I386/fpu.h>
+#include <I386/smp.h>
+#include <errors.h>
+
+/*! Context switch from loader.asm
+ *
+ *\param oldStack Receives the stack pointer of the thread switched away from
+ *\param newStack The stack pointer of the thread to switch to
+ */
+extern "C" void _context_switch(unsigned long* oldStack, unsigned long newStack);
+
+// no threads yet
+Core::Thread* Core::Scheduler::_current[MAX_CPUS] = { 0 };
+Core::Thread* Core::Scheduler::_idle[MAX_CPUS] = { 0 };
+Core::Thread* Core::Scheduler::_previous[MAX_CPUS] = { 0 };
+Core::Scheduler::RunQueue Core::Scheduler::_queues[MAX_CPUS];
+unsigned long Core::Scheduler::_timeSlices[THREAD_PRIORITIES];
+volatile bool Core::Scheduler::_needResched[MAX_CPUS] = { false };
+
+void Core::Scheduler::initialise() {
+    
+    unsigned int cpu = Core::CPU::getCurrentId();
+    
+    // time slices scale linearly from the lowest to the highest priority
+    if(cpu == 0) {
+        
+        for(int priority = 0; priority < THREAD_PRIORITIES; priority++) {
+            
+            _timeSlices[priority] = THREAD_MIN_TIME_SLICE + ((THREAD_LOWEST_PRIORITY - priority) * (THREAD_MAX_TIME_SLICE - THREAD_MIN_TIME_SLICE)) / THREAD_LOWEST_PRIORITY;
+        }
+    }
+    
+    Thread* idle = new Thread("idle");
+    
+    _idle[cpu] = idle;
+    _current[cpu] = idle;
+}
+
+Core::Thread* Core::Scheduler::getCurrent() {
+    
+    return _current[Core::CPU::getCurrentId()];
+}
+
+void Core::Scheduler::add(Thread* thread) {
+    
+    unsigned long flags = I386::saveFlags();
+    
+    unsigned int cpu = thread->_cpu;
+    
+    thread->_state = THREAD_READY;
+    
+    lockQueue(&_queues[cpu]);
+    
+    enqueue(&_queues[cpu], thread);
+    
+    unlockQueue(&_queues[cpu]);
+    
+    // get out of the idle thread or a less important thread as soon as possible
+    Thread* current = _current[cpu];
+    
+    if(current == _idle[cpu] || thread->_priority < current->_priority) {
+        
+        _needResched[cpu] = true;
+        
+        // another processor only looks at the flag on its next interrupt exit, unless it
+        // sleeps in MWAIT and watches for our store
+        if(cpu != Core::CPU::getCurrentId() && !Core::Idle::wake(cpu)) {
+            
+            I386::SMP::kick(cpu);
+        }
+    }
+    
+    I386::restoreFlags(flags);
+}
+
+void Core::Scheduler::lockQueue(RunQueue* queue) {
+    
+    while(I386::atomicExchange(&queue->lock, 1) != 0) {
+        
+        // spin on reads, the exchange bounces the cache line
+        while(queue->lock != 0) {
+            
+            I386::cpuRelax();
+        }
+    }
+}
+
+void Core::Scheduler::unlockQueue(RunQueue* queue) {
+    
+    // stores are not reordered with older stores on i386, only the compiler needs a barrier
+    asm volatile("" : : : "memory");
+    
+    queue->lock = 0;
+}
+
+void Core::Scheduler::enqueue(RunQueue* queue, Thread* thread) {
+    
+    int priority = thread->_priority;
+    
+    thread->_next = 0;
+    
+    // append to the level
+    if(queue->tail[priority] == 0) {
+        
+        queue->head[priority] = thread;
+        queue->bitmap[priority / 32] |= 1UL << (priority % 32);
+    }
+    else {
+        
+        queue->tail[priority]->_next = thread;
+    }
+    
+    queue->tail[priority] = thread;
+    queue->count++;
+}
+
+void Core::Scheduler::remove(RunQueue* queue, Thread* thread, Thread* previous) {
+    
+    int priority = thread->_priority;
+    
+    // unlink from the level
+    if(previous == 0) {
+        
+        queue->head[priority] = thread->_next;
+    }
+    else {
+        
+        previous->_next = thread->_next;
+    }
+    
+    if(queue->tail[priority] == thread) {
+        
+        queue->tail[priority] = previous;
+    }
+    
+    // level drained?
+    if(queue->head[priority] == 0) {
+        
+        queue->bitmap[priority / 32] &= ~(1UL << (priority % 32));
+    }
+    
+    queue->count--;
+    
+    thread->_next = 0;
+}
+
+Core::Thread* Core::Scheduler::dequeue(unsigned int cpu) {
+    
+    RunQueue* queue = &_queues[cpu];
+    
+    Thread* thread = 0;
+    
+    lockQueue(queue);
+    
+    // find the highest non-empty level
+    for(int word = 0; word < SCHEDULER_BITMAP_WORDS; word++) {
+        
+        if(queue->bitmap[word] != 0) {
+            
+            thread = queue->head[word * 32 + I386::findFirstBit(queue->bitmap[word])];
+            
+            remove(queue, thread, 0);
+            
+            break;
+        }
+    }
+    
+    unlockQueue(queue);
+    
+    return thread;
+}
+
+unsigned int Core::Scheduler::findBusiest(unsigned int cpu) {
+    
+    unsigned int busiest = cpu;
+    unsigned int most = 0;
+    
+    // a stale count only makes us pick a less ideal victim
+    for(unsigned int n = 0; n < MAX_CPUS; n++) {
+        
+        if(n != cpu && _queues[n].count > most) {
+            
+            busiest = n;
+            most = _queues[n].count;
+        }
+    }
+    
+    return busiest;
+}
+
+Core::Thread* Core::Scheduler::steal(unsigned int cpu) {
+    
+    unsigned int victim = findBusiest(cpu);
+    
+    if(victim == cpu) {
+        
+        return 0;
+    }
+    
+    RunQueue* queue = &_queues[victim];
+    
+    I386::FPU* fpu = I386::FPU::getInstance();
+    
+    Thread* thread = 0;
+    
+    lockQueue(queue);
+    
+    // take the most important thread that is free to move
+    for(int priority = 0; priority < THREAD_PRIORITIES && thread == 0; priority++) {
+        
+        if(!(queue->bitmap[priority / 32] & (1UL << (priority % 32)))) {
+            
+            continue;
+        }
+        
+        Thread* previous = 0;
+        
+        for(Thread* candidate = queue->head[priority]; candidate != 0; candidate = candidate->_next) {
+            
+            // pinned, still on its old stack or with its registers in the old FPU?
+            if(!candidate->_bound && !candidate->_onProcessor && !fpu->isLoaded(candidate->_fpuContext)) {
+                
+                remove(queue, candidate, previous);
+                
+                candidate->_cpu = cpu;
+                
+                thread = candidate;
+                
+                break;
+            }
+            
+            previous = candidate;
+        }
+    }
+    
+    unlockQueue(queue);
+    
+    return thread;
+}
+
+void Core::Scheduler::schedule() {
+    
+    unsigned long flags = I386::saveFlags();
+    
+    unsigned int cpu = Core::CPU::getCurrentId();
+    
+    Thread* previous = _current[cpu];
+    
+    _needResched[cpu] = false;
+    
+    // read-side sections cannot span a pass through the scheduler
+    Core::RCU::quiescentState();
+    
+    // a preempted thread goes to the back of the queue
+    if(previous->_state == THREAD_RUNNING && previous != _idle[cpu]) {
+        
+        add(previous);
+    }
+    
+    Thread* next = dequeue(cpu);
+    
+    // nothing to do here, help out a busier processor
+    if(next == 0) {
+        
+        next = steal(cpu);
+    }
+    
+    if(next == 0) {
+        
+        next = _idle[cpu];
+    }
+    
+    if(next != previous) {
+        
+        switchTo(previous, next);
+    }
+    else {
+        
+        // keep running with a fresh time slice
+        next->_state = THREAD_RUNNING;
+        next->_timeSlice = _timeSlices[next->_priority];
+    }
+    
+    I386::restoreFlags(flags);
+}
+
+void Core::Scheduler::switchTo(Thread* previous, Thread* next) {
+    
+    unsigned int cpu = Core::CPU::getCurrentId();
+    
+    next->_state = THREAD_RUNNING;
+    next->_timeSlice = (next != _idle[cpu]) ? _timeSlices[next->_priority] : 0;
+    
+    _current[cpu] = next;
+    _previous[cpu] = previous;
+    
+    next->_onProcessor = true;
+    
+    // the FPU registers follow lazily on the first FPU instruction
+    I386::FPU::getInstance()->switchTo(next->_fpuContext);
+    
+    // interrupts from lower rings land on the stack of the new thread
+    if(next->_stackTop != 0) {
+        
+        I386::GDT::getInstance()->setKernelStack(next->_stackTop);
+    }
+    
+    _context_switch(&previous->_stackPointer, next->_stackPointer);
+    
+    finishSwitch();
+}
+
+void Core::Scheduler::finishSwitch() {
+    
+    Thread* previous = _previous[Core::CPU::getCurrentId()];
+    
+    // we left the stack of the previous thread, another processor may pick it up now
+    previous->_onProcessor = false;
+    
+    // and nobody runs on it anymore once the thread exited
+    if(previous->_state == THREAD_DEAD) {
+        
+        reap(previous);
+    }
+}
+
+void Core::Scheduler::reap(Thread* thread) {
+    
+    if(thread->_stackTop != 0) {
+        
+        delete[] reinterpret_cast<unsigned char*>(thread->_stackTop - THREAD_STACK_SIZE);
+        
+        thread->_stackTop = 0;
+        thread->_stackPointer = 0;
+    }
+    
+    if(thread->_fpuContext != 0) {
+        
+        I386::FPU::getInstance()->freeContext(thread->_fpuContext);
+        
+        thread->_fpuContext = 0;
+    }
+}
+
+void Core::Scheduler::yield() {
+    
+    schedule();
+}
+
+void Core::Scheduler::block() {
+    
+    _current[Core::CPU::getCurrentId()]->_state = THREAD_BLOCKED;
+    
+    schedule();
+}
+
+void Core::Scheduler::block(SpinLock* lock) {
+    
+    _current[Core::CPU::getCurrentId()]->_state = THREAD_BLOCKED;
+    
+    // a wake up from here on makes the thread ready again, schedule() then keeps it running
+    lock->unlock();
+    
+    schedule();
+}
+
+bool Core::Scheduler::wake(Thread* thread) {
+    
+    unsigned long flags = I386::saveFlags();
+    
+    // only one of several wakers may queue the thread
+    bool blocked = I386::compareExchange(&thread->_state, THREAD_BLOCKED, THREAD_READY) == THREAD_BLOCKED;
+    
+    if(blocked) {
+        
+        add(thread);
+    }
+    
+    I386::restoreFlags(flags);
+    
+    return blocked;
+}
+
+void Core::Scheduler::tick() {
+    
+    unsigned int cpu = Core::CPU::getCurrentId();
+    
+    // interrupted code that can be preempted is outside any read-side section
+    Core::RCU::tick(Core::Preempt::isEnabled());
+    
+    Thread* thread = _current[cpu];
+    
+    if(thread == 0) {
+        
+        return;
+    }
+    
+    // an idle processor goes looking for work on the busier ones
+    if(thread == _idle[cpu]) {
+        
+        if(findBusiest(cpu) != cpu) {
+            
+            _needResched[cpu] = true;
+        }
+        
+        return;
+    }
+    
+    // time slice used up?
+    if(thread->_timeSlice != 0 && --thread->_timeSlice == 0) {
+        
+        _needResched[cpu] = true;
+    }
+}
+
+bool Core::Scheduler::isReschedulePending() {
+    
+    return _needResched[Core::CPU::getCurrentId()];
+}
+
+void Core::Scheduler::preempt() {
+    
+    unsigned int cpu = Core::CPU::getCurrentId();
+    
+    if(_needResched[cpu] && _current[cpu] != 0 && Core::Preempt::isEnabled()) {
+        
+        schedule();
+    }
+}
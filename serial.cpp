@@ -0,0 +1,401 @@
+/***************************************************************************
+ *            serial.cpp
+ *
+ *  Copyright  2008  Matthias v.d. Vlies
+ *  matthias@mserver.nl
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*! \file serial.cpp
+ *  \brief 16550 UART Driver
+ *   
+ *  This file implements the Serial class.
+ *
+ */
+
+#include <core/serial.h>
+#include <core/terminal.h>
+#include <I386/idt.h>
+#include <config.h>
+#include <errors.h>
+
+// statistics for the serial port locks
+static LOCK_CLASS(serialLockClass, "serial");
+
+/*! Base I/O port of each port */
+static const unsigned short serialBases[SERIAL_PORTS] = { 0x3f8, 0x2f8, 0x3e8, 0x2e8 };
+
+/*! IRQ line of each port */
+static const unsigned char serialIRQs[SERIAL_PORTS] = { 4, 3, 4, 3 };
+
+/*! Resource name of each port */
+static const char* const serialNames[SERIAL_PORTS] = { "Serial port COM1", "Serial port COM2", "Serial port COM3", "Serial port COM4" };
+
+// no ports in use
+Core::Serial* Core::Serial::_instances[SERIAL_PORTS] = { 0 };
+
+Core::Serial* Core::Serial::getInstance(unsigned int port) {
+    
+    if(port >= SERIAL_PORTS) {
+        
+        return 0;
+    }
+    
+    // check for exsisting instance
+    if(_instances[port] == 0) {
+        
+        // none found, create new instance
+        _instances[port] = new Serial(port);
+        
+        // check if we got a valid address
+        if(_instances[port] == reinterpret_cast<Serial*>(E_ALLOC_NOMEM)) {
+            
+            _instances[port] = 0;
+            
+            // no, major oops here!
+            return E_FAILURE;
+        }
+    }
+    
+    // return the instance
+    return _instances[port];
+}
+
+Core::Serial::Serial(unsigned int port) : _lock(&serialLockClass) {
+    
+    this->_port = port;
+    this->_base = serialBases[port];
+    this->_irq = serialIRQs[port];
+    this->_present = false;
+    this->_interrupts = 0;
+}
+
+unsigned long Core::Serial::startResource() {
+    
+    unsigned short base = this->_base;
+    
+    // nothing answers on a missing port, so the scratch register does not keep its value
+    I386::writePortByte(base + SERIAL_SCRATCH, 0x5a);
+    
+    if(I386::readPortByte(base + SERIAL_SCRATCH) != 0x5a) {
+        
+        return E_FAILURE;
+    }
+    
+    // no interrupts while programming
+    I386::writePortByte(base + SERIAL_INTERRUPT_ENABLE, 0);
+    
+    // baud rate
+    unsigned short divisor = SERIAL_CLOCK / SERIAL_BAUD_RATE;
+    
+    I386::writePortByte(base + SERIAL_LINE_CONTROL, SERIAL_LCR_DLAB);
+    I386::writePortByte(base + SERIAL_DATA, divisor & 0xff);
+    I386::writePortByte(base + SERIAL_INTERRUPT_ENABLE, divisor >> 8);
+    I386::writePortByte(base + SERIAL_LINE_CONTROL, SERIAL_LCR_8N1);
+    
+    I386::writePortByte(base + SERIAL_INTERRUPT_ID, SERIAL_FCR_ENABLE);
+    
+    // an 8250 or 16450 has no FIFO to batch into
+    if((I386::readPortByte(base + SERIAL_INTERRUPT_ID) & SERIAL_IIR_FIFO) != SERIAL_IIR_FIFO) {
+        
+        return E_FAILURE;
+    }
+    
+    I386::writePortByte(base + SERIAL_MODEM_CONTROL, SERIAL_MCR_ENABLE);
+    
+    // throw away whatever arrived before
+    I386::readPortByte(base + SERIAL_LINE_STATUS);
+    I386::readPortByte(base + SERIAL_DATA);
+    I386::readPortByte(base + SERIAL_MODEM_STATUS);
+    
+    unsigned long flags = this->_lock.lockIrqSave();
+    
+    this->_present = true;
+    
+    // the transmit interrupt is only enabled while there is something to send
+    this->_interrupts = SERIAL_IER_RECEIVE;
+    
+    I386::writePortByte(base + SERIAL_INTERRUPT_ENABLE, this->_interrupts);
+    
+    // output queued before the port came up
+    this->transmit(false);
+    
+    this->_lock.unlockIrqRestore(flags);
+    
+    I386::IDT::getInstance()->registerHandler(IRQ_BASE + this->_irq, Core::Serial::interrupt);
+    
+    return E_SUCCESS;
+}
+
+const char* Core::Serial::getResourceName() {
+    
+    return serialNames[this->_port];
+}
+
+const char* const* Core::Serial::getResourceDependencies() {
+    
+    // the interrupt handler goes into the IDT
+    static const char* const dependencies[] = { "Interrupt Descriptor Table", 0 };
+    
+    return dependencies;
+}
+
+unsigned long Core::Serial::getTerminalType() {
+    
+    return TERMINAL_TYPE_SERIAL;
+}
+
+unsigned long Core::Serial::getColumns() {
+    
+    // a stream has no cells
+    return 0;
+}
+
+unsigned long Core::Serial::getRows() {
+    
+    return 0;
+}
+
+unsigned long Core::Serial::getPages() {
+    
+    return 0;
+}
+
+bool Core::Serial::isPresent() {
+    
+    return this->_present;
+}
+
+void Core::Serial::clearBuffer() {
+    
+    unsigned long flags = this->_lock.lockIrqSave();
+    
+    char c;
+    
+    while(this->_receive.pop(c));
+    
+    this->_lock.unlockIrqRestore(flags);
+}
+
+unsigned long Core::Serial::write(void* buffer, unsigned long size) {
+    
+    this->send(static_cast<const char*>(buffer), size);
+    
+    return E_SUCCESS;
+}
+
+unsigned long Core::Serial::write(void* buffer, unsigned long offset, unsigned long size) {
+    
+    // a stream has no cells to replace
+    return E_FAILURE;
+}
+
+void Core::Serial::present() {
+    
+    // sent as soon as written
+}
+
+void Core::Serial::showPage(unsigned long page, unsigned long row) {
+    
+    // a stream has no pages
+}
+
+void Core::Serial::send(const char* text, unsigned long length) {
+    
+    unsigned long flags = this->_lock.lockIrqSave();
+    
+    if(!this->_present) {
+        
+        this->_lock.unlockIrqRestore(flags);
+        
+        return;
+    }
+    
+    for(unsigned long n = 0; n < length; n++) {
+        
+        // terminals expect a carriage return before every newline
+        if(text[n] == '\n') {
+            
+            while(!this->_transmit.push('\r')) {
+                
+                // the ring is full, the line is the bottleneck now
+                this->transmit(true);
+            }
+        }
+        
+        while(!this->_transmit.push(text[n])) {
+            
+            this->transmit(true);
+        }
+    }
+    
+    // an idle transmitter raises no interrupt, start it here
+    if((this->_interrupts & SERIAL_IER_TRANSMIT) == 0) {
+        
+        this->transmit(false);
+    }
+    
+    this->_lock.unlockIrqRestore(flags);
+}
+
+bool Core::Serial::trySend(unsigned int port, const char* text, unsigned long length) {
+    
+    // never create the port from here, that would take the allocator lock
+    Serial* serial = (port < SERIAL_PORTS) ? _instances[port] : 0;
+    
+    if(serial == 0 || !serial->_lock.tryLock()) {
+        
+        return false;
+    }
+    
+    if(serial->_present) {
+        
+        for(unsigned long n = 0; n < length; n++) {
+            
+            if(text[n] == '\n') {
+                
+                while(!serial->_transmit.push('\r')) {
+                    
+                    serial->transmit(true);
+                }
+            }
+            
+            while(!serial->_transmit.push(text[n])) {
+                
+                serial->transmit(true);
+            }
+        }
+        
+        // no interrupt will drain the ring for us
+        while(!serial->_transmit.isEmpty()) {
+            
+            serial->transmit(true);
+        }
+    }
+    
+    serial->_lock.unlock();
+    
+    return serial->_present;
+}
+
+unsigned long Core::Serial::read(char* buffer, unsigned long size) {
+    
+    unsigned long flags = this->_lock.lockIrqSave();
+    
+    unsigned long count = 0;
+    
+    while(count < size && this->_receive.pop(buffer[count])) {
+        
+        count++;
+    }
+    
+    this->_lock.unlockIrqRestore(flags);
+    
+    return count;
+}
+
+void Core::Serial::transmit(bool wait) {
+    
+    unsigned short base = this->_base;
+    
+    if(wait) {
+        
+        while((I386::readPortByte(base + SERIAL_LINE_STATUS) & SERIAL_LSR_TRANSMIT) == 0);
+    }
+    
+    // an empty holding register means an empty FIFO, otherwise the interrupt refills it later
+    if(I386::readPortByte(base + SERIAL_LINE_STATUS) & SERIAL_LSR_TRANSMIT) {
+        
+        char c;
+        
+        for(int n = 0; n < SERIAL_FIFO_SIZE && this->_transmit.pop(c); n++) {
+            
+            I386::writePortByte(base + SERIAL_DATA, c);
+        }
+    }
+    
+    unsigned char interrupts = this->_transmit.isEmpty() ? SERIAL_IER_RECEIVE : SERIAL_IER_RECEIVE | SERIAL_IER_TRANSMIT;
+    
+    // only touch the register when the interrupt has to be switched
+    if(interrupts != this->_interrupts) {
+        
+        this->_interrupts = interrupts;
+        
+        I386::writePortByte(base + SERIAL_INTERRUPT_ENABLE, interrupts);
+    }
+}
+
+void Core::Serial::service() {
+    
+    unsigned short base = this->_base;
+    
+    for(;;) {
+        
+        unsigned char identification = I386::readPortByte(base + SERIAL_INTERRUPT_ID);
+        
+        if(identification & SERIAL_IIR_NONE) {
+            
+            break;
+        }
+        
+        switch(identification & SERIAL_IIR_MASK) {
+            
+            case SERIAL_IIR_RECEIVE:
+            case SERIAL_IIR_TIMEOUT:
+                
+                // empty the FIFO, a full ring drops the character rather than waiting
+                while(I386::readPortByte(base + SERIAL_LINE_STATUS) & SERIAL_LSR_DATA) {
+                    
+                    this->_receive.push(I386::readPortByte(base + SERIAL_DATA));
+                }
+                break;
+                
+            case SERIAL_IIR_TRANSMIT:
+                this->transmit(false);
+                break;
+                
+            case SERIAL_IIR_LINE:
+                I386::readPortByte(base + SERIAL_LINE_STATUS);
+                break;
+                
+            default:
+                I386::readPortByte(base + SERIAL_MODEM_STATUS);
+                break;
+        }
+    }
+}
+
+void Core::Serial::interrupt(struct I386::Registers* registers) {
+    
+    // the line is shared by two ports, serve both
+    for(unsigned int port = 0; port < SERIAL_PORTS; port++) {
+        
+        Serial* serial = _instances[port];
+        
+        if(serial == 0 || !serial->_present || registers->interrupt != static_cast<unsigned int>(IRQ_BASE + serial->_irq)) {
+            
+            continue;
+        }
+        
+        serial->_lock.lock();
+        
+        serial->service();
+        
+        serial->_lock.unlock();
+    }
+}
@@ -0,0 +1,428 @@
+/***************************************************************************
+ *            smp.cpp
+ *
+ *  Copyright  2008  Matthias v.d. Vlies
+ *  matthias@mserver.nl
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*! \file smp.cpp
+ *  \brief SMP manager
+ *   
+ * This file implements the SMP class.
+ *
+ */
+
+#include <I386/smp.h>
+#include <I386/apic.h>
+#include <I386/gdt.h>
+#include <I386/idt.h>
+#include <I386/fpu.h>
+#include <I386/pit.h>
+#include <I386/i386.h>
+#include <core/cpu.h>
+#include <core/scheduler.h>
+#include <core/softirq.h>
+#include <core/idle.h>
+#include <errors.h>
+
+// real-mode trampoline from loader.asm, copied to SMP_TRAMPOLINE_BASE before use
+extern "C" unsigned char _trampoline_start[];
+extern "C" unsigned char _trampoline_end[];
+
+// parameters inside the trampoline, filled in for every processor
+extern "C" unsigned char _trampoline_stack[];
+extern "C" unsigned char _trampoline_entry[];
+extern "C" unsigned char _trampoline_cpu[];
+extern "C" unsigned char _trampoline_percpu[];
+
+/*! Function to compare a signature
+ *
+ *\param memory The memory to check
+ *\param signature The expected signature
+ *\param length Length of the signature
+ *\return Wether the memory starts with the signature
+ */
+static bool matches(const unsigned char* memory, const char* signature, unsigned int length) {
+    
+    for(unsigned int n = 0; n < length; n++) {
+        
+        if(memory[n] != static_cast<unsigned char>(signature[n])) {
+            
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+/*! Function to get a parameter of the copied trampoline
+ *
+ *\param parameter The parameter in the original trampoline
+ *\return The parameter in the copy
+ */
+static unsigned long* trampolineParameter(unsigned char* parameter) {
+    
+    return reinterpret_cast<unsigned long*>(SMP_TRAMPOLINE_BASE + (parameter - _trampoline_start));
+}
+
+// set instance pointer to a null pointer
+I386::SMP* I386::SMP::_instance = 0;
+
+I386::SMP* I386::SMP::getInstance() {
+    
+    // check for exsisting instance
+    if(_instance == 0) {
+        
+        // none found, create new instance
+        _instance = new SMP();
+        
+        // check if we got a valid address
+        if(_instance == reinterpret_cast<SMP*>(E_ALLOC_NOMEM)) {
+            
+            _instance = 0;
+            
+            // no, major oops here!
+            return E_FAILURE;
+        }
+        
+        // auto register
+        Core::ResourceManager::getInstance()->registerResource(_instance);
+    }
+    
+    // return the instance
+    return _instance;
+}
+
+I386::SMP::SMP() {
+    
+    this->_count = 0;
+    
+    for(int n = 0; n < MAX_CPUS; n++) {
+        
+        this->_apicIds[n] = 0;
+        this->_stacks[n] = 0;
+        this->_online[n] = false;
+    }
+}
+
+unsigned long I386::SMP::startResource() {
+    
+    I386::APIC* apic = I386::APIC::getInstance();
+    
+    // no way to reach the other processors
+    if(!apic->isEnabled()) {
+        
+        return E_FAILURE;
+    }
+    
+    // the boot processor becomes processor 0
+    this->addProcessor(apic->getId());
+    this->_online[0] = true;
+    
+    if(!this->parseMADT()) {
+        
+        this->parseMPTable();
+    }
+    
+    // uniprocessor machine, nothing to start
+    if(this->_count == 1) {
+        
+        return E_SUCCESS;
+    }
+    
+    // every processor finds its number in its per-CPU area
+    for(unsigned int cpu = 0; cpu < this->_count; cpu++) {
+        
+        Core::CPU::registerProcessor(cpu, this->_apicIds[cpu]);
+    }
+    
+    // copy the trampoline below 1 MB where real mode can reach it
+    unsigned char* trampoline = reinterpret_cast<unsigned char*>(SMP_TRAMPOLINE_BASE);
+    
+    for(unsigned long n = 0; n < static_cast<unsigned long>(_trampoline_end - _trampoline_start); n++) {
+        
+        trampoline[n] = _trampoline_start[n];
+    }
+    
+    unsigned long status = E_SUCCESS;
+    
+    // one at a time, they share the trampoline
+    for(unsigned int cpu = 1; cpu < this->_count; cpu++) {
+        
+        if(!this->startProcessor(cpu)) {
+            
+            status = E_WARNING;
+        }
+    }
+    
+    return status;
+}
+
+const char* I386::SMP::getResourceName() {
+    
+    return "Symmetric multiprocessing";
+}
+
+void I386::SMP::kick(unsigned int cpu) {
+    
+    if(_instance != 0 && _instance->_online[cpu]) {
+        
+        I386::APIC::getInstance()->sendInterrupt(_instance->_apicIds[cpu], APIC_RESCHEDULE_VECTOR);
+    }
+}
+
+void I386::SMP::addProcessor(unsigned int id) {
+    
+    for(unsigned int n = 0; n < this->_count; n++) {
+        
+        if(this->_apicIds[n] == id) {
+            
+            return;
+        }
+    }
+    
+    if(this->_count < MAX_CPUS) {
+        
+        this->_apicIds[this->_count++] = id;
+    }
+}
+
+unsigned char* I386::SMP::findSignature(unsigned long start, unsigned long end, const char* signature, unsigned int length, unsigned int checksumLength) {
+    
+    for(unsigned long address = start; address + checksumLength <= end; address += 16) {
+        
+        unsigned char* memory = reinterpret_cast<unsigned char*>(address);
+        
+        if(!matches(memory, signature, length)) {
+            
+            continue;
+        }
+        
+        unsigned char sum = 0;
+        
+        for(unsigned int n = 0; n < checksumLength; n++) {
+            
+            sum += memory[n];
+        }
+        
+        if(sum == 0) {
+            
+            return memory;
+        }
+    }
+    
+    return 0;
+}
+
+unsigned long I386::SMP::getEBDA() {
+    
+    volatile unsigned short* segment = reinterpret_cast<volatile unsigned short*>(SMP_EBDA_POINTER);
+    
+    // hide the constant address, otherwise the compiler takes it for an object of size 0
+    __asm__ ("" : "+r" (segment));
+    
+    return static_cast<unsigned long>(*segment) << 4;
+}
+
+bool I386::SMP::parseMADT() {
+    
+    unsigned long ebda = this->getEBDA();
+    
+    // the root pointer is in the first kilobyte of the EBDA or in the BIOS area
+    unsigned char* found = this->findSignature(ebda, ebda + 1024, "RSD PTR ", 8, sizeof(struct RSDP));
+    
+    if(found == 0) {
+        
+        found = this->findSignature(SMP_BIOS_START, SMP_BIOS_END, "RSD PTR ", 8, sizeof(struct RSDP));
+    }
+    
+    if(found == 0) {
+        
+        return false;
+    }
+    
+    struct RSDP* rsdp = reinterpret_cast<struct RSDP*>(found);
+    struct ACPIHeader* rsdt = reinterpret_cast<struct ACPIHeader*>(rsdp->rsdt);
+    
+    if(!matches(reinterpret_cast<unsigned char*>(rsdt->signature), "RSDT", 4)) {
+        
+        return false;
+    }
+    
+    unsigned int* tables = reinterpret_cast<unsigned int*>(rsdt + 1);
+    unsigned int count = (rsdt->length - sizeof(struct ACPIHeader)) / 4;
+    
+    for(unsigned int n = 0; n < count; n++) {
+        
+        struct ACPIHeader* madt = reinterpret_cast<struct ACPIHeader*>(tables[n]);
+        
+        if(!matches(reinterpret_cast<unsigned char*>(madt->signature), "APIC", 4)) {
+            
+            continue;
+        }
+        
+        // entries follow the local APIC address and the flags
+        unsigned char* entry = reinterpret_cast<unsigned char*>(madt + 1) + 8;
+        unsigned char* end = reinterpret_cast<unsigned char*>(madt) + madt->length;
+        
+        while(entry + 2 <= end && entry[1] >= 2) {
+            
+            // processor local APIC: type, length, ACPI id, APIC id, flags
+            if(entry[0] == 0 && (entry[4] & 0x01)) {
+                
+                this->addProcessor(entry[3]);
+            }
+            
+            entry += entry[1];
+        }
+        
+        return true;
+    }
+    
+    return false;
+}
+
+bool I386::SMP::parseMPTable() {
+    
+    unsigned long ebda = this->getEBDA();
+    
+    // the floating pointer is in the EBDA, the last kilobyte of base memory or the BIOS area
+    unsigned char* found = this->findSignature(ebda, ebda + 1024, "_MP_", 4, sizeof(struct MPFloatingPointer));
+    
+    if(found == 0) {
+        
+        found = this->findSignature(SMP_BASE_MEMORY_END - 1024, SMP_BASE_MEMORY_END, "_MP_", 4, sizeof(struct MPFloatingPointer));
+    }
+    
+    if(found == 0) {
+        
+        found = this->findSignature(SMP_BIOS_START, SMP_BIOS_END, "_MP_", 4, sizeof(struct MPFloatingPointer));
+    }
+    
+    if(found == 0) {
+        
+        return false;
+    }
+    
+    struct MPFloatingPointer* pointer = reinterpret_cast<struct MPFloatingPointer*>(found);
+    
+    /*! \todo support the default configurations without a table */
+    if(pointer->configuration == 0) {
+        
+        return false;
+    }
+    
+    struct MPConfiguration* configuration = reinterpret_cast<struct MPConfiguration*>(pointer->configuration);
+    
+    if(!matches(reinterpret_cast<unsigned char*>(configuration->signature), "PCMP", 4)) {
+        
+        return false;
+    }
+    
+    unsigned char* entry = reinterpret_cast<unsigned char*>(configuration + 1);
+    
+    for(unsigned int n = 0; n < configuration->entries; n++) {
+        
+        // processor entries are 20 bytes: type, APIC id, version, flags, ...
+        if(entry[0] == 0) {
+            
+            if(entry[3] & 0x01) {
+                
+                this->addProcessor(entry[1]);
+            }
+            
+            entry += 20;
+        }
+        else {
+            
+            // buses, I/O APICs and interrupt assignments are 8 bytes
+            entry += 8;
+        }
+    }
+    
+    return true;
+}
+
+bool I386::SMP::startProcessor(unsigned int cpu) {
+    
+    unsigned char* stack = new unsigned char[THREAD_STACK_SIZE];
+    
+    // check if we got a valid address
+    if(stack == reinterpret_cast<unsigned char*>(E_ALLOC_NOMEM)) {
+        
+        return false;
+    }
+    
+    this->_stacks[cpu] = reinterpret_cast<unsigned long>(stack + THREAD_STACK_SIZE);
+    
+    *trampolineParameter(_trampoline_stack) = this->_stacks[cpu];
+    *trampolineParameter(_trampoline_entry) = reinterpret_cast<unsigned long>(I386::SMP::processorEntry);
+    *trampolineParameter(_trampoline_cpu) = cpu;
+    *trampolineParameter(_trampoline_percpu) = reinterpret_cast<unsigned long>(Core::PerCPU::getArea(cpu));
+    
+    I386::APIC* apic = I386::APIC::getInstance();
+    
+    unsigned int id = this->_apicIds[cpu];
+    
+    apic->sendInit(id);
+    
+    I386::PIT::delay(SMP_INIT_DELAY);
+    
+    // the second start-up interrupt is only for processors that missed the first
+    for(int n = 0; n < 2 && !this->_online[cpu]; n++) {
+        
+        apic->sendStartup(id, SMP_TRAMPOLINE_BASE >> 12);
+        
+        I386::PIT::delay(SMP_STARTUP_DELAY);
+    }
+    
+    unsigned long timeout = SMP_ONLINE_TIMEOUT;
+    
+    while(!this->_online[cpu] && timeout-- != 0) {
+        
+        I386::PIT::delay(1);
+    }
+    
+    return this->_online[cpu];
+}
+
+void I386::SMP::processorEntry(unsigned int cpu) {
+    
+    SMP* smp = _instance;
+    
+    // the trampoline only set up flat segments, give this processor its own tables
+    I386::GDT::getInstance()->initialiseProcessor(cpu, smp->_stacks[cpu]);
+    I386::IDT::getInstance()->initialiseProcessor();
+    I386::FPU::getInstance()->initialiseProcessor();
+    I386::APIC::getInstance()->initialiseProcessor();
+    
+    // from here on we are the idle thread of this processor
+    Core::Scheduler::initialise();
+    
+    Core::SoftIRQ::startDaemon();
+    
+    Core::CPU::setOnline(cpu);
+    
+    smp->_online[cpu] = true;
+    
+    I386::enableInterrupts();
+    
+    // work arrives through the timer and reschedule interrupts or a store to the monitor
+    Core::Idle::run();
+}
@@ -0,0 +1,251 @@
+/***************************************************************************
+ *            softirq.cpp
+ *
+ *  Copyright  2008  Matthias v.d. Vlies
+ *  matthias@mserver.nl
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*! \file softirq.cpp
+ *  \brief Deferred interrupt work
+ *   
+ *  This file implements the SoftIRQ and Tasklet classes.
+ *
+ */
+
+#include <core/softirq.h>
+#include <core/cpu.h>
+#include <core/scheduler.h>
+#include <core/preempt.h>
+#include <I386/i386.h>
+#include <errors.h>
+
+// nothing pending at boot
+volatile unsigned long Core::SoftIRQ::_pending[MAX_CPUS] = { 0 };
+
+// no processor is running softirqs
+volatile bool Core::SoftIRQ::_running[MAX_CPUS] = { false };
+
+// no handlers installed yet
+Core::SoftIRQHandler Core::SoftIRQ::_handlers[SOFTIRQ_COUNT] = { 0 };
+
+// no softirq threads yet
+Core::Thread* Core::SoftIRQ::_daemon[MAX_CPUS] = { 0 };
+
+void Core::SoftIRQ::registerHandler(unsigned int number, SoftIRQHandler handler) {
+    
+    if(number < SOFTIRQ_COUNT) {
+        
+        _handlers[number] = handler;
+    }
+}
+
+void Core::SoftIRQ::raise(unsigned int number) {
+    
+    // the pending word is only touched by its own processor, masking interrupts is enough
+    unsigned long flags = I386::saveFlags();
+    
+    _pending[Core::CPU::getCurrentId()] |= (1 << number);
+    
+    I386::restoreFlags(flags);
+}
+
+bool Core::SoftIRQ::isPending() {
+    
+    return _pending[Core::CPU::getCurrentId()] != 0;
+}
+
+void Core::SoftIRQ::run() {
+    
+    unsigned int cpu = Core::CPU::getCurrentId();
+    
+    // an interrupt arrived while we were processing softirqs, let the outer pass handle it
+    if(_running[cpu]) {
+        
+        return;
+    }
+    
+    _running[cpu] = true;
+    
+    unsigned long long deadline = I386::readTimeStampCounter() + SOFTIRQ_BUDGET_CYCLES;
+    int restarts = SOFTIRQ_MAX_RESTART;
+    
+    unsigned long pending = _pending[cpu];
+    
+    while(pending != 0) {
+        
+        // take the pending work, new raises go into a fresh word
+        _pending[cpu] = 0;
+        
+        // handlers may be in read-side sections, a tick in between must not count as quiescent
+        Core::Preempt::disable();
+        
+        I386::enableInterrupts();
+        
+        // run the handlers, lowest number first
+        while(pending != 0) {
+            
+            unsigned long number = I386::findFirstBit(pending);
+            
+            pending &= pending - 1;
+            
+            if(_handlers[number] != 0) {
+                
+                _handlers[number]();
+            }
+        }
+        
+        I386::disableInterrupts();
+        
+        Core::Preempt::enable();
+        
+        // out of budget? the rest stays pending
+        if(--restarts == 0 || I386::readTimeStampCounter() > deadline) {
+            
+            break;
+        }
+        
+        pending = _pending[cpu];
+    }
+    
+    _running[cpu] = false;
+    
+    // out of budget, let the softirq thread continue when the scheduler gets to it
+    if(_pending[cpu] != 0 && _daemon[cpu] != 0) {
+        
+        Core::Scheduler::wake(_daemon[cpu]);
+    }
+}
+
+void Core::SoftIRQ::irqExit() {
+    
+    if(_pending[Core::CPU::getCurrentId()] != 0) {
+        
+        run();
+    }
+}
+
+void Core::SoftIRQ::startDaemon() {
+    
+    unsigned int cpu = Core::CPU::getCurrentId();
+    
+    Thread* thread = new Thread(Core::SoftIRQ::daemon, 0, "softirq", THREAD_LOWEST_PRIORITY);
+    
+    // it runs the softirqs of this processor only
+    thread->bind(cpu);
+    
+    if(thread->start() == E_SUCCESS) {
+        
+        _daemon[cpu] = thread;
+    }
+}
+
+void Core::SoftIRQ::daemon(unsigned long data) {
+    
+    for(;;) {
+        
+        I386::disableInterrupts();
+        
+        // sleep until an interrupt exit runs out of budget
+        if(!isPending()) {
+            
+            Core::Scheduler::block();
+        }
+        
+        run();
+        
+        I386::enableInterrupts();
+        
+        // one pass at a time, others get to run in between
+        Core::Scheduler::yield();
+    }
+}
+
+// empty queues
+Core::Tasklet* Core::Tasklet::_head[MAX_CPUS] = { 0 };
+Core::Tasklet* Core::Tasklet::_tail[MAX_CPUS] = { 0 };
+
+Core::Tasklet::Tasklet(Function function, unsigned long data) {
+    
+    this->_function = function;
+    this->_data = data;
+    this->_scheduled = false;
+    this->_next = 0;
+}
+
+void Core::Tasklet::initialise() {
+    
+    Core::SoftIRQ::registerHandler(SOFTIRQ_TASKLET, Core::Tasklet::runQueued);
+}
+
+void Core::Tasklet::schedule() {
+    
+    unsigned long flags = I386::saveFlags();
+    
+    // already queued?
+    if(!this->_scheduled) {
+        
+        unsigned int cpu = Core::CPU::getCurrentId();
+        
+        this->_scheduled = true;
+        this->_next = 0;
+        
+        // append to the queue of this processor
+        if(_tail[cpu] == 0) {
+            
+            _head[cpu] = this;
+        }
+        else {
+            
+            _tail[cpu]->_next = this;
+        }
+        
+        _tail[cpu] = this;
+        
+        Core::SoftIRQ::raise(SOFTIRQ_TASKLET);
+    }
+    
+    I386::restoreFlags(flags);
+}
+
+void Core::Tasklet::runQueued() {
+    
+    unsigned int cpu = Core::CPU::getCurrentId();
+    
+    // detach the whole queue
+    I386::disableInterrupts();
+    
+    Tasklet* tasklet = _head[cpu];
+    
+    _head[cpu] = 0;
+    _tail[cpu] = 0;
+    
+    I386::enableInterrupts();
+    
+    while(tasklet != 0) {
+        
+        Tasklet* next = tasklet->_next;
+        
+        // allow rescheduling from within the function
+        tasklet->_scheduled = false;
+        
+        tasklet->_function(tasklet->_data);
+        
+        tasklet = next;
+    }
+}
@@ -0,0 +1,287 @@
+/***************************************************************************
+ *            spinlock.cpp
+ *
+ *  Copyright  2008  Matthias v.d. Vlies
+ *  matthias@mserver.nl
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*! \file spinlock.cpp
+ *  \brief Kernel spinlocks
+ *   
+ *  This file implements the SpinLock, MCSLock and LockStat classes.
+ *
+ */
+
+#include <core/spinlock.h>
+#include <core/preempt.h>
+#include <core/format.h>
+#include <core/cpu.h>
+#include <I386/i386.h>
+
+/*! Macro keeping the compiler from moving memory accesses across a lock operation, the
+ *  processor does not reorder stores with older stores or loads with older loads
+ */
+#define LOCK_BARRIER()          __asm__ __volatile__ ("" : : : "memory")
+
+// no classes seen yet
+Core::LockClass* Core::LockStat::_classes[LOCKSTAT_CLASSES] = { 0 };
+volatile unsigned long Core::LockStat::_count = 0;
+
+void Core::LockStat::record(LockClass* lockClass, bool contended, unsigned long long cycles) {
+    
+    if(lockClass == 0) {
+        
+        return;
+    }
+    
+    // first use, claim a slot in the table
+    if(lockClass->registered == 0 && I386::atomicExchange(&lockClass->registered, 1) == 0) {
+        
+        unsigned long slot = I386::atomicFetchAdd(&_count, 1);
+        
+        if(slot < LOCKSTAT_CLASSES) {
+            
+            _classes[slot] = lockClass;
+        }
+    }
+    
+    unsigned int cpu = Core::CPU::getCurrentId();
+    
+    lockClass->acquisitions[cpu]++;
+    
+    if(contended) {
+        
+        lockClass->contentions[cpu]++;
+        lockClass->waitCycles[cpu] += cycles;
+    }
+}
+
+void Core::LockStat::reset() {
+    
+    for(unsigned long n = 0; n < _count && n < LOCKSTAT_CLASSES; n++) {
+        
+        LockClass* lockClass = _classes[n];
+        
+        for(int cpu = 0; cpu < MAX_CPUS; cpu++) {
+            
+            lockClass->acquisitions[cpu] = 0;
+            lockClass->contentions[cpu] = 0;
+            lockClass->waitCycles[cpu] = 0;
+        }
+    }
+}
+
+void Core::LockStat::print() {
+    
+    Core::kprintf("Lock statistics (acquisitions, contended, wait cycles):\n");
+    
+    for(unsigned long n = 0; n < _count && n < LOCKSTAT_CLASSES; n++) {
+        
+        LockClass* lockClass = _classes[n];
+        
+        unsigned long acquisitions = 0;
+        unsigned long contentions = 0;
+        unsigned long long waitCycles = 0;
+        
+        // racy sums, the counters keep moving while we print
+        for(int cpu = 0; cpu < MAX_CPUS; cpu++) {
+            
+            acquisitions += lockClass->acquisitions[cpu];
+            contentions += lockClass->contentions[cpu];
+            waitCycles += lockClass->waitCycles[cpu];
+        }
+        
+        Core::kprintf("  %s: %lu %lu %llu\n", lockClass->name, acquisitions, contentions, waitCycles);
+    }
+}
+
+Core::SpinLock::SpinLock(LockClass* lockClass) {
+    
+    this->_next = 0;
+    this->_owner = 0;
+    this->_class = lockClass;
+}
+
+void Core::SpinLock::lock() {
+    
+    Core::Preempt::disable();
+    
+    unsigned long ticket = I386::atomicFetchAdd(&this->_next, 1);
+    
+#ifdef LOCKSTAT
+    bool contended = this->_owner != ticket;
+    unsigned long long start = contended ? I386::readTimeStampCounter() : 0;
+#endif
+    
+    for(;;) {
+        
+        unsigned long ahead = ticket - this->_owner;
+        
+        if(ahead == 0) {
+            
+            break;
+        }
+        
+        // the further back in the queue, the longer until our turn
+        for(unsigned long n = ahead * SPINLOCK_BACKOFF; n != 0; n--) {
+            
+            I386::cpuRelax();
+        }
+    }
+    
+    LOCK_BARRIER();
+    
+#ifdef LOCKSTAT
+    Core::LockStat::record(this->_class, contended, contended ? I386::readTimeStampCounter() - start : 0);
+#endif
+}
+
+bool Core::SpinLock::tryLock() {
+    
+    Core::Preempt::disable();
+    
+    unsigned long owner = this->_owner;
+    
+    // only take a ticket when it would be served right away
+    if(this->_next != owner || I386::compareExchange(&this->_next, owner, owner + 1) != owner) {
+        
+        Core::Preempt::enable();
+        
+        return false;
+    }
+    
+    LOCK_BARRIER();
+    
+#ifdef LOCKSTAT
+    Core::LockStat::record(this->_class, false, 0);
+#endif
+    
+    return true;
+}
+
+void Core::SpinLock::unlock() {
+    
+    LOCK_BARRIER();
+    
+    // only the holder writes the owner, no atomic needed
+    this->_owner = this->_owner + 1;
+    
+    Core::Preempt::enable();
+}
+
+unsigned long Core::SpinLock::lockIrqSave() {
+    
+    unsigned long flags = I386::saveFlags();
+    
+    this->lock();
+    
+    return flags;
+}
+
+void Core::SpinLock::unlockIrqRestore(unsigned long flags) {
+    
+    this->unlock();
+    
+    I386::restoreFlags(flags);
+}
+
+bool Core::SpinLock::isLocked() {
+    
+    return this->_next != this->_owner;
+}
+
+Core::MCSLock::MCSLock(LockClass* lockClass) {
+    
+    this->_tail = 0;
+    this->_class = lockClass;
+}
+
+void Core::MCSLock::lock(MCSNode* node) {
+    
+    Core::Preempt::disable();
+    
+    node->next = 0;
+    node->locked = 1;
+    
+    MCSNode* previous = reinterpret_cast<MCSNode*>(I386::atomicExchange(reinterpret_cast<volatile unsigned long*>(&this->_tail), reinterpret_cast<unsigned long>(node)));
+    
+#ifdef LOCKSTAT
+    bool contended = previous != 0;
+    unsigned long long start = contended ? I386::readTimeStampCounter() : 0;
+#endif
+    
+    if(previous != 0) {
+        
+        // queue up behind the previous waiter and spin on our own node
+        previous->next = node;
+        
+        while(node->locked != 0) {
+            
+            I386::cpuRelax();
+        }
+    }
+    
+    LOCK_BARRIER();
+    
+#ifdef LOCKSTAT
+    Core::LockStat::record(this->_class, contended, contended ? I386::readTimeStampCounter() - start : 0);
+#endif
+}
+
+void Core::MCSLock::unlock(MCSNode* node) {
+    
+    LOCK_BARRIER();
+    
+    if(node->next == 0) {
+        
+        // nobody behind us, try to leave the lock free
+        if(I386::compareExchange(reinterpret_cast<volatile unsigned long*>(&this->_tail), reinterpret_cast<unsigned long>(node), 0) == reinterpret_cast<unsigned long>(node)) {
+            
+            Core::Preempt::enable();
+            
+            return;
+        }
+        
+        // a waiter swapped itself in but did not link up yet
+        while(node->next == 0) {
+            
+            I386::cpuRelax();
+        }
+    }
+    
+    node->next->locked = 0;
+    
+    Core::Preempt::enable();
+}
+
+unsigned long Core::MCSLock::lockIrqSave(MCSNode* node) {
+    
+    unsigned long flags = I386::saveFlags();
+    
+    this->lock(node);
+    
+    return flags;
+}
+
+void Core::MCSLock::unlockIrqRestore(MCSNode* node, unsigned long flags) {
+    
+    this->unlock(node);
+    
+    I386::restoreFlags(flags);
+}
@@ -32,41 +32,235 @@
 #include <errors.h>
 #include <core/terminal.h>
 
+// character class of every byte, see TERMINAL_CLASS_CONTROL and on
+static const unsigned char terminalClasses[256] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,   // 0x00
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0,   // 0x10
+    5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,   // 0x20
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 4, 3, 4, 4, 4, 4,   // 0x30
+    7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,   // 0x40
+    7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 6, 7, 7, 7, 7,   // 0x50
+    7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,   // 0x60
+    7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 0,   // 0x70
+    8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8,   // 0x80
+    8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8,   // 0x90
+    8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8,   // 0xa0
+    8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8,   // 0xb0
+    8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8,   // 0xc0
+    8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8,   // 0xd0
+    8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8,   // 0xe0
+    8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8    // 0xf0
+};
+
+// what to do with a character class in each state, ESC aborts any sequence
+static const unsigned char terminalTransitions[TERMINAL_STATES][TERMINAL_CLASSES] = {
+    
+    // TERMINAL_STATE_GROUND
+    {
+        TERMINAL_TRANSITION(TERMINAL_ACTION_EXECUTE, TERMINAL_STATE_GROUND),
+        TERMINAL_TRANSITION(TERMINAL_ACTION_NONE, TERMINAL_STATE_ESCAPE),
+        TERMINAL_TRANSITION(TERMINAL_ACTION_PRINT, TERMINAL_STATE_GROUND),
+        TERMINAL_TRANSITION(TERMINAL_ACTION_PRINT, TERMINAL_STATE_GROUND),
+        TERMINAL_TRANSITION(TERMINAL_ACTION_PRINT, TERMINAL_STATE_GROUND),
+        TERMINAL_TRANSITION(TERMINAL_ACTION_PRINT, TERMINAL_STATE_GROUND),
+        TERMINAL_TRANSITION(TERMINAL_ACTION_PRINT, TERMINAL_STATE_GROUND),
+        TERMINAL_TRANSITION(TERMINAL_ACTION_PRINT, TERMINAL_STATE_GROUND),
+        TERMINAL_TRANSITION(TERMINAL_ACTION_NONE, TERMINAL_STATE_GROUND)
+    },
+    
+    // TERMINAL_STATE_ESCAPE, only '[' starts a supported sequence
+    {
+        TERMINAL_TRANSITION(TERMINAL_ACTION_EXECUTE, TERMINAL_STATE_ESCAPE),
+        TERMINAL_TRANSITION(TERMINAL_ACTION_NONE, TERMINAL_STATE_ESCAPE),
+        TERMINAL_TRANSITION(TERMINAL_ACTION_NONE, TERMINAL_STATE_GROUND),
+        TERMINAL_TRANSITION(TERMINAL_ACTION_NONE, TERMINAL_STATE_GROUND),
+        TERMINAL_TRANSITION(TERMINAL_ACTION_NONE, TERMINAL_STATE_GROUND),
+        TERMINAL_TRANSITION(TERMINAL_ACTION_NONE, TERMINAL_STATE_IGNORE),
+        TERMINAL_TRANSITION(TERMINAL_ACTION_CLEAR, TERMINAL_STATE_CSI),
+        TERMINAL_TRANSITION(TERMINAL_ACTION_NONE, TERMINAL_STATE_GROUND),
+        TERMINAL_TRANSITION(TERMINAL_ACTION_NONE, TERMINAL_STATE_GROUND)
+    },
+    
+    // TERMINAL_STATE_CSI, private and intermediate characters are not supported
+    {
+        TERMINAL_TRANSITION(TERMINAL_ACTION_EXECUTE, TERMINAL_STATE_CSI),
+        TERMINAL_TRANSITION(TERMINAL_ACTION_NONE, TERMINAL_STATE_ESCAPE),
+        TERMINAL_TRANSITION(TERMINAL_ACTION_PARAMETER, TERMINAL_STATE_CSI),
+        TERMINAL_TRANSITION(TERMINAL_ACTION_PARAMETER, TERMINAL_STATE_CSI),
+        TERMINAL_TRANSITION(TERMINAL_ACTION_NONE, TERMINAL_STATE_IGNORE),
+        TERMINAL_TRANSITION(TERMINAL_ACTION_NONE, TERMINAL_STATE_IGNORE),
+        TERMINAL_TRANSITION(TERMINAL_ACTION_DISPATCH, TERMINAL_STATE_GROUND),
+        TERMINAL_TRANSITION(TERMINAL_ACTION_DISPATCH, TERMINAL_STATE_GROUND),
+        TERMINAL_TRANSITION(TERMINAL_ACTION_NONE, TERMINAL_STATE_CSI)
+    },
+    
+    // TERMINAL_STATE_IGNORE, waits for the final character
+    {
+        TERMINAL_TRANSITION(TERMINAL_ACTION_EXECUTE, TERMINAL_STATE_IGNORE),
+        TERMINAL_TRANSITION(TERMINAL_ACTION_NONE, TERMINAL_STATE_ESCAPE),
+        TERMINAL_TRANSITION(TERMINAL_ACTION_NONE, TERMINAL_STATE_IGNORE),
+        TERMINAL_TRANSITION(TERMINAL_ACTION_NONE, TERMINAL_STATE_IGNORE),
+        TERMINAL_TRANSITION(TERMINAL_ACTION_NONE, TERMINAL_STATE_IGNORE),
+        TERMINAL_TRANSITION(TERMINAL_ACTION_NONE, TERMINAL_STATE_IGNORE),
+        TERMINAL_TRANSITION(TERMINAL_ACTION_NONE, TERMINAL_STATE_GROUND),
+        TERMINAL_TRANSITION(TERMINAL_ACTION_NONE, TERMINAL_STATE_GROUND),
+        TERMINAL_TRANSITION(TERMINAL_ACTION_NONE, TERMINAL_STATE_IGNORE)
+    }
+};
+
+// terminal colors in the order of the ANSI color numbers
+static const unsigned char terminalAnsiColors[8] = {
+    TERMINAL_BLACK, TERMINAL_RED, TERMINAL_GREEN, TERMINAL_BROWN,
+    TERMINAL_BLUE, TERMINAL_MAGENTA, TERMINAL_CYAN, TERMINAL_LIGHTGRAY
+};
+
 Core::Terminal::Terminal(CharacterDevice* device) {
     
     // assign local data
     this->_device = device;
     this->_type = device->getTerminalType();
+    this->_x = 0;
+    this->_y = 0;
+    this->_columns = 0;
+    this->_rows = 0;
+    this->_ringRows = 0;
+    this->_buffer = 0;
+    this->_bufferSize = 0;
+    this->_color = 0;
+    this->_head = 0;
+    this->_history = 0;
+    this->_view = 0;
+    this->_page = 0;
+    this->_origin = 0;
+    this->_pageRows = 0;
+    this->_top = 0;
+    this->_defaultColor = 0;
+    this->_state = TERMINAL_STATE_GROUND;
+    this->_parameterCount = 0;
+    
+    this->clearDirty();
     
     if(this->_type == TERMINAL_TYPE_VIDEO) {
         
         // set default terminal color
         this->_color = MAKE_COLOR(TERMINAL_BLACK, TERMINAL_LIGHTGRAY, FALSE);
+        this->_defaultColor = this->_color;
+        
+        // the device decides the size of the screen
+        this->_columns = device->getColumns();
+        this->_rows = device->getRows();
+        
+        if(this->_rows > TERMINAL_MAX_ROWS) {
+            
+            this->_rows = TERMINAL_MAX_ROWS;
+        }
+        
+        this->_ringRows = this->_rows * (TERMINAL_SCROLLBACK_SCREENS + 1);
+        
+        // one screen unless the Console finds more room on the device
+        this->_pageRows = this->_rows;
     
-        // get memory for the buffer
-        this->_buffer = new short[VIDEO_SIZE * 2];
-        this->_bufferSize = VIDEO_SIZE;
+        // get memory for the screen and the scrollback
+        this->_bufferSize = this->_ringRows * this->_columns;
+        this->_buffer = new short[this->_bufferSize];
         
         // "zero" the buffer
-        for(int n = 0; n < VIDEO_SIZE; n++) {
+        for(int n = 0; n < this->_bufferSize; n++) {
             
             this->_buffer[n] = 0 | this->_color;
         }
+        
+        // nothing has been flushed yet
+        this->markAllDirty();
     }
 }
 
-unsigned long Core::Terminal::put(int x, int y, char c) {
+int Core::Terminal::getColumns() {
     
-    // check on which device to put it
-    if(this->_type == TERMINAL_TYPE_VIDEO) {
+    return this->_columns;
+}
+
+int Core::Terminal::getRows() {
+    
+    return this->_rows;
+}
+
+void Core::Terminal::markDirty(int row) {
+    
+    // rows below the screen are never flushed
+    if(row >= 0 && row < this->_rows) {
         
-        // copy into the buffer
-        this->_buffer[(y * 80 + x)] = c | this->_color;
+        this->_dirty[row / 32] |= 1UL << (row % 32);
+    }
+}
+
+void Core::Terminal::markAllDirty() {
+    
+    for(int row = 0; row < this->_rows; row++) {
         
-        return E_SUCCESS;
+        this->markDirty(row);
     }
+}
+
+bool Core::Terminal::isDirty(int row) {
     
-    return E_INVALID_TERMINAL;
+    return (this->_dirty[row / 32] & (1UL << (row % 32))) != 0;
+}
+
+void Core::Terminal::clearDirty() {
+    
+    for(int n = 0; n < TERMINAL_DIRTY_WORDS; n++) {
+        
+        this->_dirty[n] = 0;
+    }
+}
+
+void Core::Terminal::shiftDirty() {
+    
+    for(int n = 0; n < TERMINAL_DIRTY_WORDS; n++) {
+        
+        this->_dirty[n] >>= 1;
+        
+        // the first row of the next word moves into this one
+        if(n + 1 < TERMINAL_DIRTY_WORDS) {
+            
+            this->_dirty[n] |= (this->_dirty[n + 1] & 1) << 31;
+        }
+    }
+}
+
+short* Core::Terminal::getRow(int y) {
+    
+    int row = this->_head + y;
+    
+    if(row >= this->_ringRows) {
+        
+        row -= this->_ringRows;
+    }
+    
+    return &this->_buffer[row * this->_columns];
+}
+
+int Core::Terminal::getVisibleRow(int y) {
+    
+    int row = this->_head - this->_view + y;
+    
+    // the view never reaches further back than one ring
+    if(row < 0) {
+        
+        row += this->_ringRows;
+    }
+    else if(row >= this->_ringRows) {
+        
+        row -= this->_ringRows;
+    }
+    
+    return row;
+}
+
+unsigned long Core::Terminal::put(int x, int y, char c) {
+    
+    return this->put(x, y, c, this->_color);
 }
 
 unsigned long Core::Terminal::put(int x, int y, char c, short color) {
@@ -74,8 +268,14 @@ unsigned long Core::Terminal::put(int x, int y, char c, short color) {
     // check on which device to put it
     if(this->_type == TERMINAL_TYPE_VIDEO) {
         
+        if(x < 0 || x >= this->_columns || y < 0 || y >= this->_rows) {
+            
+            return E_BUFFER_OVERFLOW;
+        }
+        
         // copy into the buffer
-        this->_buffer[(y * 80 + x)] = c | color;
+        this->getRow(y)[x] = c | color;
+        this->markDirty(y);
         
         return E_SUCCESS;
     }
@@ -88,6 +288,7 @@ unsigned long Core::Terminal::setColor(short color) {
     if(this->_type == TERMINAL_TYPE_VIDEO) {
         
         this->_color = color;
+        this->_defaultColor = color;
         
         return E_SUCCESS;
     }
@@ -99,16 +300,49 @@ unsigned long Core::Terminal::write(const char* sequence) {
     
     if(this->_type == TERMINAL_TYPE_VIDEO) {
         
-        // loop through the sequence (halt when string gets too big or ends)
-        for(int n = 0; n < VIDEO_SIZE && sequence[n] != 0; n++) {
+        // loop through the sequence until it ends, scrolling keeps the buffer in bounds
+        for(int n = 0; sequence[n] != 0; n++) {
             
             // and copy
-            this->put(sequence[n]);
+            this->parse(sequence[n]);
         }
         
         return E_SUCCESS;
     }
     
+    if(this->_type == TERMINAL_TYPE_SERIAL) {
+        
+        unsigned long length = 0;
+        
+        while(sequence[length] != 0) {
+            
+            length++;
+        }
+        
+        return this->write(sequence, length);
+    }
+    
+    return E_FAILURE;
+}
+
+unsigned long Core::Terminal::write(const char* sequence, unsigned long length) {
+    
+    if(this->_type == TERMINAL_TYPE_VIDEO) {
+        
+        for(unsigned long n = 0; n < length; n++) {
+            
+            this->parse(sequence[n]);
+        }
+        
+        return E_SUCCESS;
+    }
+    
+    // a serial line keeps no screen, the text goes straight to the device
+    if(this->_type == TERMINAL_TYPE_SERIAL) {
+        
+        return this->_device->write(const_cast<char*>(sequence), length);
+    }
+    
     return E_FAILURE;
 }
 
@@ -120,7 +354,8 @@ void Core::Terminal::put(char c) {
         if(this->_x != 0) {
 	
             this->_x--;
-            this->_buffer[this->_y * 80 + this->_x] = ' ';
+            this->getRow(this->_y)[this->_x] = ' ';
+            this->markDirty(this->_y);
 	}
     }
     
@@ -144,13 +379,14 @@ void Core::Terminal::put(char c) {
     // normal char
     else if(c >= ' ') {
         
-        this->_buffer[this->_y * 80 + this->_x] = c | this->_color;
+        this->getRow(this->_y)[this->_x] = c | this->_color;
+        this->markDirty(this->_y);
         
         this->_x++;
     }
 
     // end of line detection
-    if(this->_x >= 80) {
+    if(this->_x >= this->_columns) {
         
         this->_x = 0;
         this->_y++;
@@ -160,9 +396,336 @@ void Core::Terminal::put(char c) {
     this->scroll();
 }
 
+void Core::Terminal::parse(char c) {
+    
+    unsigned char transition = terminalTransitions[this->_state][terminalClasses[static_cast<unsigned char>(c)]];
+    
+    this->_state = transition & 0x0f;
+    
+    switch(transition >> 4) {
+        
+        case TERMINAL_ACTION_PRINT:
+        case TERMINAL_ACTION_EXECUTE:
+            this->put(c);
+            break;
+            
+        case TERMINAL_ACTION_CLEAR:
+            this->_parameterCount = 0;
+            
+            for(int n = 0; n < TERMINAL_CSI_PARAMETERS; n++) {
+                
+                this->_parameters[n] = 0;
+            }
+            break;
+            
+        case TERMINAL_ACTION_PARAMETER:
+            // an omitted first parameter still counts
+            if(this->_parameterCount == 0) {
+                
+                this->_parameterCount = 1;
+            }
+            
+            if(c == ';') {
+                
+                if(this->_parameterCount < TERMINAL_CSI_PARAMETERS) {
+                    
+                    this->_parameterCount++;
+                }
+            }
+            else {
+                
+                int* parameter = &this->_parameters[this->_parameterCount - 1];
+                
+                *parameter = *parameter * 10 + (c - '0');
+                
+                if(*parameter > TERMINAL_CSI_PARAMETER_MAX) {
+                    
+                    *parameter = TERMINAL_CSI_PARAMETER_MAX;
+                }
+            }
+            break;
+            
+        case TERMINAL_ACTION_DISPATCH:
+            this->dispatch(c);
+            break;
+    }
+}
+
+int Core::Terminal::getParameter(int index, int value) {
+    
+    if(index >= this->_parameterCount || this->_parameters[index] == 0) {
+        
+        return value;
+    }
+    
+    return this->_parameters[index];
+}
+
+void Core::Terminal::dispatch(char final) {
+    
+    switch(final) {
+        
+        // cursor up, down, forward and back
+        case 'A':
+            this->_y -= this->getParameter(0, 1);
+            break;
+            
+        case 'B':
+            this->_y += this->getParameter(0, 1);
+            break;
+            
+        case 'C':
+            this->_x += this->getParameter(0, 1);
+            break;
+            
+        case 'D':
+            this->_x -= this->getParameter(0, 1);
+            break;
+            
+        // cursor to a column
+        case 'G':
+            this->_x = this->getParameter(0, 1) - 1;
+            break;
+            
+        // cursor to a row and column, counted from 1
+        case 'H':
+        case 'f':
+            this->_y = this->getParameter(0, 1) - 1;
+            this->_x = this->getParameter(1, 1) - 1;
+            break;
+            
+        // erase in display, from the cursor, up to the cursor or all of it
+        case 'J':
+            switch(this->getParameter(0, 0)) {
+                
+                case 0:
+                    this->erase(this->_y, this->_x, this->_columns);
+                    
+                    for(int y = this->_y + 1; y < this->_rows; y++) {
+                        
+                        this->erase(y, 0, this->_columns);
+                    }
+                    break;
+                    
+                case 1:
+                    for(int y = 0; y < this->_y; y++) {
+                        
+                        this->erase(y, 0, this->_columns);
+                    }
+                    
+                    this->erase(this->_y, 0, this->_x + 1);
+                    break;
+                    
+                case 2:
+                    for(int y = 0; y < this->_rows; y++) {
+                        
+                        this->erase(y, 0, this->_columns);
+                    }
+                    break;
+            }
+            break;
+            
+        // erase in line, from the cursor, up to the cursor or all of it
+        case 'K':
+            switch(this->getParameter(0, 0)) {
+                
+                case 0:
+                    this->erase(this->_y, this->_x, this->_columns);
+                    break;
+                    
+                case 1:
+                    this->erase(this->_y, 0, this->_x + 1);
+                    break;
+                    
+                case 2:
+                    this->erase(this->_y, 0, this->_columns);
+                    break;
+            }
+            break;
+            
+        case 'm':
+            this->selectGraphicRendition();
+            break;
+    }
+    
+    // the cursor stays on the screen
+    if(this->_x < 0) {
+        
+        this->_x = 0;
+    }
+    else if(this->_x >= this->_columns) {
+        
+        this->_x = this->_columns - 1;
+    }
+    
+    if(this->_y < 0) {
+        
+        this->_y = 0;
+    }
+    else if(this->_y >= this->_rows) {
+        
+        this->_y = this->_rows - 1;
+    }
+}
+
+void Core::Terminal::selectGraphicRendition() {
+    
+    // no parameters means a reset
+    if(this->_parameterCount == 0) {
+        
+        this->_parameterCount = 1;
+    }
+    
+    for(int n = 0; n < this->_parameterCount; n++) {
+        
+        int parameter = this->_parameters[n];
+        
+        // foreground in bits 8 to 11, background in bits 12 to 14
+        if(parameter == 0) {
+            
+            this->_color = this->_defaultColor;
+        }
+        else if(parameter == 1) {
+            
+            this->_color |= 0x0800;
+        }
+        else if(parameter == 22) {
+            
+            this->_color &= ~0x0800;
+        }
+        else if(parameter >= 30 && parameter <= 37) {
+            
+            this->_color = (this->_color & ~0x0700) | (terminalAnsiColors[parameter - 30] << 8);
+        }
+        else if(parameter == 39) {
+            
+            this->_color = (this->_color & ~0x0f00) | (this->_defaultColor & 0x0f00);
+        }
+        else if(parameter >= 40 && parameter <= 47) {
+            
+            this->_color = (this->_color & ~0x7000) | (terminalAnsiColors[parameter - 40] << 12);
+        }
+        else if(parameter == 49) {
+            
+            this->_color = (this->_color & ~0x7000) | (this->_defaultColor & 0x7000);
+        }
+        else if(parameter >= 90 && parameter <= 97) {
+            
+            this->_color = (this->_color & ~0x0f00) | ((terminalAnsiColors[parameter - 90] | 0x08) << 8);
+        }
+        else if(parameter >= 100 && parameter <= 107) {
+            
+            // the attribute has no bright backgrounds
+            this->_color = (this->_color & ~0x7000) | (terminalAnsiColors[parameter - 100] << 12);
+        }
+    }
+}
+
+void Core::Terminal::erase(int y, int from, int to) {
+    
+    short* row = this->getRow(y);
+    
+    for(int x = from; x < to; x++) {
+        
+        row[x] = ' ' | this->_color;
+    }
+    
+    this->markDirty(y);
+}
+
 void Core::Terminal::scroll() {
     
-    // TODO: fixme
+    while(this->_y >= this->_rows) {
+        
+        // what the device shows on the top row unless it is still dirty
+        short* above = this->getRow(0);
+        
+        // the top row becomes history, the oldest history row becomes the new bottom row
+        if(++this->_head == this->_ringRows) {
+            
+            this->_head = 0;
+        }
+        
+        if(this->_history < this->_ringRows - this->_rows) {
+            
+            this->_history++;
+        }
+        
+        this->_y--;
+        
+        short* row = this->getRow(this->_y);
+        
+        for(int n = 0; n < this->_columns; n++) {
+            
+            row[n] = ' ' | this->_color;
+        }
+        
+        // the view shows history, so every row of the screen changes
+        if(this->_view != 0) {
+            
+            this->markAllDirty();
+            
+            continue;
+        }
+        
+        if(this->_pageRows > this->_rows) {
+            
+            // the screen starts one row further down, the rows keep their cells
+            if(++this->_top + this->_rows <= this->_pageRows) {
+                
+                this->shiftDirty();
+                this->markDirty(this->_rows - 1);
+            }
+            else {
+                
+                // out of rows, start over at the top of the page
+                this->_top = 0;
+                this->markAllDirty();
+            }
+            
+            continue;
+        }
+        
+        // a row the device still holds only has to be copied when its cells changed
+        for(int y = 0; y < this->_rows; y++) {
+            
+            short* row = this->getRow(y);
+            
+            for(int n = 0; n < this->_columns && !this->isDirty(y); n++) {
+                
+                if(row[n] != above[n]) {
+                    
+                    this->markDirty(y);
+                }
+            }
+            
+            above = row;
+        }
+    }
+}
+
+bool Core::Terminal::scrollView(int rows) {
+    
+    int view = this->_view + rows;
+    
+    if(view < 0) {
+        
+        view = 0;
+    }
+    else if(view > this->_history) {
+        
+        view = this->_history;
+    }
+    
+    if(view == this->_view) {
+        
+        return false;
+    }
+    
+    this->_view = view;
+    this->markAllDirty();
+    
+    return true;
 }
 
 unsigned long Core::Terminal::startResource() {
@@ -0,0 +1,172 @@
+/***************************************************************************
+ *            thread.cpp
+ *
+ *  Copyright  2008  Matthias v.d. Vlies
+ *  matthias@mserver.nl
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*! \file thread.cpp
+ *  \brief Kernel threads
+ *   
+ *  This file implements the Thread class.
+ *
+ */
+
+#include <core/thread.h>
+#include <core/scheduler.h>
+#include <core/cpu.h>
+#include <I386/i386.h>
+#include <I386/fpu.h>
+#include <errors.h>
+
+Core::Thread::Thread(Function function, unsigned long data, const char* name, int priority) {
+    
+    // clamp to the valid levels
+    if(priority < 0) {
+        
+        priority = 0;
+    }
+    else if(priority > THREAD_LOWEST_PRIORITY) {
+        
+        priority = THREAD_LOWEST_PRIORITY;
+    }
+    
+    this->_function = function;
+    this->_data = data;
+    this->_name = name;
+    this->_stackPointer = 0;
+    this->_stackTop = 0;
+    this->_fpuContext = 0;
+    this->_state = THREAD_BLOCKED;
+    this->_priority = priority;
+    this->_timeSlice = 0;
+    this->_cpu = Core::CPU::getCurrentId();
+    this->_bound = false;
+    this->_onProcessor = false;
+    this->_next = 0;
+}
+
+Core::Thread::Thread(const char* name) {
+    
+    this->_function = 0;
+    this->_data = 0;
+    this->_name = name;
+    this->_stackPointer = 0;
+    this->_stackTop = 0;
+    this->_fpuContext = 0;
+    this->_state = THREAD_RUNNING;
+    this->_priority = THREAD_LOWEST_PRIORITY;
+    this->_timeSlice = 0;
+    this->_cpu = Core::CPU::getCurrentId();
+    this->_bound = true;
+    this->_onProcessor = true;
+    this->_next = 0;
+}
+
+unsigned long Core::Thread::start() {
+    
+    unsigned char* stack = new unsigned char[THREAD_STACK_SIZE];
+    
+    // check if we got a valid address
+    if(stack == reinterpret_cast<unsigned char*>(E_ALLOC_NOMEM)) {
+        
+        return E_ALLOC_NOMEM;
+    }
+    
+    // tasks that never use the FPU never touch this area
+    this->_fpuContext = I386::FPU::getInstance()->allocateContext();
+    
+    this->_stackTop = reinterpret_cast<unsigned long>(stack + THREAD_STACK_SIZE);
+    
+    // build the frame _context_switch pops when switching to the thread for the first time
+    unsigned long* frame = reinterpret_cast<unsigned long*>(this->_stackTop);
+    
+    *--frame = reinterpret_cast<unsigned long>(this);       // argument for bootstrap()
+    *--frame = 0;                                           // bootstrap() never returns
+    *--frame = reinterpret_cast<unsigned long>(Core::Thread::bootstrap);
+    *--frame = 0;                                           // ebp
+    *--frame = 0;                                           // ebx
+    *--frame = 0;                                           // esi
+    *--frame = 0;                                           // edi
+    *--frame = 0x002;                                       // EFLAGS, interrupts disabled
+    
+    this->_stackPointer = reinterpret_cast<unsigned long>(frame);
+    
+    if(!this->_bound) {
+        
+        this->_cpu = Core::CPU::getCurrentId();
+    }
+    
+    Core::Scheduler::add(this);
+    
+    return E_SUCCESS;
+}
+
+void Core::Thread::bind(unsigned int cpu) {
+    
+    this->_cpu = cpu;
+    this->_bound = true;
+}
+
+const char* Core::Thread::getName() {
+    
+    return this->_name;
+}
+
+int Core::Thread::getState() {
+    
+    return this->_state;
+}
+
+int Core::Thread::getPriority() {
+    
+    return this->_priority;
+}
+
+void Core::Thread::bootstrap(Thread* thread) {
+    
+    // we arrive here from the middle of Scheduler::schedule()
+    Core::Scheduler::finishSwitch();
+    
+    I386::enableInterrupts();
+    
+    thread->_function(thread->_data);
+    
+    Core::Thread::exit();
+}
+
+void Core::Thread::exit() {
+    
+    I386::disableInterrupts();
+    
+    Thread* thread = Core::Scheduler::getCurrent();
+    
+    thread->_state = THREAD_DEAD;
+    
+    if(thread->_fpuContext != 0) {
+        
+        I386::FPU::getInstance()->forget(thread->_fpuContext);
+    }
+    
+    // we are still running on the stack, the next thread frees it in finishSwitch()
+    Core::Scheduler::schedule();
+    
+    // never reached
+    for(;;);
+}
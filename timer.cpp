@@ -0,0 +1,336 @@
+/***************************************************************************
+ *            timer.cpp
+ *
+ *  Copyright  2008  Matthias v.d. Vlies
+ *  matthias@mserver.nl
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*! \file timer.cpp
+ *  \brief Kernel timers
+ *   
+ *  This file implements the Timer and TimerWheel classes.
+ *
+ */
+
+#include <core/timer.h>
+#include <core/softirq.h>
+#include <core/cpu.h>
+#include <I386/i386.h>
+
+/*! Macro for comparing tick counts that may have wrapped
+ *
+ *\param a The first tick count
+ *\param b The second tick count
+ *\return Wether a is equal to or later than b
+ */
+#define TICKS_AFTER_EQ(a, b)    (static_cast<long>((a) - (b)) >= 0)
+
+/*! Macro for getting the slot index of a tick count in a cascading level
+ *
+ *\param ticks The tick count
+ *\param level The cascading level
+ */
+#define LEVEL_INDEX(ticks, level)   (((ticks) >> (TIMER_ROOT_BITS + (level) * TIMER_LEVEL_BITS)) & (TIMER_LEVEL_SIZE - 1))
+
+Core::Timer::Timer(Function function, unsigned long data) {
+    
+    this->_function = function;
+    this->_data = data;
+    this->_expires = 0;
+    this->_slack = -1;
+    this->_cpu = TIMER_NOT_QUEUED;
+    this->_next = 0;
+    this->_pprev = 0;
+}
+
+void Core::Timer::setSlack(unsigned long ticks) {
+    
+    this->_slack = ticks;
+}
+
+bool Core::Timer::isPending() {
+    
+    return this->_cpu != TIMER_NOT_QUEUED;
+}
+
+// no ticks yet
+volatile unsigned long Core::TimerWheel::_ticks = 0;
+
+// all slots empty
+Core::TimerWheel::Wheel Core::TimerWheel::_wheels[MAX_CPUS];
+
+void Core::TimerWheel::initialise() {
+    
+    Core::SoftIRQ::registerHandler(SOFTIRQ_TIMER, Core::TimerWheel::run);
+}
+
+void Core::TimerWheel::tick() {
+    
+    _ticks++;
+    
+    Core::SoftIRQ::raise(SOFTIRQ_TIMER);
+}
+
+unsigned long Core::TimerWheel::getTicks() {
+    
+    return _ticks;
+}
+
+unsigned long Core::TimerWheel::applySlack(unsigned long expires, unsigned long slack) {
+    
+    unsigned long limit = expires + slack;
+    unsigned long mask = expires ^ limit;
+    
+    if(mask == 0) {
+        
+        return expires;
+    }
+    
+    // clear every bit below the highest one that may change
+    mask = (1UL << I386::findLastBit(mask)) - 1;
+    
+    return limit & ~mask;
+}
+
+void Core::TimerWheel::enqueue(Wheel* wheel, Timer* timer) {
+    
+    unsigned long expires = timer->_expires;
+    unsigned long delta = expires - wheel->ticks;
+    
+    Timer** slot;
+    
+    if(static_cast<long>(delta) < 0) {
+        
+        // already expired, run on the next tick
+        slot = &wheel->root[wheel->ticks & (TIMER_ROOT_SIZE - 1)];
+    }
+    else if(delta < TIMER_ROOT_SIZE) {
+        
+        slot = &wheel->root[expires & (TIMER_ROOT_SIZE - 1)];
+    }
+    else {
+        
+        // find the finest level that covers the delay
+        int level = 0;
+        
+        while(level < TIMER_LEVELS - 1 && delta >= (1UL << (TIMER_ROOT_BITS + (level + 1) * TIMER_LEVEL_BITS))) {
+            
+            level++;
+        }
+        
+        slot = &wheel->levels[level][LEVEL_INDEX(expires, level)];
+    }
+    
+    // push in front of the slot
+    timer->_next = *slot;
+    
+    if(timer->_next != 0) {
+        
+        timer->_next->_pprev = &timer->_next;
+    }
+    
+    timer->_pprev = slot;
+    *slot = timer;
+}
+
+void Core::TimerWheel::unlink(Timer* timer) {
+    
+    *timer->_pprev = timer->_next;
+    
+    if(timer->_next != 0) {
+        
+        timer->_next->_pprev = timer->_pprev;
+    }
+    
+    timer->_next = 0;
+    timer->_pprev = 0;
+}
+
+Core::TimerWheel::Wheel* Core::TimerWheel::lockWheels(Wheel* own, Timer* timer) {
+    
+    while(true) {
+        
+        int cpu = timer->_cpu;
+        
+        Wheel* other = (cpu == TIMER_NOT_QUEUED || &_wheels[cpu] == own) ? 0 : &_wheels[cpu];
+        
+        if(other == 0) {
+            
+            own->lock.lock();
+        }
+        else if(other < own) {
+            
+            other->lock.lock();
+            own->lock.lock();
+        }
+        else {
+            
+            own->lock.lock();
+            other->lock.lock();
+        }
+        
+        // nobody moved the timer while we were waiting
+        if(timer->_cpu == cpu) {
+            
+            return other;
+        }
+        
+        own->lock.unlock();
+        
+        if(other != 0) {
+            
+            other->lock.unlock();
+        }
+    }
+}
+
+void Core::TimerWheel::add(Timer* timer, unsigned long delay) {
+    
+    unsigned long flags = I386::saveFlags();
+    
+    unsigned int cpu = Core::CPU::getCurrentId();
+    
+    Wheel* wheel = &_wheels[cpu];
+    Wheel* other = lockWheels(wheel, timer);
+    
+    // re-adding moves the timer
+    if(timer->_cpu != TIMER_NOT_QUEUED) {
+        
+        unlink(timer);
+    }
+    
+    if(other != 0) {
+        
+        other->lock.unlock();
+    }
+    
+    unsigned long slack = (timer->_slack >= 0) ? timer->_slack : (delay >> TIMER_DEFAULT_SLACK_SHIFT);
+    
+    timer->_expires = applySlack(_ticks + delay, slack);
+    timer->_cpu = cpu;
+    
+    enqueue(wheel, timer);
+    
+    wheel->lock.unlock();
+    
+    I386::restoreFlags(flags);
+}
+
+bool Core::TimerWheel::cancel(Timer* timer) {
+    
+    while(true) {
+        
+        int cpu = timer->_cpu;
+        
+        if(cpu == TIMER_NOT_QUEUED) {
+            
+            return false;
+        }
+        
+        Wheel* wheel = &_wheels[cpu];
+        
+        unsigned long flags = wheel->lock.lockIrqSave();
+        
+        // the timer may have expired or moved before we got the lock
+        if(timer->_cpu == cpu) {
+            
+            unlink(timer);
+            
+            timer->_cpu = TIMER_NOT_QUEUED;
+            
+            wheel->lock.unlockIrqRestore(flags);
+            
+            return true;
+        }
+        
+        wheel->lock.unlockIrqRestore(flags);
+    }
+}
+
+unsigned long Core::TimerWheel::cascade(Wheel* wheel, int level) {
+    
+    unsigned long index = LEVEL_INDEX(wheel->ticks, level);
+    
+    // detach the slot and sort its timers into finer slots
+    Timer* timer = wheel->levels[level][index];
+    
+    wheel->levels[level][index] = 0;
+    
+    while(timer != 0) {
+        
+        Timer* next = timer->_next;
+        
+        enqueue(wheel, timer);
+        
+        timer = next;
+    }
+    
+    return index;
+}
+
+void Core::TimerWheel::run() {
+    
+    Wheel* wheel = &_wheels[Core::CPU::getCurrentId()];
+    
+    unsigned long flags = wheel->lock.lockIrqSave();
+    
+    while(TICKS_AFTER_EQ(_ticks, wheel->ticks)) {
+        
+        unsigned long index = wheel->ticks & (TIMER_ROOT_SIZE - 1);
+        
+        // the first level wrapped, pull down the next slots of the coarser levels
+        if(index == 0) {
+            
+            for(int level = 0; level < TIMER_LEVELS && cascade(wheel, level) == 0; level++);
+        }
+        
+        wheel->ticks++;
+        
+        // detach the expired slot, cancel() may still unlink from it
+        Timer* expired = wheel->root[index];
+        
+        wheel->root[index] = 0;
+        
+        if(expired != 0) {
+            
+            expired->_pprev = &expired;
+        }
+        
+        while(expired != 0) {
+            
+            Timer* timer = expired;
+            
+            unlink(timer);
+            
+            timer->_cpu = TIMER_NOT_QUEUED;
+            
+            Timer::Function function = timer->_function;
+            unsigned long data = timer->_data;
+            
+            // run the function unlocked, it may add or cancel timers itself
+            wheel->lock.unlockIrqRestore(flags);
+            
+            function(data);
+            
+            flags = wheel->lock.lockIrqSave();
+        }
+    }
+    
+    wheel->lock.unlockIrqRestore(flags);
+}
@@ -33,6 +33,7 @@
 #include <core/terminal.h>
 #include <config.h>
 #include <errors.h>
+#include <I386/i386.h>
 
 // set instance pointer to a null pointer
 Core::Video* Core::Video::_instance = 0;
@@ -70,8 +71,8 @@ Core::Video::Video() {
 
 void Core::Video::clearBuffer() {
     
-    // loop through the buffer
-    for(int n = 0; n < VIDEO_SIZE; n++) {
+    // loop through the buffer of every page
+    for(int n = 0; n < VIDEO_SIZE * VIDEO_PAGES; n++) {
         
         // and clear data
         this->_buffer[n] = 0;
@@ -97,11 +98,61 @@ unsigned long Core::Video::write(void* buffer, unsigned long size) {
     return E_SUCCESS;
 }
 
+unsigned long Core::Video::write(void* buffer, unsigned long offset, unsigned long size) {
+    
+    // check for buffer overflow, the offset may lie on any page
+    if(offset > VIDEO_SIZE * VIDEO_PAGES || size > VIDEO_SIZE * VIDEO_PAGES - offset) {
+        
+        return E_BUFFER_OVERFLOW;
+    }
+    
+    short* sourceBuffer = static_cast<short*>(buffer);
+    
+    // copy only the requested cells, every store to video memory may trap on a VM
+    for(unsigned int n = 0; n < size; n++) {
+        
+        this->_buffer[offset + n] = sourceBuffer[n];
+    }
+    
+    return E_SUCCESS;
+}
+
+void Core::Video::present() {
+    
+    // the text screen shows the video memory as it is written
+}
+
+void Core::Video::showPage(unsigned long page, unsigned long row) {
+    
+    unsigned long start = page * VIDEO_SIZE + row * VIDEO_COLUMNS;
+    
+    // the adapter scans out from another cell, nothing is copied
+    I386::writePortByte(VIDEO_CRTC_INDEX, VIDEO_CRTC_START_HIGH);
+    I386::writePortByte(VIDEO_CRTC_DATA, start >> 8);
+    I386::writePortByte(VIDEO_CRTC_INDEX, VIDEO_CRTC_START_LOW);
+    I386::writePortByte(VIDEO_CRTC_DATA, start);
+}
+
 unsigned long Core::Video::getTerminalType() {
     
     return TERMINAL_TYPE_VIDEO;
 }
 
+unsigned long Core::Video::getColumns() {
+    
+    return VIDEO_COLUMNS;
+}
+
+unsigned long Core::Video::getRows() {
+    
+    return VIDEO_ROWS;
+}
+
+unsigned long Core::Video::getPages() {
+    
+    return VIDEO_PAGES;
+}
+
 unsigned long Core::Video::startResource() {
     
     return E_SUCCESS;
@@ -0,0 +1,163 @@
+/***************************************************************************
+ *            waitqueue.cpp
+ *
+ *  Copyright  2008  Matthias v.d. Vlies
+ *  matthias@mserver.nl
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*! \file waitqueue.cpp
+ *  \brief Wait queues
+ *   
+ *  This file implements the WaitQueue class.
+ *
+ */
+
+#include <core/waitqueue.h>
+#include <core/scheduler.h>
+
+Core::WaitQueue::WaitQueue() : _head(0) {
+    
+}
+
+void Core::WaitQueue::wait(Condition condition, void* data, bool exclusive) {
+    
+    WaitQueueEntry entry;
+    
+    entry.thread = Core::Scheduler::getCurrent();
+    entry.exclusive = exclusive;
+    entry.queued = false;
+    entry.next = 0;
+    
+    unsigned long flags = this->_lock.lockIrqSave();
+    
+    for(;;) {
+        
+        // a wake up dequeues us, queue again before looking at the condition
+        if(!entry.queued) {
+            
+            this->enqueue(&entry);
+        }
+        
+        if(condition(data)) {
+            
+            break;
+        }
+        
+        // drops the lock once we are marked blocked, wakers take it before waking us
+        Core::Scheduler::block(&this->_lock);
+        
+        this->_lock.lock();
+    }
+    
+    if(entry.queued) {
+        
+        this->dequeue(&entry);
+    }
+    
+    this->_lock.unlockIrqRestore(flags);
+}
+
+void Core::WaitQueue::wakeUp() {
+    
+    this->wake(false);
+}
+
+void Core::WaitQueue::wakeUpAll() {
+    
+    this->wake(true);
+}
+
+bool Core::WaitQueue::isEmpty() {
+    
+    return this->_head == 0;
+}
+
+void Core::WaitQueue::enqueue(WaitQueueEntry* entry) {
+    
+    entry->queued = true;
+    
+    // non-exclusive waiters in front, so a wake up reaches them before the first exclusive one
+    if(!entry->exclusive || this->_head == 0) {
+        
+        entry->next = this->_head;
+        this->_head = entry;
+        
+        return;
+    }
+    
+    WaitQueueEntry* last = this->_head;
+    
+    while(last->next != 0) {
+        
+        last = last->next;
+    }
+    
+    entry->next = 0;
+    last->next = entry;
+}
+
+void Core::WaitQueue::dequeue(WaitQueueEntry* entry) {
+    
+    if(this->_head == entry) {
+        
+        this->_head = entry->next;
+    }
+    else {
+        
+        WaitQueueEntry* previous = this->_head;
+        
+        while(previous->next != entry) {
+            
+            previous = previous->next;
+        }
+        
+        previous->next = entry->next;
+    }
+    
+    entry->next = 0;
+    entry->queued = false;
+}
+
+void Core::WaitQueue::wake(bool all) {
+    
+    unsigned long flags = this->_lock.lockIrqSave();
+    
+    WaitQueueEntry* entry = this->_head;
+    
+    while(entry != 0) {
+        
+        WaitQueueEntry* next = entry->next;
+        
+        bool exclusive = entry->exclusive;
+        
+        // the waiter rechecks its condition and queues again if it lost the race
+        this->dequeue(entry);
+        
+        Core::Scheduler::wake(entry->thread);
+        
+        if(exclusive && !all) {
+            
+            break;
+        }
+        
+        entry = next;
+    }
+    
+    this->_lock.unlockIrqRestore(flags);
+}
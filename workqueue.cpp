@@ -0,0 +1,574 @@
+/***************************************************************************
+ *            workqueue.cpp
+ *
+ *  Copyright  2008  Matthias v.d. Vlies
+ *  matthias@mserver.nl
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*! \file workqueue.cpp
+ *  \brief Workqueues
+ *   
+ *  This file implements the Work, DelayedWork and WorkQueue classes.
+ *
+ */
+
+#include <core/workqueue.h>
+#include <core/cpu.h>
+#include <I386/i386.h>
+#include <errors.h>
+
+/*! Macro for comparing tickets that may have wrapped
+ *
+ *\param a The first ticket
+ *\param b The second ticket
+ *\return Wether a was handed out before b
+ */
+#define TICKET_BEFORE(a, b)     (static_cast<long>((a) - (b)) < 0)
+
+Core::Work::Work(Function function, unsigned long data) {
+    
+    this->_function = function;
+    this->_data = data;
+    this->_pending = 0;
+    this->_pool = 0;
+    this->_ticket = 0;
+    this->_next = 0;
+}
+
+bool Core::Work::isPending() {
+    
+    return this->_pending != 0;
+}
+
+Core::DelayedWork::DelayedWork(Function function, unsigned long data) : Work(function, data), _timer(Core::DelayedWork::expire, reinterpret_cast<unsigned long>(this)) {
+    
+    this->_queue = 0;
+}
+
+void Core::DelayedWork::expire(unsigned long data) {
+    
+    DelayedWork* work = reinterpret_cast<DelayedWork*>(data);
+    
+    // the timer fires on the processor that queued the work
+    work->_queue->insert(work);
+}
+
+// created once the processors are up
+Core::WorkQueue* Core::WorkQueue::_system = 0;
+
+Core::WorkQueue::WorkQueue(const char* name, unsigned int maxWorkers, int priority) {
+    
+    // every pool keeps at least the worker start() gives it
+    if(maxWorkers < 1) {
+        
+        maxWorkers = 1;
+    }
+    else if(maxWorkers > WORKQUEUE_MAX_WORKERS) {
+        
+        maxWorkers = WORKQUEUE_MAX_WORKERS;
+    }
+    
+    this->_name = name;
+    this->_maxWorkers = maxWorkers;
+    this->_priority = priority;
+    this->_flushing = 0;
+    
+    for(unsigned int n = 0; n < MAX_CPUS; n++) {
+        
+        WorkPool* pool = &this->_pools[n];
+        
+        pool->queue = this;
+        pool->cpu = n;
+        pool->head = 0;
+        pool->tail = 0;
+        pool->nextTicket = 0;
+        pool->workers = 0;
+        pool->idle = 0;
+        pool->growing = false;
+        
+        for(unsigned int i = 0; i < WORKQUEUE_MAX_WORKERS; i++) {
+            
+            pool->slots[i].pool = pool;
+            pool->slots[i].current = 0;
+            pool->slots[i].ticket = 0;
+        }
+    }
+}
+
+unsigned long Core::WorkQueue::start() {
+    
+    unsigned long result = E_SUCCESS;
+    
+    for(unsigned int n = 0; n < MAX_CPUS; n++) {
+        
+        WorkPool* pool = &this->_pools[n];
+        
+        if(!Core::CPU::isOnline(n) || pool->workers != 0) {
+            
+            continue;
+        }
+        
+        pool->growing = true;
+        
+        if(this->startWorker(pool) != E_SUCCESS) {
+            
+            result = E_ALLOC_NOMEM;
+        }
+    }
+    
+    return result;
+}
+
+unsigned long Core::WorkQueue::startWorker(WorkPool* pool) {
+    
+    // nobody else grows the pool, the next slot is ours
+    WorkerSlot* slot = &pool->slots[pool->workers];
+    
+    Thread* thread = new Thread(Core::WorkQueue::worker, reinterpret_cast<unsigned long>(slot), this->_name, this->_priority);
+    
+    unsigned long result = E_ALLOC_NOMEM;
+    
+    // check if we got a valid address
+    if(thread != reinterpret_cast<Thread*>(E_ALLOC_NOMEM)) {
+        
+        // keep the worker next to the cache its work warmed up
+        thread->bind(pool->cpu);
+        
+        result = thread->start();
+    }
+    
+    unsigned long flags = pool->lock.lockIrqSave();
+    
+    if(result == E_SUCCESS) {
+        
+        pool->workers++;
+    }
+    
+    pool->growing = false;
+    
+    pool->lock.unlockIrqRestore(flags);
+    
+    return result;
+}
+
+bool Core::WorkQueue::queue(Work* work) {
+    
+    // whoever sets the flag owns the queueing
+    if(I386::atomicExchange(&work->_pending, 1) != 0) {
+        
+        return false;
+    }
+    
+    this->insert(work);
+    
+    return true;
+}
+
+bool Core::WorkQueue::queueOn(Work* work, unsigned int cpu) {
+    
+    if(cpu >= MAX_CPUS || I386::atomicExchange(&work->_pending, 1) != 0) {
+        
+        return false;
+    }
+    
+    this->insert(work, cpu);
+    
+    return true;
+}
+
+bool Core::WorkQueue::queueDelayed(DelayedWork* work, unsigned long delay) {
+    
+    if(I386::atomicExchange(&work->_pending, 1) != 0) {
+        
+        return false;
+    }
+    
+    work->_queue = this;
+    
+    if(delay == 0) {
+        
+        this->insert(work);
+    }
+    else {
+        
+        Core::TimerWheel::add(&work->_timer, delay);
+    }
+    
+    return true;
+}
+
+void Core::WorkQueue::insert(Work* work, unsigned int cpu) {
+    
+    // stay on this processor until the work is in its list
+    unsigned long flags = I386::saveFlags();
+    
+    if(cpu == MAX_CPUS) {
+        
+        cpu = Core::CPU::getCurrentId();
+    }
+    
+    WorkPool* pool = &this->_pools[cpu];
+    
+    if(pool->workers == 0) {
+        
+        pool = &this->_pools[0];
+    }
+    
+    pool->lock.lock();
+    
+    work->_ticket = pool->nextTicket++;
+    work->_next = 0;
+    
+    if(pool->tail == 0) {
+        
+        pool->head = work;
+    }
+    else {
+        
+        pool->tail->_next = work;
+    }
+    
+    pool->tail = work;
+    work->_pool = pool;
+    
+    // a busy worker picks the work up when it is done with the current one
+    bool wake = pool->idle != 0;
+    
+    pool->lock.unlock();
+    
+    if(wake) {
+        
+        pool->waiters.wakeUp();
+    }
+    
+    I386::restoreFlags(flags);
+}
+
+bool Core::WorkQueue::unqueue(Work* work) {
+    
+    for(;;) {
+        
+        WorkPool* pool = work->_pool;
+        
+        if(pool == 0) {
+            
+            // a worker took it
+            if(work->_pending == 0) {
+                
+                return false;
+            }
+            
+            // claimed, but another processor has not put it in its list yet
+            I386::cpuRelax();
+            
+            continue;
+        }
+        
+        unsigned long flags = pool->lock.lockIrqSave();
+        
+        // moved on before we got the lock
+        if(work->_pool != pool) {
+            
+            pool->lock.unlockIrqRestore(flags);
+            
+            continue;
+        }
+        
+        Work* previous = 0;
+        
+        for(Work* current = pool->head; current != work; current = current->_next) {
+            
+            previous = current;
+        }
+        
+        if(previous == 0) {
+            
+            pool->head = work->_next;
+        }
+        else {
+            
+            previous->_next = work->_next;
+        }
+        
+        if(pool->tail == work) {
+            
+            pool->tail = previous;
+        }
+        
+        work->_next = 0;
+        work->_pool = 0;
+        work->_pending = 0;
+        
+        bool wake = this->_flushing != 0;
+        
+        pool->lock.unlockIrqRestore(flags);
+        
+        // a flush may have been waiting for this ticket
+        this->finished(wake);
+        
+        return true;
+    }
+}
+
+bool Core::WorkQueue::cancel(Work* work) {
+    
+    if(work->_pending == 0) {
+        
+        return false;
+    }
+    
+    return this->unqueue(work);
+}
+
+bool Core::WorkQueue::cancel(DelayedWork* work) {
+    
+    // still waiting for its delay?
+    if(Core::TimerWheel::cancel(&work->_timer)) {
+        
+        work->_pending = 0;
+        
+        return true;
+    }
+    
+    return this->cancel(static_cast<Work*>(work));
+}
+
+bool Core::WorkQueue::cancelSync(Work* work) {
+    
+    bool pending = this->cancel(work);
+    
+    this->waitIdle(work);
+    
+    return pending;
+}
+
+bool Core::WorkQueue::cancelSync(DelayedWork* work) {
+    
+    bool pending = this->cancel(work);
+    
+    this->waitIdle(work);
+    
+    return pending;
+}
+
+void Core::WorkQueue::waitIdle(Work* work) {
+    
+    FlushRequest request;
+    
+    request.queue = this;
+    request.work = work;
+    
+    // workers look at the count with their pool locked, so they see it before we check
+    I386::atomicFetchAdd(&this->_flushing, 1);
+    
+    this->_flushers.wait(Core::WorkQueue::isIdle, &request);
+    
+    I386::atomicFetchAdd(&this->_flushing, static_cast<unsigned long>(-1));
+}
+
+void Core::WorkQueue::flush() {
+    
+    FlushRequest request;
+    
+    request.queue = this;
+    request.work = 0;
+    
+    I386::atomicFetchAdd(&this->_flushing, 1);
+    
+    // everything queued from here on may still be pending when we return
+    for(unsigned int n = 0; n < MAX_CPUS; n++) {
+        
+        WorkPool* pool = &this->_pools[n];
+        
+        unsigned long flags = pool->lock.lockIrqSave();
+        
+        request.tickets[n] = pool->nextTicket;
+        
+        pool->lock.unlockIrqRestore(flags);
+    }
+    
+    this->_flushers.wait(Core::WorkQueue::isFlushed, &request);
+    
+    I386::atomicFetchAdd(&this->_flushing, static_cast<unsigned long>(-1));
+}
+
+void Core::WorkQueue::finished(bool wake) {
+    
+    if(wake) {
+        
+        this->_flushers.wakeUpAll();
+    }
+}
+
+bool Core::WorkQueue::isFlushed(void* data) {
+    
+    FlushRequest* request = reinterpret_cast<FlushRequest*>(data);
+    
+    bool flushed = true;
+    
+    for(unsigned int n = 0; n < MAX_CPUS && flushed; n++) {
+        
+        WorkPool* pool = &request->queue->_pools[n];
+        
+        pool->lock.lock();
+        
+        // the list is in ticket order, the head is the oldest queued work
+        if(pool->head != 0 && TICKET_BEFORE(pool->head->_ticket, request->tickets[n])) {
+            
+            flushed = false;
+        }
+        
+        for(unsigned int i = 0; i < pool->workers && flushed; i++) {
+            
+            if(pool->slots[i].current != 0 && TICKET_BEFORE(pool->slots[i].ticket, request->tickets[n])) {
+                
+                flushed = false;
+            }
+        }
+        
+        pool->lock.unlock();
+    }
+    
+    return flushed;
+}
+
+bool Core::WorkQueue::isIdle(void* data) {
+    
+    FlushRequest* request = reinterpret_cast<FlushRequest*>(data);
+    
+    bool idle = true;
+    
+    for(unsigned int n = 0; n < MAX_CPUS && idle; n++) {
+        
+        WorkPool* pool = &request->queue->_pools[n];
+        
+        pool->lock.lock();
+        
+        // only compare the pointer, the function may have freed the work
+        for(unsigned int i = 0; i < pool->workers && idle; i++) {
+            
+            if(pool->slots[i].current == request->work) {
+                
+                idle = false;
+            }
+        }
+        
+        pool->lock.unlock();
+    }
+    
+    return idle;
+}
+
+bool Core::WorkQueue::hasWork(void* data) {
+    
+    return reinterpret_cast<WorkPool*>(data)->head != 0;
+}
+
+void Core::WorkQueue::worker(unsigned long data) {
+    
+    WorkerSlot* slot = reinterpret_cast<WorkerSlot*>(data);
+    WorkPool* pool = slot->pool;
+    WorkQueue* queue = pool->queue;
+    
+    for(;;) {
+        
+        unsigned long flags = pool->lock.lockIrqSave();
+        
+        while(pool->head == 0) {
+            
+            pool->idle++;
+            
+            pool->lock.unlockIrqRestore(flags);
+            
+            pool->waiters.wait(Core::WorkQueue::hasWork, pool, true);
+            
+            flags = pool->lock.lockIrqSave();
+            
+            pool->idle--;
+        }
+        
+        Work* work = pool->head;
+        
+        pool->head = work->_next;
+        
+        if(pool->head == 0) {
+            
+            pool->tail = 0;
+        }
+        
+        work->_next = 0;
+        work->_pool = 0;
+        work->_pending = 0;
+        
+        slot->current = work;
+        slot->ticket = work->_ticket;
+        
+        // more waiting? somebody else takes over should this work sleep
+        bool wake = pool->head != 0 && pool->idle != 0;
+        bool grow = pool->head != 0 && pool->idle == 0 && !pool->growing && pool->workers < queue->_maxWorkers;
+        
+        if(grow) {
+            
+            pool->growing = true;
+        }
+        
+        pool->lock.unlockIrqRestore(flags);
+        
+        if(grow) {
+            
+            queue->startWorker(pool);
+        }
+        else if(wake) {
+            
+            pool->waiters.wakeUp();
+        }
+        
+        work->_function(work->_data);
+        
+        flags = pool->lock.lockIrqSave();
+        
+        slot->current = 0;
+        
+        bool flushing = queue->_flushing != 0;
+        
+        pool->lock.unlockIrqRestore(flags);
+        
+        queue->finished(flushing);
+    }
+}
+
+void Core::WorkQueue::initialise() {
+    
+    _system = new WorkQueue("events", WORKQUEUE_SYSTEM_WORKERS);
+    
+    // check if we got a valid address
+    if(_system == reinterpret_cast<WorkQueue*>(E_ALLOC_NOMEM)) {
+        
+        _system = 0;
+        
+        return;
+    }
+    
+    _system->start();
+}
+
+Core::WorkQueue* Core::WorkQueue::getSystemQueue() {
+    
+    return _system;
+}